@@ -0,0 +1,35 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _Arena_h_
+#define _Arena_h_
+
+// Static storage of the json documents, so that the heap of the ESP8266 is not fragmented over days of uptime:
+// all of them (cgis, configuration, programs, schedules) share a single one, one request is handled at a time.
+// The controls are constructed in place in their zone (see ControlVariant.h).
+
+#include <ArduinoJson.h>
+
+#define JSON_ARENA_SIZE 6144  // ArduinoJson document shared by all, sized for the configuration of MAX_ZONES zones
+
+extern StaticJsonDocument<JSON_ARENA_SIZE> jsonArena;
+
+#endif
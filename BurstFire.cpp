@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <ESP8266WiFi.h>
+#include "BurstFire.h"
+
+#define TIMER1_TICKS_PER_MS 5000  // 80MHz / 16
+
+
+BurstFire burstFire;
+
+
+  static void ICACHE_RAM_ATTR BurstFireIsr() {
+    burstFire.OnSlot();
+  }
+
+
+  BurstFire::BurstFire() {
+    numChannels=0;
+    slotMs=10;
+
+    for (int i=0;i<MAX_ZONES;i++)
+      channels[i].pin=-1;
+  }
+
+
+  // the timer runs only while at least one channel is attached
+  void BurstFire::Begin(int _slotMs) {
+    timer1_disable();
+
+    slotMs=_slotMs;
+    numChannels=0;
+
+    for (int i=0;i<MAX_ZONES;i++)
+      channels[i].pin=-1;
+  }
+
+
+  void BurstFire::Attach(int ch, IControlAction *action) {
+    Channel &c=channels[ch];
+
+    c.pin=action->GetPin();
+    c.von=action->von;
+    c.voff=action->voff;
+    c.demand=0;
+    c.acc=0;
+    c.on=false;
+    c.slots=0;
+    c.onSlots=0;
+
+    digitalWrite(c.pin,c.voff);
+
+    if (numChannels==0) {
+      timer1_attachInterrupt(BurstFireIsr);
+      timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+      timer1_write(slotMs*TIMER1_TICKS_PER_MS);
+    }
+
+    if (ch>=numChannels)
+      numChannels=ch+1;
+  }
+
+
+  void BurstFire::SetDemand(int ch, double demand) {
+    channels[ch].demand=(uint16_t) (constrain(demand,0.0,1.0)*BURST_FULL);
+  }
+
+
+  void BurstFire::ResetStats() {
+    for (int i=0;i<numChannels;i++) {
+      channels[i].slots=0;
+      channels[i].onSlots=0;
+    }
+  }
+
+
+  void BurstFire::GetJson(int ch, JsonObject obj) {
+    Channel &c=channels[ch];
+
+    obj["demand"]=(double) c.demand/BURST_FULL;
+    obj["deliveredDuty"]=(c.slots>0)?(double) c.onSlots/c.slots:0;
+    obj["slots"]=c.slots;
+  }
+
+
+  // Bresenham: the accumulator gains the demand every slot, a slot is fired each time it overflows
+  void ICACHE_RAM_ATTR BurstFire::OnSlot() {
+    for (int i=0;i<numChannels;i++) {
+      Channel &c=channels[i];
+
+      if (c.pin<0)
+        continue;
+
+      c.acc+=c.demand;
+
+      bool on=(c.acc>=BURST_FULL);
+      if (on)
+        c.acc-=BURST_FULL;
+
+      if (on!=c.on) {
+        digitalWrite(c.pin,on?c.von:c.voff);
+        c.on=on;
+      }
+
+      c.slots++;
+      if (on)
+        c.onSlots++;
+    }
+  }
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _BurstFire_h_
+#define _BurstFire_h_
+
+#include <ArduinoJson.h>
+#include "IControl.h"
+#include "configuration.h"
+
+#define BURST_FULL 1024   // demand resolution (1.0 duty)
+
+
+// Burst firing of solid state relays: a hardware timer (timer1) ticks once per slot (a mains half-cycle,
+// 10ms at 50Hz, or a short fixed slot) and each channel fires whole slots spread evenly across time
+// with a Bresenham accumulator, so a 30% demand fires about 3 slots out of 10 instead of 1.5s out of 5s.
+// Only SSR on esp8266 gpios can be used (the timer interrupt can't talk to the SX1509).
+class BurstFire {
+public:
+  BurstFire();
+  void Begin(int _slotMs);
+  void Attach(int ch, IControlAction *action);
+  void SetDemand(int ch, double demand);
+  void ResetStats();
+  void GetJson(int ch, JsonObject obj);
+
+  void OnSlot();  // called by the timer interrupt
+
+protected:
+  struct Channel {
+    int pin,von,voff;
+    volatile uint16_t demand;  // 0..BURST_FULL
+    uint16_t acc;
+    bool on;
+    volatile unsigned long slots,onSlots;
+  };
+
+  Channel channels[MAX_ZONES];
+  volatile int numChannels;
+  int slotMs;
+};
+
+extern BurstFire burstFire;
+
+#endif
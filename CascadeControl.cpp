@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+#include "CascadeControl.h"
+#include "SafetySupervisor.h"
+
+
+  CascadeControl::CascadeControl(const char *_name, IControlAction *_action, double *_set, double *_actual, double *_innerTarget, double Kp, double Ki, double offset) : IControl(_name,_action) {
+    set=_set;
+    actual=_actual;
+    innerTarget=_innerTarget;
+    output=0;
+    oldstarted=false;
+    trimGain=0;
+    trimMax=0;
+
+    pid.SetTunings(Kp,Ki,0);
+    pid.SetOutputLimits(-offset,offset);
+  }
+
+
+  void CascadeControl::SetTrim(double _trimGain, double _trimMax) {
+    trimGain=_trimGain;
+    trimMax=_trimMax;
+  }
+
+
+  // must be called before the control of the inner zone, which then works on the new target
+  void CascadeControl::Control(bool started, unsigned long now) {
+    if (started) {
+      if (!oldstarted) {
+        output=0;
+        pid.SetAutomatic(true,*set,*actual,output);
+      }
+
+      pid.Compute(*set,*actual,now,output);
+      // whatever the offset the inner zone is never driven above the highest set temperature
+      *innerTarget=*set+output;
+      if (*innerTarget>MAX_SET_TEMP)
+        *innerTarget=MAX_SET_TEMP;
+
+      demand=constrain(trimGain*(*set-*actual),0.0,trimMax);
+
+      Serial.printf("EspOven: CascadeControl %s (%d) set %f actual %f inner target %f trim demand %f\n",name,started,*set,*actual,*innerTarget,demand);
+    }
+    else if (oldstarted) {
+      pid.SetAutomatic(false,*set,*actual,output);
+      demand=0;
+    }
+
+    oldstarted=started;
+  }
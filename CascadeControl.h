@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _CascadeControl_h_
+#define _CascadeControl_h_
+
+#include "IControl.h"
+#include "PidEngine.h"
+
+// Cascade control of the stone, which is heated mostly by the chamber: an outer pid on the stone temperature
+// moves the target of the inner zone (the chamber, driven by its own PidControl) within set +- offset,
+// while the stone heater only trims with a proportional duty limited to trimMax.
+class CascadeControl: public IControl {
+public:
+  static const ControlType Type=ControlType::Cascade;
+
+  PidEngine pid;  // outer loop, its output is the offset of the inner target from the set temperature
+
+  CascadeControl(const char *_name, IControlAction *_action, double *set, double *actual, double *innerTarget, double Kp, double Ki, double offset);
+  void SetTrim(double _trimGain, double _trimMax);
+  void Control(bool started, unsigned long now);
+
+protected:
+  double *set,*actual,*innerTarget,output;
+  double trimGain;  // stone heater duty for each degree below the set temperature
+  double trimMax;   // maximum duty of the stone heater
+  bool oldstarted;
+};
+
+#endif
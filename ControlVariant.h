@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _ControlVariant_h_
+#define _ControlVariant_h_
+
+// Storage of the control of a zone, constructed in place and dispatched without virtual calls: the control types
+// are fixed at compile time in the template arguments, the one in use is tagged with its ControlType (each control
+// declares it in Type) and Control() is a chain of comparisons of the tag ending in a direct call (the bodies are in
+// their own translation units, so they are not inlined). There is no vtable nor vptr in the controls and no heap
+// allocation. It is not faster than the virtual calls on a host cpu, see tools/control_dispatch.
+
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+#include "IControl.h"
+
+
+template <class... Ts> struct ControlStorage;
+
+template <class T> struct ControlStorage<T> {
+  static const size_t size=sizeof(T);
+  static const size_t align=alignof(T);
+};
+
+template <class T, class... Rest> struct ControlStorage<T,Rest...> {
+  static const size_t size=(sizeof(T)>ControlStorage<Rest...>::size)?sizeof(T):ControlStorage<Rest...>::size;
+  static const size_t align=(alignof(T)>ControlStorage<Rest...>::align)?alignof(T):ControlStorage<Rest...>::align;
+};
+
+
+template <class... Ts> class ControlVariant {
+public:
+  ControlVariant() {
+    type=ControlType::None;
+  }
+
+  ~ControlVariant() {
+    Clear();
+  }
+
+  // destroys the current control and constructs the new one in place
+  template <class T, class... Args> T *Emplace(Args... args) {
+    static_assert(sizeof(T)<=sizeof(storage),"control larger than the storage");
+
+    Clear();
+    T *c=new (storage) T(args...);
+    type=T::Type;
+
+    return c;
+  }
+
+  void Clear() {
+    if (type!=ControlType::None)
+      Destroy<Ts...>();
+    type=ControlType::None;
+  }
+
+  bool IsEmpty() {
+    return type==ControlType::None;
+  }
+
+  ControlType GetControlType() {
+    return type;
+  }
+
+  void Control(bool started, unsigned long now) {
+    Dispatch<Ts...>(started,now);
+  }
+
+  // the control if it is a T or derived from it (e.g. As<PidControl>() of a PidAutotuneControl), NULL otherwise
+  template <class T> T *As() {
+    return Find<T,Ts...>();
+  }
+
+  double GetDemand() {
+    IControl *c=As<IControl>();
+    return (c!=NULL)?c->GetDemand():0;
+  }
+
+  static size_t StorageSize() {
+    return ControlStorage<Ts...>::size;
+  }
+
+protected:
+  alignas(ControlStorage<Ts...>::align) unsigned char storage[ControlStorage<Ts...>::size];
+  ControlType type;
+
+  template <class T> void Dispatch(bool started, unsigned long now) {
+    if (type==T::Type)
+      ((T *) storage)->Control(started,now);
+  }
+
+  template <class T, class U, class... Rest> void Dispatch(bool started, unsigned long now) {
+    if (type==T::Type)
+      ((T *) storage)->Control(started,now);
+    else
+      Dispatch<U,Rest...>(started,now);
+  }
+
+  template <class T> void Destroy() {
+    if (type==T::Type)
+      ((T *) storage)->~T();
+  }
+
+  template <class T, class U, class... Rest> void Destroy() {
+    if (type==T::Type)
+      ((T *) storage)->~T();
+    else
+      Destroy<U,Rest...>();
+  }
+
+  template <class B, class T> typename std::enable_if<std::is_base_of<B,T>::value,B *>::type Cast() {
+    return static_cast<B *>((T *) storage);
+  }
+
+  template <class B, class T> typename std::enable_if<!std::is_base_of<B,T>::value,B *>::type Cast() {
+    return NULL;
+  }
+
+  template <class B, class T> B *Find() {
+    return (type==T::Type)?Cast<B,T>():NULL;
+  }
+
+  template <class B, class T, class U, class... Rest> B *Find() {
+    return (type==T::Type)?Cast<B,T>():Find<B,U,Rest...>();
+  }
+};
+
+#endif
@@ -25,8 +25,7 @@
 #include <ESP8266WiFi.h>
 #include <mem.h>
 #include "FS.h"
-#include <NTPClient.h>
-#include "WiFiUdp.h"
+#include <time.h>
 #include <string.h>
 #include <ArduinoJson.h>
 
@@ -34,8 +33,19 @@
 #include "PidAutotuneControl.h"
 #include "PidControl.h"
 #include "OnOffControl.h"
+#include "CascadeControl.h"
+#include "MpcControl.h"
 #include "configuration.h"
+#include "ProgramStore.h"
+#include "ScheduleStore.h"
 #include "LowPassFilter.h"
+#include "Zone.h"
+#include "RelayScheduler.h"
+#include "BurstFire.h"
+#include "Arena.h"
+#include "HeapMonitor.h"
+#include "ProbeSampler.h"
+#include "SafetySupervisor.h"
 
 #include "pitches.h"
 
@@ -43,13 +53,24 @@
 #define SSID  "<SSID>"         // wifi ssid to connect
 #define PASSWORD "<PASSWORD>"  // ssid password
 
-#define PID_WINDOW_SIZE 5000  // PID window size in ms
+#define PID_WINDOW_SIZE 5000  // default PID window size in ms
 
 #define NTP_OFFSET   60 * 60      // In seconds
-#define NTP_INTERVAL 60 * 1000    // In miliseconds
 #define NTP_ADDRESS  "europe.pool.ntp.org"
+#define NTP_VALID_TIME 1500000000UL  // epoch times before are not synced yet
+#define WIFI_RETRY 30000  // ms before a connection attempt is restarted
 
 #define DELTA 1  // OnOff delta abs value
+#define MPC_AMBIENT 20  // ambient temperature of the mpc model, its errors are absorbed by the bias
+
+//#define SERIAL_TRACE  // prints a TRACE line with the probe temperatures and the relay states at every sample (10 a second, input of tools/sysid), uncomment to capture a trace
+
+#define HTTP_LINE_SIZE    256   // request line and headers
+#define HTTP_BUFFER_SIZE  4608  // response buffer, it must contain the headers and the largest json
+#define HTTP_BODY_SIZE    4096  // largest POST body, the buffer also holds the serialized json returned by the cgis and the chunks of the files
+#define JSON_BUFFER_SIZE  HTTP_BODY_SIZE
+#define MIME_SIZE         64
+#define JSON_PARAMS_SIZE  384   // ArduinoJson document size for the parsed query string
 
 
 // ESP 8266
@@ -80,6 +101,17 @@
 #endif
 
 
+#if !defined(GPIO16_RELAY) || !defined(GPIO05_BUZZER)
+  #include <SparkFunSX1509.h>
+
+  #define USE_SX1509
+  #define SX1509_ADDRESS    0x3E
+  #define SX1509_PIN_BASE   100  // pins > 100 are on the sx1509
+
+  SX1509 sx1509;
+#endif
+
+
 // Board configuration (edit accordingly)
 
 #define PIN_RELAY_CHAMBER   PIN_RELAY1
@@ -90,8 +122,7 @@ MAX31855 probeStone(PIN_THERMO2);
 
 
 // State variables
-double tempChamber, tempStone, setChamber = 100, setStone=200,cjChamber=0, cjStone=0;
-int timer, starttimer, chamberStatus, stoneStatus;
+int timer, starttimer;
 bool started=false;
 
 unsigned long start; // test 
@@ -103,37 +134,90 @@ int ste=0;  // test
 
 WiFiServer server(80);
 
-// For ntp sync
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, NTP_ADDRESS, NTP_OFFSET, NTP_INTERVAL);
+// Wifi and time come up in the background, the zones are controlled from the first loop
+bool wifiConnected=false;
+unsigned long wifiAttempt=0;  // ms of the start of the current connection attempt, 0 none
+bool timeSynced=false;
+unsigned long firstTick=0;    // ms from boot to the first control tick, 0 not yet
+
+// the long-lived objects are static, see Arena.h
+Configuration confStore;
+Configuration *conf=&confStore;
+ProgramStore programStore;
+ProgramStore *programs=&programStore;
+ProgramRunner runner;
+int runningProgram=-1;  // index of the program driving the set temperatures, -1 none
+ScheduleStore scheduleStore;
+ScheduleStore *schedules=&scheduleStore;
+bool wasStarted=false;  // the learned heat-up curves are saved when the oven turns off
+SafetySupervisor supervisor;
+bool safetyReported=false;  // the trip has been logged
+
+// buffers of the http requests, static since one request is handled at a time
+struct RequestBuffers {
+  char line[HTTP_LINE_SIZE];    // request line and headers
+  char resp[HTTP_BUFFER_SIZE];  // response
+  char body[HTTP_BODY_SIZE];    // post body, json of the get cgis or chunk of a file
+  char mime[MIME_SIZE];
+} request;
+
+
+// pin access of the IControlAction, pins above SX1509_PIN_BASE are on the expander
+void ActionPinMode(int pin) {
+#ifdef USE_SX1509
+  if (pin>SX1509_PIN_BASE) {
+    sx1509.pinMode(pin-SX1509_PIN_BASE,OUTPUT);
+    return;
+  }
+#endif
+  pinMode(pin,OUTPUT);
+}
 
-Configuration *conf;
 
-IControl *chamberControl,*stoneControl;
-LowPassFilter *chamberTempFilter,*stoneTempFilter;
+int ActionRead(int pin) {
+#ifdef USE_SX1509
+  if (pin>SX1509_PIN_BASE)
+    return sx1509.digitalRead(pin-SX1509_PIN_BASE);
+#endif
+  return digitalRead(pin);
+}
 
 
-class RelayAction: public IControlAction {
+void ActionWrite(int pin, int value) {
+#ifdef USE_SX1509
+  if (pin>SX1509_PIN_BASE) {
+    sx1509.digitalWrite(pin-SX1509_PIN_BASE,value);
+    return;
+  }
+#endif
+  digitalWrite(pin,value);
+}
 
-public:    
-    RelayAction (int pin, bool reverse) : IControlAction (pin,reverse) { }
-    
-    virtual bool Active() override {
-      return (digitalRead(pin)==von)?true:false;
-    }
-    
-    virtual void On () override {
-      digitalWrite(pin,von);  
-    }
 
-    virtual void Off() override {
-      digitalWrite(pin,voff);        
-    }
+IControlAction actChamber(PIN_RELAY_CHAMBER,false); // arduino relay module has inverse logic LOW --> ON, HIGH --> OFF
+IControlAction actStone(PIN_RELAY_STONE,false); // arduino relay module has inverse logic LOW --> ON, HIGH --> OFF
+
+
+// Zone table: one entry for each heater with its probe and relay, extra zones may use relays on the sx1509 (up to MAX_ZONES)
+struct BoardZone {
+  const char *name;
+  MAX31855 *probe;
+  IControlAction *action;
 };
 
+BoardZone boardZones[] = {
+  { "chamber", &probeChamber, &actChamber },
+  { "stone",   &probeStone,   &actStone   }
+};
+
+#define NUM_ZONES ((int) (sizeof(boardZones)/sizeof(boardZones[0])))
+
+static_assert(NUM_ZONES<=MAX_ZONES, "boardZones has more zones than MAX_ZONES");
+static_assert(MAX_ZONES<=SAFETY_ZONES, "SafetySupervisor has less zones than MAX_ZONES");
 
-RelayAction actChamber(PIN_RELAY_CHAMBER,false); // arduino relay module has inverse logic LOW --> ON, HIGH --> OFF
-RelayAction actStone(PIN_RELAY_STONE,false); // arduino relay module has inverse logic LOW --> ON, HIGH --> OFF
+Zone zones[MAX_ZONES];
+RelayScheduler scheduler;
+MpcGroup mpcGroup;
 
 void setup()
 {
@@ -142,111 +226,337 @@ void setup()
 
   Serial.println("\n\nEspOven: V1.0\n");
   
-  pinMode(PIN_RELAY_CHAMBER, OUTPUT);
-  pinMode(PIN_RELAY_STONE, OUTPUT);
-
+#ifdef USE_SX1509
+  if (!sx1509.begin(SX1509_ADDRESS))
+    Serial.printf("EspOven: Error initializing SX1509\n");
+#endif
 
-  actChamber.Off();
-  actStone.Off();
+  for (int i=0;i<NUM_ZONES;i++) {
+    boardZones[i].action->Begin();
+    boardZones[i].action->Off();
+    zones[i].Begin(boardZones[i].name,boardZones[i].probe,boardZones[i].action);
+    Serial.printf("\n\nEspOven: zone %d %s relay %d\n",i,zones[i].name,boardZones[i].action->Active());
+  }
   
+#ifdef GPIO05_BUZZER
   pinMode(PIN_BUZZER, OUTPUT);
   digitalWrite(PIN_BUZZER,LOW);  // turn off the speaker
-
-  Serial.printf("\n\nEspOven: Chamber %d Stone %d\n",digitalRead(PIN_RELAY_CHAMBER),digitalRead(PIN_RELAY_STONE)); 
+#endif
   
   if (!SPIFFS.begin())
     Serial.printf("EspOven: Error mounting SPIFFS\n");
 
-  CheckConnectWifi();
-  //server.onNotFound(handleNotFound);
-
-  timeClient.begin();
-  timeClient.update();
-
-  server.begin();
-  Serial.printf("EspOven: Web server started, open %s in a web browser port 80\n", WiFi.localIP().toString().c_str());
-
-  conf=new Configuration();
-  if (!conf->Load()) {
-    // Default configuration if flash memory is uninitialised
-    conf->enable1=false;    // chamber heater and probe present
-    conf->enable2=true;     // stone heater and probe present
-    conf->kp1=100;          // PID KP constant for chamber heater control
-    conf->ki1=5;            // PID KI constant for chamber heater control
-    conf->kd1=1;            // PID KD constant for chamber heater control
-    conf->kp2=100;          // PID KP constant for stone heater control
-    conf->ki2=5;            // PID KI constant for stone heater control
-    conf->kd2=1;            // PID KD constant for stone heater control
-    conf->alpha1=0.3;       // Lowpass filter alpha value for chamber temperature
-    conf->alpha2=0.3;       // Lowpass filter alpha value for stone temperature
-    conf->control1=ControlType::OnOff;  // Control Type for chamber heater
-    conf->control2=ControlType::OnOff;  // Control Type for stone heater
+  conf->numZones=NUM_ZONES;
+  // Default configuration if flash memory is uninitialised (also used for the keys missing in the stored one)
+  for (int i=0;i<MAX_ZONES;i++) {
+    ZoneConfiguration &zc=conf->zones[i];
+
+    zc.enable=(i==1);               // heater and probe present: by default only the stone (zone 1)
+    zc.kp=120;                      // PID KP constant for heater control
+    zc.ki=1;                        // PID KI constant for heater control (per second)
+    zc.kd=200;                      // PID KD constant for heater control (seconds)
+    zc.alpha=0.3;                   // Lowpass filter alpha value for temperature
+    zc.spWeight=1;                  // PID setpoint weight (lower values reduce overshoot on set changes)
+    zc.dFilter=10;                  // PID derivative filter (derivative time constant Kd/Kp/dFilter)
+    zc.ffWeight=0;                  // PID feed forward from the gain schedule duty, disabled
+    memset(zc.gains,0,sizeof(zc.gains));  // PID gain schedule by set temperature, empty: kp, ki, kd are used
+    zc.control=ControlType::OnOff;  // Control Type for heater
+    zc.cascadeZone=0;               // Cascade: the stone drives the target of the chamber (zone 0)
+    zc.cascadeKp=2;                 // Cascade: outer pid KP (degrees of chamber target for each degree of stone error)
+    zc.cascadeKi=0.005;             // Cascade: outer pid KI (per second)
+    zc.cascadeOffset=50;            // Cascade: chamber target within stone set +- 50 degrees
+    zc.trimGain=0.05;               // Cascade: stone heater duty for each degree below set
+    zc.trimMax=1;                   // Cascade: maximum stone heater duty
+    zc.smith=false;                 // Smith predictor disabled, model from a step response of the zone:
+    zc.smithGain=(i==1)?370:360;    //   steady state rise with the heater always on (C)
+    zc.smithTau=(i==1)?3150:1700;   //   time constant (s)
+    zc.smithDeadTime=(i==1)?100:40; //   dead time including the thermocouple lag (s)
+    zc.mpcGain=(i==1)?0.125:0.67;   // MPC model: C/s with the heater on (the stone is much slower than the chamber)
+    zc.mpcLoss=(i==1)?0.0001:0.0013;  // MPC model: heat loss to the ambient (1/s)
+    zc.mpcCoupling=(i==1)?0.0005:0.002; // MPC model: heat exchange with the other zone (1/s)
+    zc.mpcLag=(i==1)?100:40;        // MPC model: lag of the probe (s)
+    zc.power=2000;                  // Heater power in W
+    zc.output=OutputMode::Relay;    // Relay time proportioning (OutputMode::Burst for SSR)
+    zc.probe2=-1;                   // Second probe of the zone, e.g. 1 for the idle stone probe in the chamber
+    zc.probeTolerance=PROBE_TOLERANCE;  // Two probes more than 10 degrees apart are not averaged
   }
+
+  conf->windowSize=PID_WINDOW_SIZE; // relay time proportioning window
+  conf->minOnTime=0;                // minimum relay on time in ms
+  conf->minOffTime=0;               // minimum relay off time in ms
+  conf->powerBudget=0;              // total power of the heaters in W, 0 no limit
+  conf->burstSlot=10;               // SSR burst firing slot, a half-cycle of 50Hz mains
+  conf->pidSampleTime=1000;         // PID computed at most once a second
+  conf->mpcStep=10;                 // MPC step of 10s
+  conf->mpcHorizon=20;              // MPC prediction over 20 steps
+  conf->mpcMoves=3;                 // MPC duty changes in the first 3 steps, then held
+  conf->mpcMoveWeight=1000;         // MPC weight of the duty changes
+
+  zones[0].set=100;
+  zones[1].set=200;
+
+  conf->Load();
+
+  programs->Load(NUM_ZONES);
+  schedules->Load(NUM_ZONES);
+  LoadHeatup();
   
   UpdateParams();
+  ReportArena();
+
+  // the zones are controlled from the samples of the timer
+  MAX31855 *probes[MAX_ZONES];
+  for (int i=0;i<NUM_ZONES;i++)
+    probes[i]=zones[i].GetProbe();
+  supervisor.Reset(millis());
+  probeSampler.Begin(probes,NUM_ZONES,SAMPLE_PERIOD,SuperviseSample);
+
+  // network last and without waiting: the loop polls the connection and the sntp of the core syncs the clock
+  configTime(0, 0, NTP_ADDRESS);
+  CheckConnectWifi();
+  server.begin();
+  //server.onNotFound(handleNotFound);
+  Serial.printf("EspOven: setup done in %lu ms\n", millis());
   
   start=millis();
 }
 
 
 
+// parameters of a pid applied in place, the gains and the setpoint weight with bumpless transfer, while the smith
+// predictor restarts only when its model changes
+PidControl *ConfigurePid(PidControl *c, ZoneConfiguration &zc, ZoneConfiguration *old=NULL) {
+  c->pid.SetTunings(zc.kp,zc.ki,zc.kd);
+  c->pid.SetSetpointWeight(zc.spWeight);
+  c->pid.SetDerivativeFilter(zc.dFilter);
+  c->pid.SetSampleTime(conf->pidSampleTime);
+  c->SetGainSchedule(zc.gains,MAX_GAIN_POINTS,zc.ffWeight);
+  if (old==NULL || zc.smith!=old->smith || zc.smithGain!=old->smithGain || zc.smithTau!=old->smithTau || zc.smithDeadTime!=old->smithDeadTime)
+    c->smith.SetModel(zc.smith?FopdtModel{ zc.smithGain, zc.smithTau, zc.smithDeadTime }:FopdtModel{ 0, 0, 0 });
+
+  return c;
+}
+
+
+
+Configuration applied;    // configuration of the live controllers and outputs
+bool appliedValid=false;
+
+
+// the outputs are attached again when their parameters change, resetting their windows and statistics
+bool OutputsChanged() {
+  if (!appliedValid || conf->windowSize!=applied.windowSize || conf->minOnTime!=applied.minOnTime || conf->minOffTime!=applied.minOffTime ||
+      conf->powerBudget!=applied.powerBudget || conf->burstSlot!=applied.burstSlot)
+    return true;
+
+  for (int i=0;i<NUM_ZONES;i++) {
+    ZoneConfiguration &zc=conf->zones[i],&ac=applied.zones[i];
+
+    if (zc.enable!=ac.enable || zc.output!=ac.output || zc.power!=ac.power)
+      return true;
+  }
+
+  return false;
+}
+
+
+// the mpc engine is configured again, and its zones get new controls, when its model changes
+bool MpcChanged() {
+  if (!appliedValid || conf->mpcStep!=applied.mpcStep || conf->mpcHorizon!=applied.mpcHorizon || conf->mpcMoves!=applied.mpcMoves ||
+      conf->mpcMoveWeight!=applied.mpcMoveWeight || conf->powerBudget!=applied.powerBudget)
+    return true;
+
+  for (int i=0;i<NUM_ZONES;i++) {
+    ZoneConfiguration &zc=conf->zones[i],&ac=applied.zones[i];
+    bool mpc=zc.enable && zc.control==ControlType::MPC;
+
+    if (mpc!=(ac.enable && ac.control==ControlType::MPC))
+      return true;
+    if (mpc && (zc.mpcGain!=ac.mpcGain || zc.mpcLoss!=ac.mpcLoss || zc.mpcCoupling!=ac.mpcCoupling || zc.mpcLag!=ac.mpcLag || zc.power!=ac.power))
+      return true;
+  }
+
+  return false;
+}
+
+
+// Applies the configuration to the live objects. Only a change of the control type (or of what a control is built
+// on: enable, relay window, cascade zone, mpc model) creates a new control, the other parameters are applied in place
+// so the pid integrals and the filters are kept, e.g. to tune the gains during a bake.
 void UpdateParams() {  
-  // Low pass filters
-  if (chamberTempFilter!=NULL)
-    delete chamberTempFilter;
+  bool outputsChanged=OutputsChanged(),mpcChanged=MpcChanged();
 
-  if (stoneTempFilter!=NULL)
-    delete stoneTempFilter;
+  if (outputsChanged) {
+    scheduler.Begin(conf->windowSize,conf->minOnTime,conf->minOffTime,conf->powerBudget);
+    burstFire.Begin(conf->burstSlot);
+  }
 
-  chamberTempFilter=new LowPassFilter(conf->alpha1);
-  stoneTempFilter=new LowPassFilter(conf->alpha2);
+  for (int i=0;i<NUM_ZONES;i++)
+    zones[i].cascaded=false;
 
-  // Chamber control
-  if (chamberControl!=NULL)
-    delete chamberControl;
+  // the enabled zones with mpc control share a single model, in the order of the zones
+  MpcZoneModel mpcModel[MPC_ZONES];
+  int mpcIndex[MAX_ZONES],mpcZones=0;
 
-  if (conf->control1==ControlType::OnOff)
-    chamberControl=new OnOffControl("chamber",&actChamber,&setChamber,&tempChamber,DELTA);
-  else if (conf->control1==ControlType::PID)
-    chamberControl=new PidControl("chamber",&actChamber,&setChamber,&tempChamber,conf->kp1,conf->ki1,conf->kd1,PID_WINDOW_SIZE);
-  else
-    chamberControl=new PidAutotuneControl("chamber",&actChamber,&setChamber,&tempChamber,conf->kp1,conf->ki1,conf->kd1,PID_WINDOW_SIZE);
+  for (int i=0;i<NUM_ZONES;i++) {
+    ZoneConfiguration &zc=conf->zones[i];
 
-  
-  // Stone control
-  if (stoneControl!=NULL)
-    delete stoneControl;
-  
-  if (conf->control2==ControlType::OnOff)
-    stoneControl=new OnOffControl("stone",&actStone,&setChamber,&tempChamber,DELTA);
-  else if (conf->control2==ControlType::PID)
-    stoneControl=new PidControl("stone",&actStone,&setChamber,&tempChamber,conf->kp2,conf->ki2,conf->kd2,PID_WINDOW_SIZE);  
-  else
-    stoneControl=new PidAutotuneControl("stone",&actStone,&setChamber,&tempChamber,conf->kp2,conf->ki2,conf->kd2,PID_WINDOW_SIZE);  
-    
+    mpcIndex[i]=-1;
+    if (!zc.enable || zc.control!=ControlType::MPC)
+      continue;
+
+    if (mpcZones==MPC_ZONES) {
+      Serial.printf("EspOven: zone %s exceeds the %d zones of the mpc model, using PID control\n",zones[i].name,MPC_ZONES);
+      zc.control=ControlType::PID;
+      continue;
+    }
+
+    mpcModel[mpcZones]={ zc.mpcGain, zc.mpcLoss, zc.mpcCoupling, zc.mpcLag, zc.power };
+    mpcIndex[i]=mpcZones++;
+  }
+
+  if (mpcChanged && mpcZones>0 && !mpcGroup.engine.Configure(mpcZones,mpcModel,conf->mpcStep,conf->mpcHorizon,conf->mpcMoves,conf->mpcMoveWeight,conf->powerBudget,MPC_AMBIENT)) {
+    Serial.printf("EspOven: invalid mpc parameters, using PID control\n");
+    for (int i=0;i<NUM_ZONES;i++)
+      if (conf->zones[i].control==ControlType::MPC)
+        conf->zones[i].control=ControlType::PID;
+  }
+
+  for (int i=0;i<NUM_ZONES;i++) {
+    Zone &z=zones[i];
+    ZoneConfiguration &zc=conf->zones[i];
+    ZoneConfiguration &ac=applied.zones[i];
+
+    // Low pass filter
+    z.filter.SetAlpha(zc.alpha);
+
+    // the probe of another board zone as a second probe, the zone then keeps working if one of them fails
+    z.SetSecondProbe((zc.probe2>=0 && zc.probe2<NUM_ZONES && zc.probe2!=i)?zc.probe2:-1,zc.probeTolerance);
+
+    z.enabled=zc.enable;
+    if (!z.enabled)
+      z.GetAction()->Off();
+
+#ifdef USE_SX1509
+    // the timer interrupt can't drive the sx1509
+    if (zc.output==OutputMode::Burst && z.GetAction()->GetPin()>SX1509_PIN_BASE) {
+      Serial.printf("EspOven: zone %s burst firing not available on sx1509 pins, using relay output\n",z.name);
+      zc.output=OutputMode::Relay;
+    }
+#endif
+
+    if (outputsChanged) {
+      if (zc.output==OutputMode::Burst)
+        burstFire.Attach(i,z.GetAction());
+      else
+        scheduler.Attach(i,z.GetAction(),zc.power);
+    }
+
+    // the inner zone of a cascade must be another enabled zone not in cascade itself
+    if (zc.control==ControlType::Cascade) {
+      int inner=zc.cascadeZone;
+
+      if (inner<0 || inner>=NUM_ZONES || inner==i || !conf->zones[inner].enable || conf->zones[inner].control==ControlType::Cascade) {
+        Serial.printf("EspOven: zone %s invalid cascade zone %d, using PID control\n",z.name,inner);
+        zc.control=ControlType::PID;
+      }
+      else
+        zones[inner].cascaded=true;
+    }
+
+    bool rebuild=!appliedValid || zc.enable!=ac.enable || zc.control!=ac.control || conf->windowSize!=applied.windowSize ||
+      (zc.control==ControlType::Cascade && zc.cascadeZone!=ac.cascadeZone) || (zc.control==ControlType::MPC && mpcChanged);
+
+    if (!rebuild) {
+      Serial.printf("EspOven: zone %s parameters applied in place\n",z.name);
+
+      if (zc.control==ControlType::PID || zc.control==ControlType::PIDAutotune)
+        ConfigurePid(z.GetControl().As<PidControl>(),zc,&ac);
+      else if (zc.control==ControlType::Cascade) {
+        CascadeControl *c=z.GetControl().As<CascadeControl>();
+
+        c->pid.SetTunings(zc.cascadeKp,zc.cascadeKi,0);
+        c->pid.SetOutputLimits(-zc.cascadeOffset,zc.cascadeOffset);
+        c->pid.SetSampleTime(conf->pidSampleTime);
+        c->SetTrim(zc.trimGain,zc.trimMax);
+      }
+
+      continue;
+    }
+
+    // Control
+    if (zc.control==ControlType::OnOff)
+      z.GetControl().Emplace<OnOffControl>(z.name,z.GetAction(),&z.target,&z.actual,DELTA);
+    else if (zc.control==ControlType::PID)
+      ConfigurePid(z.GetControl().Emplace<PidControl>(z.name,z.GetAction(),&z.target,&z.actual,zc.kp,zc.ki,zc.kd,conf->windowSize),zc);
+    else if (zc.control==ControlType::Cascade) {
+      Zone &inner=zones[zc.cascadeZone];
+      CascadeControl *c=z.GetControl().Emplace<CascadeControl>(z.name,z.GetAction(),&z.target,&z.actual,&inner.target,zc.cascadeKp,zc.cascadeKi,zc.cascadeOffset);
+
+      c->SetTrim(zc.trimGain,zc.trimMax);
+      c->pid.SetSampleTime(conf->pidSampleTime);
+    }
+    else if (zc.control==ControlType::MPC)
+      z.GetControl().Emplace<MpcControl>(z.name,z.GetAction(),&mpcGroup,mpcIndex[i],&z.target,&z.actual);
+    else
+      ConfigurePid(z.GetControl().Emplace<PidAutotuneControl>(z.name,z.GetAction(),&z.target,&z.actual,zc.kp,zc.ki,zc.kd,conf->windowSize),zc);
+  }
+
+  applied=*conf;
+  appliedValid=true;
 }
 
 
 
+// never blocks: starts a connection attempt and polls it from the loop, restarting it after WIFI_RETRY
 void CheckConnectWifi()
 {
-  if (WiFi.status() != WL_CONNECTED) {
+  if (WiFi.status() == WL_CONNECTED) {
+    if (!wifiConnected) {
+      wifiConnected=true;
+      wifiAttempt=0;
+      Serial.printf("EspOven: Connected at %lu ms, IP address: %s Hostname %s\n", millis(), WiFi.localIP().toString().c_str(),WiFi.hostname().c_str());
+      Serial.printf("EspOven: Web server started, open %s in a web browser port 80\n", WiFi.localIP().toString().c_str());
+    }
+    return;
+  }
+
+  if (wifiConnected) {
+    // the core reconnects by itself, give it a full attempt before restarting
+    wifiConnected=false;
+    wifiAttempt=millis()|1;
+    Serial.printf("EspOven: Wifi connection lost\n");
+    return;
+  }
+
+  if (wifiAttempt==0 || millis()-wifiAttempt>WIFI_RETRY) {
+    if (wifiAttempt!=0)
+      Serial.printf("EspOven: No connection to %s after %d ms, retrying\n", SSID, WIFI_RETRY);
     WiFi.mode(WIFI_STA);
     WiFi.hostname("espoven");
     WiFi.begin(SSID, PASSWORD);
-  
-    Serial.printf("EspOven: Connecting to %s", SSID);
-    while (WiFi.status() != WL_CONNECTED)
-    {
-      delay(500);
-      Serial.print(".");
-    }
-    Serial.printf("\nEspOven: Connected, IP address: %s Hostname %s\n", WiFi.localIP().toString().c_str(),WiFi.hostname().c_str());
+    wifiAttempt=millis()|1;
+    Serial.printf("EspOven: Connecting to %s\n", SSID);
   }
 }
 
 
 
+// local time in seconds from the epoch, below NTP_VALID_TIME until the sntp of the core has synced
+unsigned long LocalTime() {
+  time_t now=time(nullptr);
+
+  if (now<(time_t)NTP_VALID_TIME)
+    return now;
+  if (!timeSynced) {
+    timeSynced=true;
+    Serial.printf("EspOven: Time synced at %lu ms\n", millis());
+  }
+  return now+NTP_OFFSET;
+}
+
+
+
 
 // very simple
 void GetMimeTypeFromFile(char *path, char *mime) {
@@ -282,7 +592,7 @@ void GetMimeTypeFromFile(char *path, char *mime) {
 
 char tstamp[32];
 char *getTimestamp() {
-  unsigned long rawTime = timeClient.getEpochTime();
+  unsigned long rawTime = LocalTime();
 
   sprintf(tstamp, "%02d:%02d:%02d.%03d", (rawTime % 86400L) / 3600, (rawTime % 3600) / 60, rawTime % 60, millis() % 1000);
 
@@ -316,55 +626,152 @@ void parseQueryString(char *querystring, JsonObject ht) {
 
 
 
+// writes a 200 OK response with the json in buf
+void JsonResponse(char *resp, const char *buf) {
+  sprintf(resp, "HTTP/1.1 200 OK\nServer: EspOven (Esp8266)\nContent-Length: %d\nConnection: Closed\nCache-Control: no-cache, no-store, must-revalidate\nContent-Type: application/json\n\n%s", strlen(buf), buf);
+}
+
+
+
+// the json returned by the get cgis is serialized in the buffer of the post body, the post cgis only use the body
 bool HandleCGI(char *path, char *resp, char *body) {
-  char buf[256];
+  HeapScope scope(HeapSubsystem::Http);
+  char *buf = request.body;
   bool handled = true;
 
-  StaticJsonDocument<128> jsonBuffer;
+  StaticJsonDocument<JSON_PARAMS_SIZE> jsonBuffer;
   JsonObject ht = jsonBuffer.to<JsonObject>();
 
   if (strncmp(path, "/getsensordata.cgi", 18) == 0) {
     // JSON object
-    sprintf(buf, "{ \"tempChamber\":%f, \"tempStone\":%f,\"timer\":%d,\"chamberStatus\":%d, \"stoneStatus\":%d, \"started\":%d }", tempChamber, tempStone, (timer!=0)?(timer-(millis()-starttimer)/1000):0, chamberStatus,stoneStatus, started);
+    JsonObject root = jsonArena.to<JsonObject>();
+
+    root["timer"] = (timer!=0)?(timer-(millis()-starttimer)/1000):0;
+    root["started"] = started?1:0;
+    root["program"] = runningProgram;
+    root["time"] = LocalTime();
+    root["firstTick"] = firstTick;
+    root["safety"] = SafetySupervisor::GetFaultName(supervisor.GetFault());
+    root["safetyZone"] = supervisor.GetZone();
+    probeSampler.GetJson(root.createNestedObject("sampling"));
+
+    JsonArray zs = root.createNestedArray("zones");
+    for (int i=0;i<NUM_ZONES;i++) {
+      JsonObject z = zs.createNestedObject();
+
+      zones[i].GetJson(z);
+      if (runningProgram>=0) {
+        z["segment"] = runner.GetSegment(i);
+        z["phase"] = (int) runner.GetPhase(i);
+        z["hold"] = runner.GetHoldRemaining(i,millis());
+      }
+      if (conf->zones[i].output==OutputMode::Burst)
+        burstFire.GetJson(i, z);
+      else
+        scheduler.GetJson(i, z);
+    }
 
-    sprintf(resp, "HTTP/1.1 200 OK\nServer: EspOven (Esp8266)\nContent-Length: %d\nConnection: Closed\nCache-Control: no-cache, no-store, must-revalidate\nContent-Type: application/json\n\n%s", strlen(buf), buf);
+    serializeJson(root, buf, JSON_BUFFER_SIZE);
+    JsonResponse(resp, buf);
+  }
+  else if (strncmp(path, "/getautotune.cgi", 16) == 0) {
+    // progress of the zones with autotune control
+    JsonObject root = jsonArena.to<JsonObject>();
+
+    JsonArray zs = root.createNestedArray("zones");
+    for (int i=0;i<NUM_ZONES;i++)
+      if (zones[i].enabled && zones[i].GetControl().GetControlType()==ControlType::PIDAutotune)
+        zones[i].GetControl().As<PidAutotuneControl>()->GetJson(zs.createNestedObject());
+
+    serializeJson(root, buf, JSON_BUFFER_SIZE);
+    JsonResponse(resp, buf);
+  }
+  else if (strncmp(path, "/getheap.cgi", 12) == 0) {
+    // heap telemetry: current values, low-water marks, subsystems and history
+    JsonObject root = jsonArena.to<JsonObject>();
+
+    heapMonitor.GetJson(root);
+
+    serializeJson(root, buf, JSON_BUFFER_SIZE);
+    JsonResponse(resp, buf);
+  }
+  else if (strncmp(path, "/getprograms.cgi", 16) == 0) {
+    programs->GetJson(buf,JSON_BUFFER_SIZE);
+
+    JsonResponse(resp, buf);
+  }
+  else if (strncmp(path, "/setprograms.cgi", 16) == 0) {
+    if (runningProgram<0) {
+      bool res=programs->SetJson(body,NUM_ZONES);
+      if (res)
+        programs->Save();
+
+      JsonResponse(resp, res?"true":"false");
+    }
+    else
+      sprintf(resp,"HTTP/1.1 405 Not Allowed\nPrograms can only be changed when no program is running\nConnection: Closed\n\n");
+  }
+  else if (strncmp(path, "/getschedules.cgi", 17) == 0) {
+    schedules->GetJson(buf,JSON_BUFFER_SIZE,true);
+
+    JsonResponse(resp, buf);
+  }
+  else if (strncmp(path, "/setschedules.cgi", 17) == 0) {
+    bool res=schedules->SetJson(body,NUM_ZONES);
+    if (res)
+      schedules->Save();
+
+    JsonResponse(resp, res?"true":"false");
+  }
+  else if (strncmp(path, "/runprogram.cgi", 15) == 0) {
+    path += 16; // we skip url
+    parseQueryString(path, ht);
+
+    // program=n starts the program n (and the oven), a negative one stops the running program
+    int n = ht["program"].isNull() ? -1 : ht["program"].as<int>();
+    bool res = true;
+
+    if (n<0)
+      StopProgram();
+    else
+      res = StartProgram(n);
+
+    JsonResponse(resp, res?"true":"false");
   }
   else if (strncmp(path, "/getconf.cgi", 12) == 0) {
-    conf->GetJson(buf,256);
+    conf->GetJson(buf,JSON_BUFFER_SIZE);
     
-    sprintf(resp, "HTTP/1.1 200 OK\nServer: EspOven (Esp8266)\nContent-Length: %d\nConnection: Closed\nCache-Control: no-cache, no-store, must-revalidate\nContent-Type: application/json\n\n%s", strlen(buf), buf);
+    JsonResponse(resp, buf);
   }
   else if (strncmp(path, "/setconf.cgi", 12) == 0) {
-    if (!started) {
-      bool res=conf->SetJson(body);
-      if (res) {
-        conf->Save();
-        UpdateParams();
-      }
-      
-      const char *result=res?"true":"false";   
-      sprintf(resp, "HTTP/1.1 200 OK\nServer: EspOven (Esp8266)\nContent-Length: %d\nConnection: Closed\nCache-Control: no-cache, no-store, must-revalidate\nContent-Type: application/json\n\n%s",strlen(result),result);
+    // also while the oven is on, the controls keep their state unless their type changes
+    bool res=conf->SetJson(body);
+    if (res) {
+      conf->Save();
+      UpdateParams();
     }
-    else
-      sprintf(resp,"HTTP/1.1 405 Not Allowed\nConfiguration can only be changed when oven is turned off\nConnection: Closed\n\n");           
+    
+    JsonResponse(resp, res?"true":"false");
   }
   else if (strncmp(path, "/setparams.cgi", 14) == 0) {
     path += 15; // we skip url
     parseQueryString(path, ht);
 
-    int c, s;
+    // set temperatures are passed as set0, set1, ... one for each zone
+    for (int i=0;i<NUM_ZONES;i++) {
+      char key[8];
 
-    c = ht["setChamber"].as<int>();
-    s = ht["setStone"].as<int>();
+      sprintf(key, "set%d", i);
+      int t = ht[key].as<int>();
 
-    Serial.printf("EspOven: setparams.cgi parsed setChamber %d setStone %d timer %d started %d\n", c,s, ht["timer"].as<int>(), ht["started"].as<int>());
+      Serial.printf("EspOven: setparams.cgi parsed zone %s %s %d\n", zones[i].name, key, t);
 
-    // basic checks on temperature
-    if (c > 20 && c < 380)
-      setChamber = c;
+      // basic checks on temperature
+      if (t >= MIN_SET_TEMP && t <= MAX_SET_TEMP)
+        zones[i].set = t;
+    }
 
-    if (s > 20 && s < 380)
-      setStone = s;
+    Serial.printf("EspOven: setparams.cgi parsed timer %d started %d\n", ht["timer"].as<int>(), ht["started"].as<int>());
 
     // if oven is turned on we can update the temperatures, but not the timer, we check on previous value
     if (!started) {
@@ -374,11 +781,18 @@ bool HandleCGI(char *path, char *resp, char *body) {
         starttimer=millis();
         Serial.printf("EspOven: Timer set %ds starttimer %d\n",timer,starttimer);
       }
+
+      if (ht["started"].as<int>()) {
+        ResetStats();
+        ResetSafety();
+      }
     }
     
     started = ht["started"].as<int>();
-    if (started==0)
+    if (started==0) {
       timer=0;
+      StopProgram();
+    }
 
     sprintf(resp, "HTTP/1.1 200 OK\nServer: EspOven (Esp8266)\nContent-Length: 0\nCache-Control: no-cache, no-store, must-revalidate\nConnection: Closed\n\n");
   }
@@ -389,10 +803,18 @@ bool HandleCGI(char *path, char *resp, char *body) {
 }
 
 
+// static ram of the arenas, the linker reports the total as "Global variables use"
+void ReportArena() {
+  Serial.printf("EspOven: static arena: zones %u (control %u each), json document %u, request buffers %u, configuration %u, programs %u, schedules %u, heap monitor %u bytes\n",
+    sizeof(zones), ZoneControl::StorageSize(), sizeof(jsonArena), sizeof(request), sizeof(confStore), sizeof(programStore), sizeof(scheduleStore), sizeof(heapMonitor));
+}
+
+
+
 void handleHttpRequests() {
   int i, len, k;
   char *meth, *path, *ver;
-  char *buf, *resp, *mime,*body;
+  char *buf = request.body, *resp = request.resp, *mime = request.mime, *body = request.body;
   unsigned long start, elapsed;
   double speed;
   File f;
@@ -403,7 +825,9 @@ void handleHttpRequests() {
     return;
   }
 
-  Serial.printf("\nEspOven: Client connected from %s:%d (freeheap %d)\n", client.remoteIP().toString().c_str(), client.remotePort(), ESP.getFreeHeap());
+  // the address is printed from its bytes, toString would build a String on the heap at every request
+  IPAddress ip = client.remoteIP();
+  Serial.printf("\nEspOven: Client connected from %u.%u.%u.%u:%d (freeheap %d)\n", ip[0], ip[1], ip[2], ip[3], client.remotePort(), ESP.getFreeHeap());
 
   if (client.connected()) {
     // Wait 30ms to allow the client to send some data
@@ -412,28 +836,26 @@ void handleHttpRequests() {
     while (!client.available()) {
       yield();
       if ((millis() - i) > 30) {
-        Serial.printf("EspOven: client %s timeout, disconnecting client\n", client.remoteIP().toString().c_str());
+        Serial.printf("EspOven: client %u.%u.%u.%u timeout, disconnecting client\n", ip[0], ip[1], ip[2], ip[3]);
         client.stop();
         return;
       }
     }
 
     // read first line of request by client
-    String req = client.readStringUntil('\r'); // readString();
-    Serial.printf("EspOven: received request:\n%s\n", &req[0]);
+    request.line[client.readBytesUntil('\r', request.line, HTTP_LINE_SIZE-1)] = 0;
+    Serial.printf("EspOven: received request:\n%s\n", request.line);
 
-    meth = strtok(&req[0], " ");
+    meth = strtok(request.line, " ");
     path = strtok(NULL, " ");
     ver = strtok(NULL, " ");
 
     printf("EspOven: method %s path %s ver %s (freeheap %d)\n", meth, path, ver, ESP.getFreeHeap());
 
-    // AllocMemory
-
-    resp = (char *) os_malloc(512);
-    mime = (char *) os_malloc(64);
-
-    if (stricmp(meth, "GET") == 0) {
+    if (meth == NULL || path == NULL) {
+      client.print("HTTP/1.1 400 Bad Request\nConnection: Closed\n\n");
+    }
+    else if (stricmp(meth, "GET") == 0) {
       if (HandleCGI(path, resp, NULL)) {
         client.print(resp);
       }
@@ -445,6 +867,7 @@ void handleHttpRequests() {
       else {
         // since there is no preemptive multitasking and we need to send all file to the client we hope that the transfer won't take too much
         // otherwise all other functions (temperature control) will get stucked :( with short webpages and images it shouldn't be an issue.
+        HeapScope scope(HeapSubsystem::Files);
         f = SPIFFS.open(path, "r");
         GetMimeTypeFromFile(path, mime);
 
@@ -456,11 +879,9 @@ void handleHttpRequests() {
         sprintf(resp, "HTTP/1.1 200 OK\nServer: EspOven (Esp8266)\nContent-Length: %d\nConnection: Closed\nContent-Type: %s\n\n", len, mime);
         client.print(resp);
 
-        buf = (char *) os_malloc(8192);
-
         k = 0;
         while (f.available() > 0) {
-          i = f.readBytes(buf, 8192);
+          i = f.readBytes(buf, HTTP_BODY_SIZE);
 
           client.write((const uint8_t *) buf, i);
         }
@@ -469,101 +890,403 @@ void handleHttpRequests() {
         speed = len / elapsed;
         Serial.printf("EspOven (%s): transferred %d bytes to client, elapsed %dms speed %.2f KB/s\n", getTimestamp(), len, elapsed, speed);
 
-        os_free(buf);
-
         f.close();
       }
     }
-    if (stricmp(meth, "POST") == 0) {
+    else if (stricmp(meth, "POST") == 0) {
         char *header,*value;
+        int contentLength=0;
         
         // Process headers
         while (true) {
-          String req = client.readStringUntil('\r');
-          header = strtok(&req[0], ":");
+          request.line[client.readBytesUntil('\r', request.line, HTTP_LINE_SIZE-1)] = 0;
+          header = strtok(request.line, ":");
           value = strtok(NULL, "\r");
 
-          Serial.printf("Read header %s value %s\n",header,value);
+          // skip the \n left by the previous line and the spaces before the value
+          while (header!=NULL && *header=='\n')
+            header++;
+          while (value!=NULL && *value==' ')
+            value++;
+
+          Serial.printf("Read header %s value %s\n",header?header:"",value?value:"");
           
-          if (strlen(header)==0)
+          if (header==NULL || strlen(header)==0)
             break;
-          else if (stricmp(header,"Content-Type")==0 && stricmp(value,"application/json")!=0) {
+          else if (stricmp(header,"Content-Type")==0 && (value==NULL || strncasecmp(value,"application/json",16)!=0)) {
             client.print("HTTP/1.1 405 Not Allowed\nAllow: GET, POST (only with application/json)\nConnection: Closed\n\n");           
             goto end;
           }
+          else if (stricmp(header,"Content-Length")==0 && value!=NULL)
+            contentLength=atoi(value);
         }
 
-        body = (char *) os_malloc(512);
-        client.readBytes(body,512);
+        if (contentLength<=0 || contentLength>=HTTP_BODY_SIZE) {
+          client.print("HTTP/1.1 413 Payload Too Large\nConnection: Closed\n\n");
+          goto end;
+        }
+
+        client.read();  // \n of the empty line
+
+        body[client.readBytes(body,contentLength)]=0;
         
         if (HandleCGI(path, resp, body)) {
           client.print(resp);
         }
-
-        os_free(body);
     }
     else {
       client.print("HTTP/1.1 405 Not Allowed\nAllow: GET, POST (only with application/json)\nConnection: Closed\n\n");
     }
 
 end:
-    os_free(resp);
-    os_free(mime);
+    ;
   }
 
   // close the connection:
-  Serial.printf("EspOven: Client %s:%d disconnecting (freeheap %d)\n", client.remoteIP().toString().c_str(), client.remotePort(), ESP.getFreeHeap());
+  Serial.printf("EspOven: Client %u.%u.%u.%u:%d disconnecting (freeheap %d)\n", ip[0], ip[1], ip[2], ip[3], client.remotePort(), ESP.getFreeHeap());
   client.stop();
 }
 
 
 
-void handleOvenHeating() {
-  //Serial.printf("EspOven: handleOvenHeating\n");
+// the demand goes to the actuator of the zone output mode
+void SetZoneDemand(int i, double demand) {
+  if (conf->zones[i].output==OutputMode::Burst)
+    burstFire.SetDemand(i,demand);
+  else
+    scheduler.SetDemand(i,demand);
+}
+
+
+
+void ResetStats() {
+  for (int i=0;i<NUM_ZONES;i++)
+    zones[i].stats.Reset();
+  scheduler.ResetStats();
+  burstFire.ResetStats();
+}
+
+
+
+// a program drives the set temperatures of the zones from their actual temperature, it turns on the oven
+bool StartProgram(int n) {
+  double actual[MAX_ZONES],set[MAX_ZONES];
+
+  if (n>=programs->numPrograms)
+    return false;
+
+  for (int i=0;i<NUM_ZONES;i++) {
+    actual[i]=zones[i].actual;
+    set[i]=zones[i].set;
+  }
+
+  if (!runner.Start(programs->programs[n],NUM_ZONES,actual,set,millis())) {
+    Serial.printf("EspOven: program %d not valid for the zones\n",n);
+    return false;
+  }
+
+  for (int i=0;i<NUM_ZONES;i++)
+    zones[i].set=set[i];
+
+  if (!started) {
+    ResetStats();
+    ResetSafety();
+  }
+  started=true;
+  timer=0;
+  runningProgram=n;
+
+  Serial.printf("EspOven: program %d %s started\n",n,programs->programs[n].name);
+  return true;
+}
+
+
 
-  if (conf->enable1) {
-    probeChamber.sampleProbe();
-    chamberStatus = probeChamber.checkStatus();
+// runs in the sampling timer: the heaters are switched off at once, loop() then stops the oven (SafetyStop)
+void SuperviseSample(const ProbeSample &sample) {
+  SafetyInput in[MAX_ZONES];
 
-    if (chamberStatus == MAX31855::OK) {
-      tempChamber = probeChamber.readTemp();
+  for (int i=0;i<NUM_ZONES;i++) {
+    int s=zones[i].GetSecondProbe();
+
+    in[i].enabled=zones[i].enabled;
+    in[i].probeOk=!MAX31855::rawFault(sample.status[i]);
+    in[i].temp=MAX31855::rawTemp(sample.status[i]);
+    in[i].set=zones[i].target;
+    in[i].heating=zones[i].GetAction()->Active();
+    in[i].word=sample.status[i];
+
+    // a zone with two probes faults only when both do, and is as hot as the hotter one, and it is frozen only when
+    // both words are
+    if (s>=0 && !MAX31855::rawFault(sample.status[s])) {
+      double t2=MAX31855::rawTemp(sample.status[s]);
+
+      in[i].temp=in[i].probeOk?fmax(in[i].temp,t2):t2;
+      in[i].probeOk=true;
+      in[i].word^=(sample.status[s]<<1)|(sample.status[s]>>31);
     }
-      
-    cjChamber = probeChamber.readCJTemp();
+  }
+
+  if (supervisor.Check(sample.ms,in,NUM_ZONES))
+    HeatersOff();
+}
 
-    double tempChamberSmoothed=chamberTempFilter->GetFilteredValue(tempChamber);
 
-    Serial.printf("EspOven: handleOvenHeating CHAMBER actual %f (smoothed %f) set %f cj %f status %d\n",tempChamber,tempChamberSmoothed,setChamber,cjChamber,chamberStatus);
+void HeatersOff() {
+  for (int i=0;i<NUM_ZONES;i++) {
+    SetZoneDemand(i,0);
+    zones[i].GetAction()->Off();
+  }
+}
 
-    tempChamber=tempChamberSmoothed;
 
-    chamberControl->Control(started);
+// the oven stays off until it is started again by the user
+void SafetyStop() {
+  HeatersOff();
+
+  if (started) {
+    started=false;
+    timer=0;
+    StopProgram();
   }
 
-  
-  if (conf->enable2) {
-     probeStone.sampleProbe();
-  
-     stoneStatus = probeStone.checkStatus();
+  if (!safetyReported) {
+    int z=supervisor.GetZone();
 
-     if (stoneStatus == MAX31855::OK) {
-        tempStone = probeStone.readTemp();
-     }
+    Serial.printf("\nEspOven: SAFETY TRIP %s zone %s at %lu ms, oven turned off\n\n",SafetySupervisor::GetFaultName(supervisor.GetFault()),(z>=0)?zones[z].name:"all",supervisor.GetTripTime());
+    safetyReported=true;
+  }
+}
 
-     cjStone = probeStone.readCJTemp();
 
-     double tempStoneSmoothed=chamberTempFilter->GetFilteredValue(tempStone);
+void ResetSafety() {
+  supervisor.Reset(millis());
+  safetyReported=false;
+}
 
-     Serial.printf("EspOven: handleOvenHeating STONE actual %f (smoothed %f) set %f cj %f status %d\n",tempStone,tempStoneSmoothed,setStone,cjStone,stoneStatus);
 
-     tempStone=tempStoneSmoothed;
 
-     stoneControl->Control(started);
+void StopProgram() {
+  if (runningProgram<0)
+    return;
+
+  runner.Stop();
+  Serial.printf("EspOven: program %d stopped\n",runningProgram);
+  runningProgram=-1;
+}
+
+
+
+// moves the set temperatures along the running program, at its end the oven keeps the last ones or turns off
+void UpdateProgram() {
+  double actual[MAX_ZONES],set[MAX_ZONES];
+
+  if (runningProgram<0)
+    return;
+
+  for (int i=0;i<NUM_ZONES;i++) {
+    actual[i]=zones[i].actual;
+    set[i]=zones[i].set;
+  }
+
+  bool ended=runner.Update(actual,set,millis());
+
+  for (int i=0;i<NUM_ZONES;i++)
+    zones[i].set=set[i];
+
+  if (ended) {
+    Serial.printf("EspOven: program %d %s ended\n",runningProgram,runner.GetProgram().name);
+    if (runner.GetProgram().turnOff)
+      started=false;
+    runningProgram=-1;
   }
 }
 
 
 
+// the learned heat-up curves of the zones are kept in flash (/heatup.json) for the scheduled preheats after a reboot
+void SaveHeatup() {
+  HeapScope scope(HeapSubsystem::Files);
+  JsonArray zs = jsonArena.to<JsonObject>().createNestedArray("zones");
+  double state[HEATUP_STATE_SIZE];
+
+  for (int i=0;i<NUM_ZONES;i++) {
+    JsonArray z = zs.createNestedArray();
+
+    zones[i].heatup.GetState(state);
+    for (int j=0;j<HEATUP_STATE_SIZE;j++)
+      z.add(state[j]);
+  }
+
+  File f = SPIFFS.open("/heatup.json", "w");
+  serializeJson(jsonArena, f);
+  f.close();
+
+  Serial.printf("EspOven: heat-up curves saved\n");
+}
+
+
+
+void LoadHeatup() {
+  HeapScope scope(HeapSubsystem::Files);
+  double state[HEATUP_STATE_SIZE];
+
+  File f = SPIFFS.open("/heatup.json", "r");
+  if (!f)
+    return;
+
+  DeserializationError err=deserializeJson(jsonArena, f);
+  f.close();
+
+  JsonArray zs = jsonArena["zones"];
+  if (err!=DeserializationError::Ok || zs.isNull()) {
+    Serial.printf("EspOven: error loading heat-up curves\n");
+    return;
+  }
+
+  for (int i=0;i<NUM_ZONES && i<(int) zs.size();i++) {
+    JsonArray z = zs[i];
+
+    if (z.size()!=HEATUP_STATE_SIZE)
+      continue;
+    for (int j=0;j<HEATUP_STATE_SIZE;j++)
+      state[j]=z[j];
+    zones[i].heatup.SetState(state);
+  }
+}
+
+
+
+// a schedule starts the oven at the latest time its zones, preheating at full power as forecast by their learned
+// heat-up curves, are ready by its ready time; the oven turns off after its duration
+void CheckSchedules() {
+  unsigned long now=LocalTime();
+
+  // the time is not known until the first ntp sync
+  if (now<NTP_VALID_TIME)
+    return;
+
+  for (int i=0;i<schedules->numSchedules;i++) {
+    Schedule &s=schedules->schedules[i];
+    unsigned long ready=s.NextReady(now);
+    double eta[MAX_ZONES];
+    int n=0;
+
+    schedules->nextReady[i]=ready;
+    schedules->nextStart[i]=0;
+    if (ready==0 || ready==schedules->lastSession[i])
+      continue;
+
+    for (int j=0;j<NUM_ZONES;j++)
+      if (zones[j].enabled && s.set[j]>0)
+        eta[n++]=zones[j].heatup.IsValid()?zones[j].heatup.GetEta(zones[j].actual,s.set[j]):-1;
+
+    unsigned long lead=PreheatLead(eta,n);
+    schedules->nextStart[i]=(ready>lead)?ready-lead:0;
+
+    if (now<schedules->nextStart[i])
+      continue;
+
+    // an oven already on takes the session as it is
+    schedules->lastSession[i]=ready;
+    if (started) {
+      Serial.printf("EspOven: schedule %d skipped, the oven is already on\n",i);
+      continue;
+    }
+    if (supervisor.IsTripped()) {
+      Serial.printf("EspOven: schedule %d skipped, safety trip\n",i);
+      continue;
+    }
+
+    for (int j=0;j<NUM_ZONES;j++)
+      if (s.set[j]>0)
+        zones[j].set=s.set[j];
+
+    StopProgram();
+    ResetStats();
+    started=true;
+    timer=(s.duration>0)?s.End(ready)-now:0;
+    starttimer=millis();
+
+    Serial.printf("EspOven: schedule %d started, ready in %lus, timer %ds\n",i,ready-now,timer);
+  }
+}
+
+
+
+// the gains found by an autotune are saved in the configuration of the zone, which will then use PID control
+// (the running autotune control already does with the tuned gains, no reboot needed)
+void SaveAutotune() {
+  for (int i=0;i<NUM_ZONES;i++) {
+    PidAutotuneControl *c=zones[i].GetControl().As<PidAutotuneControl>();
+    if (!zones[i].enabled || c==NULL)
+      continue;
+
+    if (c->status!=PidAutotuneStatus::Done || c->saved)
+      continue;
+
+    ZoneConfiguration &zc=conf->zones[i];
+    zc.kp=c->tunedKp;
+    zc.ki=c->tunedKi;
+    zc.kd=c->tunedKd;
+    zc.control=ControlType::PID;
+    conf->Save();
+    c->saved=true;
+
+    Serial.printf("EspOven: zone %s autotune gains saved, switching to PID control\n",zones[i].name);
+  }
+}
+
+
+
+void handleOvenHeating(const ProbeSample &sample) {
+  HeapScope scope(HeapSubsystem::Control);
+  //Serial.printf("EspOven: handleOvenHeating\n");
+
+  UpdateProgram();
+
+  for (int i=0;i<NUM_ZONES;i++) {
+    Zone &z=zones[i];
+
+    if (!z.enabled) {
+      SetZoneDemand(i,0);
+      continue;
+    }
+
+    z.Sample(sample.status[i],(z.GetSecondProbe()>=0)?sample.status[z.GetSecondProbe()]:0);
+
+    if (!started || !z.cascaded)
+      z.target=z.set;
+
+    Serial.printf("EspOven: handleOvenHeating %s actual %f (smoothed %f) set %f target %f cj %f status %d\n",z.name,z.raw,z.actual,z.set,z.target,z.cj,z.status);
+  }
+
+  // the cascade controls run first since they move the target of their inner zone
+  for (int pass=0;pass<2;pass++)
+    for (int i=0;i<NUM_ZONES;i++) {
+      Zone &z=zones[i];
+
+      if (!z.enabled || (z.GetControl().GetControlType()==ControlType::Cascade)!=(pass==0))
+        continue;
+
+      z.Control(started,sample.ms);
+      SetZoneDemand(i,started?z.GetControl().GetDemand():0);
+    }
+
+  scheduler.Update(started);
+
+  SaveAutotune();
+
+#ifdef SERIAL_TRACE
+  Serial.printf("TRACE,%lu",sample.ms);
+  for (int i=0;i<NUM_ZONES;i++)
+    Serial.printf(",%.2f,%d",zones[i].raw,zones[i].enabled && zones[i].GetAction()->Active());
+  Serial.printf("\n");
+#endif
+}
+
+
+
 int numNote=0;
 
 int melody[] = {
@@ -592,25 +1315,54 @@ bool flag=true;
 
 
 void loop() {
-  CheckConnectWifi();
-  
-  handleHttpRequests();
+  heapMonitor.Update(millis());
+
+  {
+    HeapScope scope(HeapSubsystem::Network);
+
+    CheckConnectWifi();
+    handleHttpRequests();
+  }
+
+  CheckSchedules();
 
   // stop timer
   if (timer!=0 && timer<((millis()-starttimer)/1000)) {
     Serial.printf("\nEspOven: timer %d elapsed %d turning off oven\n\n",timer,millis()-starttimer);
     started=0;
     timer=0;
+    StopProgram();
   }
 
-  handleOvenHeating();
+  // every sample taken by the timer since the last loop, in order and with its own time
+  // a trip of the safety supervisor stops the oven until it is started again
+  if (supervisor.CheckSamples(millis()))
+    SafetyStop();
+
+  ProbeSample sample;
+  while (probeSampler.Pop(sample)) {
+    if (supervisor.IsTripped())
+      SafetyStop();
+
+    handleOvenHeating(sample);
+    probeSampler.Controlled(sample);
+    supervisor.Controlled(millis());
+    Serial.println(" ");
+
+    if (firstTick==0) {
+      firstTick=millis()|1;
+      Serial.printf("EspOven: First control tick at %lu ms\n", firstTick);
+    }
+  }
+
+  if (wasStarted && !started)
+    SaveHeatup();
+  wasStarted=started;
 
   //digitalWrite(PIN_MAX31855_CHAMBER,flag);
   //flag=!flag;
   
   //PlayNote();
-  
-  Serial.println(" ");
 
-  delay(100);
+  delay(10);  // lets the sampling timer and the network run, the cadence of the controls is set by the timer
 }
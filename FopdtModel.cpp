@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+#include <math.h>
+#include "FopdtModel.h"
+
+
+  bool FopdtModel::IsValid() const {
+    return gain>0 && tau>0 && deadTime>=0;
+  }
+
+
+  // exact solution for a constant input
+  double FopdtModel::Step(double x, double u, double dt) const {
+    return gain*u+(x-gain*u)*exp(-dt/tau);
+  }
+
+
+  // Ziegler-Nichols and Cohen-Coon from the reaction curve, SIMC PI with tauc=deadTime (Skogestad),
+  // AMIGO PID (Astrom-Hagglund). A dead time of 0 would give infinite gains, at least 1% of tau is assumed.
+  PidGains FopdtModel::Tune(TuningRule rule, double outputScale) const {
+    PidGains g={0,0,0};
+    double theta=(deadTime>tau*0.01)?deadTime:tau*0.01;
+    double r=theta/tau;
+    double kc=0,ti=0,td=0;
+
+    if (!IsValid())
+      return g;
+
+    switch (rule) {
+      case TuningRule::ZieglerNichols:
+        kc=1.2/(gain*r);
+        ti=2*theta;
+        td=0.5*theta;
+        break;
+      case TuningRule::CohenCoon:
+        kc=(1/(gain*r))*(4.0/3+r/4);
+        ti=theta*(32+6*r)/(13+8*r);
+        td=4*theta/(11+2*r);
+        break;
+      case TuningRule::SIMC:
+        kc=tau/(gain*2*theta);
+        ti=(tau<8*theta)?tau:8*theta;
+        td=0;
+        break;
+      case TuningRule::AMIGO:
+        kc=(0.2+0.45/r)/gain;
+        ti=theta*(0.4*theta+0.8*tau)/(theta+0.1*tau);
+        td=0.5*theta*tau/(0.3*theta+tau);
+        break;
+    }
+
+    g.kp=kc*outputScale;
+    g.ki=g.kp/ti;
+    g.kd=g.kp*td;
+
+    return g;
+  }
+
+
+  // at the ultimate frequency w=2pi/pu the loop gain is 1: gain*ku=sqrt(1+(w*tau)^2)
+  // and the phase is -pi: atan(w*tau)+w*deadTime=pi
+  bool FopdtModel::FromUltimate(double gain, double ku, double pu, FopdtModel &model) {
+    double r=gain*ku;
+
+    if (gain<=0 || pu<=0 || r<=1)
+      return false;
+
+    double w=2*M_PI/pu;
+    model.gain=gain;
+    model.tau=sqrt(r*r-1)/w;
+    model.deadTime=(M_PI-atan(w*model.tau))/w;
+
+    return true;
+  }
+
+
+  const char *FopdtModel::GetRuleName(TuningRule rule) {
+    switch (rule) {
+      case TuningRule::ZieglerNichols: return "Ziegler-Nichols";
+      case TuningRule::CohenCoon: return "Cohen-Coon";
+      case TuningRule::SIMC: return "SIMC";
+      case TuningRule::AMIGO: return "AMIGO";
+    }
+
+    return "";
+  }
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _FopdtModel_h_
+#define _FopdtModel_h_
+
+// First order plus dead time model of a zone, without any Arduino dependency (it is also compiled by the host
+// tools): the temperature rise above the ambient follows the heater duty u (0..1) as
+//   tau*dx/dt = gain*u(t-deadTime) - x
+// and the classic tuning rules derive the pid gains from it.
+
+enum class TuningRule { ZieglerNichols=0, CohenCoon=1, SIMC=2, AMIGO=3 };
+#define TUNING_RULES 4
+
+// gains with the units of PidEngine: ki per second and kd in seconds
+struct PidGains {
+  double kp,ki,kd;
+};
+
+
+struct FopdtModel {
+  double gain;      // C of steady state rise with the heater always on
+  double tau;       // s, time constant
+  double deadTime;  // s
+
+  bool IsValid() const;
+  // x after dt seconds with the duty u held constant (ignoring the dead time)
+  double Step(double x, double u, double dt) const;
+
+  // gains of the rule for a pid whose output is the duty times outputScale (e.g. the relay window size in ms)
+  PidGains Tune(TuningRule rule, double outputScale) const;
+
+  // model with the given gain crossing -180 degrees at the ultimate gain ku (duty per C) and period pu (s)
+  // measured by a relay autotune, false if they are not consistent (gain*ku must be above 1)
+  static bool FromUltimate(double gain, double ku, double pu, FopdtModel &model);
+  static const char *GetRuleName(TuningRule rule);
+};
+
+#endif
@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include "GainSchedule.h"
+
+
+  GainSchedule::GainSchedule() {
+    count=0;
+  }
+
+
+  // points are kept sorted by temperature, the ones with temp<=0 are unused slots
+  void GainSchedule::Set(const GainPoint *_points, int _count) {
+    count=0;
+
+    for (int i=0;i<_count && i<MAX_GAIN_POINTS;i++) {
+      if (_points[i].temp<=0)
+        continue;
+
+      int j=count++;
+      while (j>0 && points[j-1].temp>_points[i].temp) {
+        points[j]=points[j-1];
+        j--;
+      }
+      points[j]=_points[i];
+    }
+  }
+
+
+  int GainSchedule::GetCount() {
+    return count;
+  }
+
+
+  void GainSchedule::Interpolate(double temp, double &kp, double &ki, double &kd, double &duty) {
+    if (count==0)
+      return;
+
+    const GainPoint *a=&points[0],*b=&points[0];
+    double f=0;
+
+    if (temp>=points[count-1].temp)
+      a=b=&points[count-1];
+    else if (temp>points[0].temp) {
+      int i=1;
+
+      while (points[i].temp<temp)
+        i++;
+
+      a=&points[i-1];
+      b=&points[i];
+      f=(temp-a->temp)/(b->temp-a->temp);
+    }
+
+    kp=a->kp+(b->kp-a->kp)*f;
+    ki=a->ki+(b->ki-a->ki)*f;
+    kd=a->kd+(b->kd-a->kd)*f;
+    duty=a->duty+(b->duty-a->duty)*f;
+  }
@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _GainSchedule_h_
+#define _GainSchedule_h_
+
+#define MAX_GAIN_POINTS 4
+
+
+// pid gains and steady state duty (0..1) needed to hold the temperature, measured at a given temperature
+struct GainPoint {
+  double temp;
+  double kp,ki,kd;
+  double duty;
+};
+
+
+// Table of gains keyed by temperature (points sorted by temp), linearly interpolated between the points
+// and held constant outside them. The heat loss of the oven grows with temperature, so do the gains and
+// the duty needed to hold the set temperature (used as feed forward).
+class GainSchedule {
+public:
+  GainSchedule();
+  void Set(const GainPoint *_points, int _count);
+  int GetCount();
+  void Interpolate(double temp, double &kp, double &ki, double &kd, double &duty);
+
+protected:
+  GainPoint points[MAX_GAIN_POINTS];
+  int count;
+};
+
+#endif
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <ESP8266WiFi.h>
+#include "HeapMonitor.h"
+
+HeapMonitor heapMonitor;
+
+static const char *subsystemNames[HEAP_SUBSYSTEMS]={ "network", "http", "json", "files", "control" };
+
+
+  HeapMonitor::HeapMonitor() {
+    head=0;
+    count=0;
+    lastSample=0;
+    lastHistory=0;
+    memset(&current,0,sizeof(current));
+    memset(&low,0,sizeof(low));
+    memset(&period,0,sizeof(period));
+    memset(stats,0,sizeof(stats));
+    memset(start,0,sizeof(start));
+  }
+
+
+  // with the uint32_t block size, the overload with the uint16_t one is deprecated
+  void HeapMonitor::Sample(HeapSample &s, unsigned long now) {
+    ESP.getHeapStats(&s.free,&s.maxBlock,&s.frag);
+    s.time=now/1000;
+  }
+
+
+  // keeps the lowest free heap and block and the highest fragmentation
+  void HeapMonitor::Worst(HeapSample &worst, const HeapSample &s) {
+    if (worst.time==0 || s.free<worst.free)
+      worst.free=s.free;
+    if (worst.time==0 || s.maxBlock<worst.maxBlock)
+      worst.maxBlock=s.maxBlock;
+    if (worst.time==0 || s.frag>worst.frag)
+      worst.frag=s.frag;
+    worst.time=s.time;
+  }
+
+
+  void HeapMonitor::Update(unsigned long now) {
+    if (lastSample!=0 && now-lastSample<HEAP_SAMPLE_PERIOD)
+      return;
+    lastSample=now;
+
+    Sample(current,now);
+    // time 0 marks the marks not set yet, the first sample is at least at 1s
+    if (current.time==0)
+      current.time=1;
+    Worst(low,current);
+    Worst(period,current);
+
+    if (lastHistory==0)
+      lastHistory=now;
+    if (now-lastHistory<HEAP_HISTORY_PERIOD)
+      return;
+
+    lastHistory=now;
+    history[head]=period;
+    head=(head+1)%HEAP_HISTORY;
+    if (count<HEAP_HISTORY)
+      count++;
+    memset(&period,0,sizeof(period));
+
+    Serial.printf("EspOven: heap free %u (low %u) max block %u (low %u) fragmentation %u%% (high %u%%) trend %.0f B/h\n",
+      current.free,low.free,current.maxBlock,low.maxBlock,current.frag,low.frag,GetTrend());
+  }
+
+
+  void HeapMonitor::Begin(HeapSubsystem s) {
+    start[(int) s]=ESP.getFreeHeap();
+  }
+
+
+  void HeapMonitor::End(HeapSubsystem s) {
+    HeapSubsystemStats &st=stats[(int) s];
+    long delta=(long) ESP.getFreeHeap()-(long) start[(int) s];
+
+    st.calls++;
+    st.net+=delta;
+    if (-delta>st.worst) {
+      st.worst=-delta;
+      Serial.printf("EspOven: heap %s lost %ld bytes in a single call\n",subsystemNames[(int) s],st.worst);
+    }
+  }
+
+
+  // slope of the least squares line through the free heap of the history
+  double HeapMonitor::GetTrend() {
+    if (count<HEAP_TREND_MIN)
+      return 0;
+
+    double st=0,sf=0,stt=0,stf=0;
+    for (int i=0;i<count;i++) {
+      const HeapSample &h=history[(head-count+i+HEAP_HISTORY)%HEAP_HISTORY];
+      double t=h.time/3600.0;
+
+      st+=t;
+      sf+=h.free;
+      stt+=t*t;
+      stf+=t*h.free;
+    }
+
+    double den=count*stt-st*st;
+    return (den>0)?(count*stf-st*sf)/den:0;
+  }
+
+
+  void HeapMonitor::GetJson(JsonObject obj) {
+    obj["free"]=current.free;
+    obj["maxBlock"]=current.maxBlock;
+    obj["frag"]=current.frag;
+    obj["lowFree"]=low.free;
+    obj["lowMaxBlock"]=low.maxBlock;
+    obj["highFrag"]=low.frag;
+    obj["trend"]=GetTrend();
+    obj["uptime"]=millis()/1000;
+
+    JsonObject ss=obj.createNestedObject("subsystems");
+    for (int i=0;i<HEAP_SUBSYSTEMS;i++) {
+      JsonObject so=ss.createNestedObject(subsystemNames[i]);
+
+      so["calls"]=stats[i].calls;
+      so["net"]=stats[i].net;
+      so["worst"]=stats[i].worst;
+    }
+
+    // oldest first: time, free, largest block, fragmentation
+    JsonArray hs=obj.createNestedArray("history");
+    for (int i=0;i<count;i++) {
+      const HeapSample &h=history[(head-count+i+HEAP_HISTORY)%HEAP_HISTORY];
+      JsonArray ho=hs.createNestedArray();
+
+      ho.add(h.time);
+      ho.add(h.free);
+      ho.add(h.maxBlock);
+      ho.add(h.frag);
+    }
+  }
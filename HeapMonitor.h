@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _HeapMonitor_h_
+#define _HeapMonitor_h_
+
+#include <ArduinoJson.h>
+
+#define HEAP_SAMPLE_PERIOD  1000      // ms between two samples of the heap
+#define HEAP_HISTORY        48        // entries of the history...
+#define HEAP_HISTORY_PERIOD 1800000UL // ...each one the worst of 30 minutes, a day in all
+#define HEAP_TREND_MIN      4         // entries of the history needed for the trend
+
+// parts of the firmware whose heap usage is tracked, a scope nested in one of another subsystem is counted by both
+// (the scopes of the same subsystem must not nest)
+enum class HeapSubsystem { Network=0, Http=1, Json=2, Files=3, Control=4 };
+#define HEAP_SUBSYSTEMS 5
+
+
+// heap lost or gained by the scopes of a subsystem
+struct HeapSubsystemStats {
+  unsigned long calls;
+  long net;        // bytes of free heap gained (negative lost) by all the scopes
+  long worst;      // largest loss of a single scope
+};
+
+
+struct HeapSample {
+  unsigned long time;  // s since boot
+  uint32_t free;       // bytes of free heap
+  uint32_t maxBlock;   // largest free block
+  uint8_t frag;        // fragmentation in % (100 - largest block / free)
+};
+
+
+// Tracks the free heap, the largest free block and the fragmentation of the ESP8266, their low-water marks and a
+// history of the worst values of each period with the trend of the free heap (a slow leak shows as a negative
+// trend), and attributes the heap lost by the subsystems with scopes around their entry points.
+class HeapMonitor {
+public:
+  HeapMonitor();
+
+  void Update(unsigned long now);
+  void Begin(HeapSubsystem s);
+  void End(HeapSubsystem s);
+  // bytes per hour of free heap over the history, 0 if too short
+  double GetTrend();
+  void GetJson(JsonObject obj);
+
+protected:
+  HeapSample current,low,period;  // last sample, low-water marks since boot and worst of the current period
+  HeapSample history[HEAP_HISTORY];
+  int head,count;
+  unsigned long lastSample,lastHistory;
+  HeapSubsystemStats stats[HEAP_SUBSYSTEMS];
+  uint32_t start[HEAP_SUBSYSTEMS];
+
+  void Sample(HeapSample &s, unsigned long now);
+  static void Worst(HeapSample &worst, const HeapSample &s);
+};
+
+extern HeapMonitor heapMonitor;
+
+
+// heap usage of a subsystem from the declaration to the end of the block
+class HeapScope {
+public:
+  HeapScope(HeapSubsystem _s) : s(_s) {
+    heapMonitor.Begin(s);
+  }
+
+  ~HeapScope() {
+    heapMonitor.End(s);
+  }
+
+protected:
+  HeapSubsystem s;
+};
+
+#endif
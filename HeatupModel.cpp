@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <math.h>
+#include "HeatupModel.h"
+
+
+  HeatupModel::HeatupModel() {
+    Reset();
+  }
+
+
+  void HeatupModel::Reset() {
+    for (int i=0;i<3;i++) {
+      theta[i]=0;
+      for (int j=0;j<3;j++)
+        p[i][j]=(i==j)?HEATUP_MAX_TRACE/3:0;
+    }
+
+    rate=0;
+    first=true;
+    rateValid=false;
+    updates=0;
+    lastTemp=0;
+    lastTime=0;
+    lastHeating=0;
+  }
+
+
+  void HeatupModel::Update(double temp, unsigned long heatingMs, unsigned long now) {
+    // the heating time goes back to 0 when the statistics are reset
+    if (first || heatingMs<lastHeating) {
+      first=false;
+      lastTemp=temp;
+      lastTime=now;
+      lastHeating=heatingMs;
+      return;
+    }
+
+    unsigned long elapsed=now-lastTime;
+    if (elapsed<HEATUP_PERIOD)
+      return;
+
+    // after a gap (e.g. the oven was stopped) the interval restarts
+    if (elapsed>3*HEATUP_PERIOD) {
+      first=true;
+      Update(temp,heatingMs,now);
+      return;
+    }
+
+    double r=(temp-lastTemp)*1000/elapsed;
+    // regressors: duty, temperature (scaled to keep the covariance well conditioned) and constant
+    double x[3]={ (double) (heatingMs-lastHeating)/elapsed, -(temp+lastTemp)/200, 1 };
+
+    if (x[0]>1)
+      x[0]=1;
+
+    lastTemp=temp;
+    lastTime=now;
+    lastHeating=heatingMs;
+
+    rate=rateValid?rate+HEATUP_RATE_ALPHA*(r-rate):r;
+    rateValid=true;
+
+    // recursive least squares: k=P*x/(forget+x'*P*x), theta+=k*(r-x'*theta), P=(P-k*x'*P)/forget
+    double px[3],den=HEATUP_FORGET,err=r;
+    for (int i=0;i<3;i++) {
+      px[i]=0;
+      for (int j=0;j<3;j++)
+        px[i]+=p[i][j]*x[j];
+      den+=x[i]*px[i];
+      err-=x[i]*theta[i];
+    }
+
+    for (int i=0;i<3;i++)
+      theta[i]+=px[i]/den*err;
+
+    // no forgetting once the covariance is back to its initial size, it would grow without bound at steady state
+    double forget=(p[0][0]+p[1][1]+p[2][2]<HEATUP_MAX_TRACE)?HEATUP_FORGET:1;
+    for (int i=0;i<3;i++)
+      for (int j=0;j<3;j++)
+        p[i][j]=(p[i][j]-px[i]*px[j]/den)/forget;
+
+    updates++;
+  }
+
+
+  void HeatupModel::GetState(double *state) {
+    for (int i=0;i<3;i++) {
+      state[i]=theta[i];
+      for (int j=0;j<3;j++)
+        state[3+i*3+j]=p[i][j];
+    }
+    state[12]=updates;
+  }
+
+
+  void HeatupModel::SetState(const double *state) {
+    Reset();
+
+    for (int i=0;i<3;i++) {
+      theta[i]=state[i];
+      for (int j=0;j<3;j++)
+        p[i][j]=state[3+i*3+j];
+    }
+    updates=(int) state[12];
+  }
+
+
+  bool HeatupModel::IsValid() {
+    return updates>=HEATUP_MIN_UPDATES && theta[0]>0;
+  }
+
+
+  double HeatupModel::GetRate() {
+    return rate*60;
+  }
+
+
+  double HeatupModel::GetFullPowerRate(double temp) {
+    if (!IsValid())
+      return 0;
+
+    return (theta[0]-theta[1]*temp/100+theta[2])*60;
+  }
+
+
+  double HeatupModel::GetEta(double temp, double set) {
+    double ready=set-HEATUP_BAND;
+
+    if (temp>=ready)
+      return 0;
+
+    if (!IsValid())
+      return (rateValid && rate>0)?(ready-temp)/rate:-1;
+
+    // dT/dt=full-loss*T at full power, the loss is negative when the zone is heated mostly by another one
+    double loss=theta[1]/100,full=theta[0]+theta[2];
+    double r0=full-loss*temp,r1=full-loss*ready;
+
+    if (r0<=0 || r1<=0)
+      return -1;
+
+    if (fabs(loss)*(ready-temp)<1e-3*r0)
+      return (ready-temp)/r0;
+
+    return log(r0/r1)/loss;
+  }
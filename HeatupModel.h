@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _HeatupModel_h_
+#define _HeatupModel_h_
+
+// Heat-up curve of a zone learned while the oven runs, without any Arduino dependency (it is also compiled by
+// the host tools), to forecast when the zone reaches its set temperature. Every HEATUP_PERIOD the heating rate
+// is regressed by recursive least squares with forgetting on the heater duty and the temperature,
+//   dT/dt = gain*duty - loss*T + offset
+// so that at full power the zone tends exponentially to (gain+offset)/loss with time constant 1/loss.
+// Until the model has seen enough samples the recent heating rate is extrapolated instead.
+
+#define HEATUP_PERIOD 10000      // ms between the updates of the model
+#define HEATUP_FORGET 0.998      // forgetting factor of the least squares, a memory of about 80 minutes
+#define HEATUP_MIN_UPDATES 30    // updates before the learned curve is used
+#define HEATUP_RATE_ALPHA 0.3    // smoothing of the recent heating rate
+#define HEATUP_MAX_TRACE 3000.0  // initial and maximum trace of the covariance
+#define HEATUP_BAND 2.0          // C, a zone within the band below its set temperature is ready
+#define HEATUP_STATE_SIZE 13     // values of the learned state: coefficients, covariance and updates
+
+
+class HeatupModel {
+public:
+  HeatupModel();
+
+  void Reset();
+  // temp is the filtered temperature, heatingMs the running total of the time the heater has been on,
+  // to be called only while the oven is on
+  void Update(double temp, unsigned long heatingMs, unsigned long now);
+  bool IsValid();
+
+  // learned state, saved across reboots
+  void GetState(double *state);
+  void SetState(const double *state);
+
+  // recent heating rate in C/min
+  double GetRate();
+  // learned heating rate at full power at temp in C/min, 0 if the model is not valid
+  double GetFullPowerRate(double temp);
+  // s to reach set-HEATUP_BAND from temp at full power, 0 if already there, -1 if unknown or unreachable
+  double GetEta(double temp, double set);
+
+protected:
+  double theta[3];   // gain, loss (per 100C), offset in C/s
+  double p[3][3];    // covariance of the least squares
+  double rate;       // C/s
+  bool first,rateValid;
+  int updates;
+  double lastTemp;
+  unsigned long lastTime,lastHeating;
+};
+
+#endif
@@ -25,13 +25,22 @@
 #ifndef _IControl_h_
 #define _IControl_h_
 
-#include <ESP8266WiFi.h>
+#include <Arduino.h>
 
 
-enum class ControlType { OnOff=1, PID=2, PIDAutotune=3 };
+enum class ControlType { None=0, OnOff=1, PID=2, PIDAutotune=3, Cascade=4, MPC=5 };
 
+// how the heater demand is actuated: time proportioning of a relay or burst firing of a SSR
+enum class OutputMode { Relay=1, Burst=2 };
 
-// Simple interface to implement the on/off actions called by IControl interface
+
+// pin access of the actions, implemented by the sketch (directly or through a SX1509 expander)
+void ActionPinMode(int pin);
+int ActionRead(int pin);
+void ActionWrite(int pin, int value);
+
+
+// on/off action of the relay or SSR of a heater, not virtual: there is a single kind of them
 class IControlAction {
    public:
       int von,voff;
@@ -53,9 +62,25 @@ class IControlAction {
         pin=_pin;
       }
 
-    virtual bool Active()=0;
-    virtual void On ()=0;
-    virtual void Off()=0;
+      int GetPin() {
+        return pin;
+      }
+
+      void Begin() {
+        ActionPinMode(pin);
+      }
+
+      bool Active() {
+        return ActionRead(pin)==von;
+      }
+
+      void On() {
+        ActionWrite(pin,von);
+      }
+
+      void Off() {
+        ActionWrite(pin,voff);
+      }
 
   protected:
     int pin;
@@ -63,7 +88,9 @@ class IControlAction {
     
 
 
-// interface for control types (OnOff, PID, etc.)
+// base of the control types (OnOff, PID, etc.), which are dispatched by ControlVariant without virtual calls: each one
+// declares its ControlType in Type and Control(bool started, unsigned long now), now is the time in ms of the sample
+// in actual. Control computes the heater demand as a duty between 0 and 1, the relay is switched by the RelayScheduler
 class IControl
 {      
 
@@ -72,14 +99,17 @@ public:
         Serial.printf("IControl: name %s\n",_name);
         name=_name;
         action=_action;
+        demand=0;
+      }
+
+      double GetDemand() {
+        return demand;
       }
-      
-      virtual void Control(bool started)=0;
-      virtual ControlType GetControlType()=0;
 
 protected:
       const char *name;  // useful for debugging multiple controls of the same type
       IControlAction *action;
+      double demand;
 };
 
 #endif
@@ -26,7 +26,13 @@
 
 LowPassFilter::LowPassFilter(double _alpha) {
   alpha=_alpha;
+  Reset();
+}
+
+
+void LowPassFilter::Reset() {
   oldval=0;
+  first=true;
 }
 
 
@@ -35,9 +41,14 @@ void LowPassFilter::SetAlpha(double _alpha) {
 }
 
 
+// exponential moving average, alpha is the weight of the previous filtered value
 double LowPassFilter::GetFilteredValue(double val) {
-  double ris=alpha*oldval+(1-alpha)*(val-oldval);
-  oldval=val;
+  if (first) {
+    first=false;
+    oldval=val;
+  }
+
+  oldval=alpha*oldval+(1-alpha)*val;
 
-  return ris;
+  return oldval;
 }
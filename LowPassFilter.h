@@ -30,8 +30,10 @@ public:
   LowPassFilter(double alpha);  // alpha between 0 and 1
   void SetAlpha(double _alpha);
   double GetFilteredValue(double val);
+  void Reset();
 protected:
   double oldval,alpha;
+  bool first;
 };
 
 #endif
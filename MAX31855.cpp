@@ -77,21 +77,81 @@ MAX31855::MAX31855(const uint8_t _cs)
 ////////////////////////////////////////////////////////////////////////////////
 void MAX31855::sampleProbe(void)
 {
+  status.uint32 = readRaw();
+  
+  Serial.printf("MAX31855(%d): sampleProbe new status %x bytes[3] %x\n",cs,status.uint32,status.bytes[3]);
+
+  return;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Description  : This function reads the MAX31855 data word
+// Input        : None
+// Output       : None, the status is not changed
+// Return:      : uint32_t: The 32bit word of the IC (memory map above)
+// Usage        : uint32_t raw = <objectName>.readRaw();
+//                It doesn't log, so it can be called by a timer callback and
+//                the word loaded later with setStatus
+////////////////////////////////////////////////////////////////////////////////
+uint32_t MAX31855::readRaw(void)
+{
+  uint32_t raw;
+
   digitalWrite(cs, LOW);
   delayMicroseconds(1);
   
   SPI.beginTransaction(SPISettings(SPI_CLOCK_DIV4, MSBFIRST, SPI_MODE0));  // Defaults 
-  status.bytes[3] = SPI.transfer(0x00);
-  status.bytes[2] = SPI.transfer(0x00);
-  status.bytes[1] = SPI.transfer(0x00);
-  status.bytes[0] = SPI.transfer(0x00);  
+  raw  = (uint32_t) SPI.transfer(0x00) << 24;
+  raw |= (uint32_t) SPI.transfer(0x00) << 16;
+  raw |= (uint32_t) SPI.transfer(0x00) << 8;
+  raw |= SPI.transfer(0x00);
   SPI.endTransaction();
 
   digitalWrite(cs, HIGH);
-  
-  Serial.printf("MAX31855(%d): sampleProbe new status %x bytes[3] %x\n",cs,status.uint32,status.bytes[3]);
 
-  return;
+  return raw;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Description  : This function loads a word read by readRaw as the status
+// Input        : uint32_t raw: The 32bit word of the IC
+// Return:      : None
+// Usage        : <objectName>.setStatus(raw);
+////////////////////////////////////////////////////////////////////////////////
+void MAX31855::setStatus(uint32_t raw)
+{
+  status.uint32 = raw;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Description  : This function checks the fault bit of a raw word
+// Input        : uint32_t raw: The 32bit word of the IC
+// Return:      : bool: true on a probe fault, or on a word of all zeros (no
+//                IC answering on the bus, it would read 0C with no fault)
+// Usage        : bool fault = MAX31855::rawFault(raw);
+////////////////////////////////////////////////////////////////////////////////
+bool MAX31855::rawFault(uint32_t raw)
+{
+  return raw==0 || (raw & (1<<16))!=0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Description  : This function decodes the temperature of a raw word
+// Input        : uint32_t raw: The 32bit word of the IC
+// Return:      : double: The probe temperature in C, meaningless on a fault
+// Usage        : double tempC = MAX31855::rawTemp(raw);
+////////////////////////////////////////////////////////////////////////////////
+double MAX31855::rawTemp(uint32_t raw)
+{
+  int16_t value=(raw >> 18) & 0x3FFF;
+
+  value|=((value&0x2000)?0xC000:0); // sign extend to 16bit 14bit value
+
+  return value*0.25;
 }
 
 
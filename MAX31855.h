@@ -35,6 +35,13 @@ public:
   
   // Reads temperatures and status from probe
   void sampleProbe(void);
+  // Reads the raw 32bit word from the probe without logging (safe in a timer callback)
+  uint32_t readRaw(void);
+  // Loads a raw word read by readRaw as the current status
+  void setStatus(uint32_t raw);
+  // Decode a raw word without logging (safe in a timer callback)
+  static bool rawFault(uint32_t raw);
+  static double rawTemp(uint32_t raw);
   // Converts temperature to the specified unit
   double ConvertTemp(double temp, MAX31855::unitType u);
   // Returns the probe temperature
@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+#include "MpcControl.h"
+
+
+  MpcGroup::MpcGroup() {
+    for (int i=0;i<MPC_ZONES;i++) {
+      set[i]=0;
+      temp[i]=0;
+    }
+
+    last=0;
+    running=false;
+  }
+
+
+  void MpcGroup::Update(bool started, unsigned long now) {
+    if (!started) {
+      running=false;
+      return;
+    }
+
+    // first step as soon as the oven is started
+    if (!running) {
+      engine.Reset(temp);
+      last=now-engine.GetStepMs();
+      running=true;
+    }
+
+    if (now-last>=engine.GetStepMs()) {
+      last=now;
+      engine.Step(set,temp);
+    }
+  }
+
+
+
+  MpcControl::MpcControl(const char *_name, IControlAction *_action, MpcGroup *_group, int _index, double *_set, double *_actual) : IControl(_name,_action) {
+    group=_group;
+    index=_index;
+    set=_set;
+    actual=_actual;
+  }
+
+
+  // a zone outside the model (disabled when the model was configured) stays off
+  void MpcControl::Control(bool started, unsigned long now) {
+    if (index<0) {
+      demand=0;
+      return;
+    }
+
+    group->set[index]=*set;
+    group->temp[index]=*actual;
+
+    if (index==group->engine.GetZones()-1)
+      group->Update(started,now);
+
+    demand=started?group->engine.GetDuty(index):0;
+
+    if (started)
+      Serial.printf("EspOven: MpcControl %s (%d) set %f actual %f demand %f bias %f prediction %f\n",name,started,*set,*actual,demand,group->engine.GetBias(index),group->engine.GetPrediction(index));
+  }
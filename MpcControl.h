@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _MpcControl_h_
+#define _MpcControl_h_
+
+#include "IControl.h"
+#include "MpcEngine.h"
+
+// State shared by the MpcControl of all the zones of the model: the last inputs of each zone and the timing of the steps
+class MpcGroup {
+public:
+  MpcEngine engine;
+  double set[MPC_ZONES],temp[MPC_ZONES];
+
+  MpcGroup();
+  // runs a step of the engine when it is due, called by the last zone once all of them have stored their inputs
+  void Update(bool started, unsigned long now);
+
+protected:
+  unsigned long last;
+  bool running;
+};
+
+
+// Heater demand of a zone chosen by the model predictive control of all the zones in the group
+class MpcControl: public IControl {
+public:
+  static const ControlType Type=ControlType::MPC;
+
+  MpcControl(const char *_name, IControlAction *_action, MpcGroup *group, int index, double *set, double *actual);
+  void Control(bool started, unsigned long now);
+
+protected:
+  MpcGroup *group;
+  int index;
+  double *set,*actual;
+};
+
+#endif
@@ -0,0 +1,354 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "MpcEngine.h"
+
+#define MPC_ITERATIONS 60   // projected gradient iterations of each step
+#define MPC_EULER_DT   0.5  // s, integration step used to discretize the model
+
+
+  static double Clamp(double v, double min, double max) {
+    return (v<min)?min:((v>max)?max:v);
+  }
+
+
+  MpcEngine::MpcEngine() {
+    valid=false;
+    zones=0;
+    states=0;
+    horizon=0;
+    moves=0;
+    vars=0;
+    step=0;
+    moveWeight=0;
+    budget=0;
+    ambient=0;
+    lipschitz=1;
+    memset(model,0,sizeof(model));
+    memset(x,0,sizeof(x));
+    memset(bias,0,sizeof(bias));
+    memset(u,0,sizeof(u));
+    memset(plan,0,sizeof(plan));
+    memset(prediction,0,sizeof(prediction));
+  }
+
+
+  bool MpcEngine::Configure(int _zones, const MpcZoneModel *_model, double _step, int _horizon, int _moves, double _moveWeight, double _budget, double _ambient) {
+    valid=false;
+
+    if (_zones<1 || _zones>MPC_ZONES || _horizon<1 || _horizon>MPC_MAX_HORIZON || _moves<1 || _moves>MPC_MAX_MOVES || _moves>_horizon || _step<=0 || _moveWeight<0)
+      return false;
+
+    for (int z=0;z<_zones;z++)
+      if (_model[z].gain<=0 || _model[z].loss<0 || _model[z].coupling<0 || _model[z].lag<0)
+        return false;
+
+    zones=_zones;
+    states=2*zones;
+    horizon=_horizon;
+    moves=_moves;
+    vars=zones*moves;
+    step=_step;
+    moveWeight=_moveWeight;
+    budget=_budget;
+    ambient=_ambient;
+    memcpy(model,_model,zones*sizeof(MpcZoneModel));
+
+    Discretize();
+
+    // responses of the probe readings over the horizon: gamma to each duty move, phi to each initial state
+    int rows=horizon*zones;
+    double *gamma=new double[rows*vars];
+    double *phi=new double[rows*states];
+    double traj[MPC_MAX_HORIZON*MPC_ZONES];
+    double U[MPC_VARS],x0[MPC_STATES];
+
+    for (int c=0;c<vars;c++) {
+      memset(U,0,sizeof(U));
+      memset(x0,0,sizeof(x0));
+      U[c]=1;
+      Simulate(x0,U,traj);
+      for (int r=0;r<rows;r++)
+        gamma[r*vars+c]=traj[r];
+    }
+
+    for (int c=0;c<states;c++) {
+      memset(U,0,sizeof(U));
+      memset(x0,0,sizeof(x0));
+      x0[c]=1;
+      Simulate(x0,U,traj);
+      for (int r=0;r<rows;r++)
+        phi[r*states+c]=traj[r];
+    }
+
+    for (int i=0;i<vars;i++) {
+      for (int j=0;j<vars;j++) {
+        H[i][j]=0;
+        for (int r=0;r<rows;r++)
+          H[i][j]+=gamma[r*vars+i]*gamma[r*vars+j];
+      }
+
+      for (int c=0;c<states;c++) {
+        K1[i][c]=0;
+        for (int r=0;r<rows;r++)
+          K1[i][c]+=gamma[r*vars+i]*phi[r*states+c];
+      }
+
+      for (int z=0;z<zones;z++) {
+        K2[i][z]=0;
+        for (int r=z;r<rows;r+=zones)
+          K2[i][z]+=gamma[r*vars+i];
+      }
+    }
+
+    delete[] gamma;
+    delete[] phi;
+
+    // duty changes: the first move from the applied duty, then between consecutive moves
+    for (int m=0;m<moves;m++)
+      for (int z=0;z<zones;z++) {
+        int i=m*zones+z;
+
+        H[i][i]+=moveWeight*((m<moves-1)?2:1);
+        if (m<moves-1) {
+          H[i][i+zones]-=moveWeight;
+          H[i+zones][i]-=moveWeight;
+        }
+      }
+
+    // largest eigenvalue by power iteration, the gradient step is 1/lipschitz
+    double v[MPC_VARS],w[MPC_VARS];
+    for (int i=0;i<vars;i++)
+      v[i]=1;
+
+    lipschitz=1e-9;
+    for (int it=0;it<50;it++) {
+      double norm=0;
+
+      for (int i=0;i<vars;i++) {
+        w[i]=0;
+        for (int j=0;j<vars;j++)
+          w[i]+=H[i][j]*v[j];
+        norm+=w[i]*w[i];
+      }
+
+      norm=sqrt(norm);
+      if (norm<=0)
+        break;
+
+      lipschitz=norm;
+      for (int i=0;i<vars;i++)
+        v[i]=w[i]/norm;
+    }
+
+    valid=true;
+    return true;
+  }
+
+
+  int MpcEngine::GetZones() {
+    return zones;
+  }
+
+
+  unsigned long MpcEngine::GetStepMs() {
+    return (unsigned long) (step*1000);
+  }
+
+
+  // exact enough for the slow thermal dynamics: euler integration of the continuous model with a small step,
+  // starting from each unit state (columns of A) and from rest with each heater at full duty (columns of B)
+  void MpcEngine::Discretize() {
+    int n=(int) ceil(step/MPC_EULER_DT);
+    double dt=step/n;
+
+    for (int c=0;c<states+zones;c++) {
+      double s[MPC_STATES],d[MPC_STATES];
+
+      for (int i=0;i<states;i++)
+        s[i]=(i==c)?1:0;
+
+      for (int k=0;k<n;k++) {
+        for (int i=0;i<zones;i++) {
+          d[i]=-model[i].loss*s[i]+((i==c-states)?model[i].gain:0);
+          for (int j=0;j<zones;j++)
+            d[i]+=model[i].coupling*(s[j]-s[i]);
+
+          // probe lag, 0 means an immediate reading
+          d[zones+i]=(model[i].lag>dt)?(s[i]-s[zones+i])/model[i].lag:(s[i]-s[zones+i])/dt;
+        }
+
+        for (int i=0;i<states;i++)
+          s[i]+=d[i]*dt;
+      }
+
+      for (int i=0;i<states;i++)
+        if (c<states)
+          A[i][c]=s[i];
+        else
+          B[i][c-states]=s[i];
+    }
+  }
+
+
+  void MpcEngine::Predict(const double *x0, const double *uk, double *x1) {
+    for (int i=0;i<states;i++) {
+      x1[i]=0;
+      for (int j=0;j<states;j++)
+        x1[i]+=A[i][j]*x0[j];
+      for (int j=0;j<zones;j++)
+        x1[i]+=B[i][j]*uk[j];
+    }
+  }
+
+
+  // probe readings over the horizon from x0 with the duty moves U, traj[k*zones+z] is the reading at k+1
+  void MpcEngine::Simulate(const double *x0, const double *U, double *traj) {
+    double s[MPC_STATES],t[MPC_STATES];
+
+    memcpy(s,x0,states*sizeof(double));
+    for (int k=0;k<horizon;k++) {
+      Predict(s,U+((k<moves)?k:moves-1)*zones,t);
+      memcpy(s,t,states*sizeof(double));
+      memcpy(traj+k*zones,s+zones,zones*sizeof(double));
+    }
+  }
+
+
+  // projection of each move on 0<=u<=1 and on the power budget: u=clamp(v-lambda*power), lambda by bisection
+  void MpcEngine::Project(double *U) {
+    for (int m=0;m<moves;m++) {
+      double *v=U+m*zones;
+      double total=0,lo=0,hi=0;
+
+      for (int z=0;z<zones;z++) {
+        v[z]=Clamp(v[z],0,1);
+        total+=v[z]*model[z].power;
+        if (model[z].power>0)
+          hi=fmax(hi,v[z]/model[z].power);
+      }
+
+      if (budget<=0 || total<=budget)
+        continue;
+
+      for (int it=0;it<40;it++) {
+        double lambda=(lo+hi)/2;
+
+        total=0;
+        for (int z=0;z<zones;z++)
+          total+=Clamp(v[z]-lambda*model[z].power,0,1)*model[z].power;
+
+        if (total>budget)
+          lo=lambda;
+        else
+          hi=lambda;
+      }
+
+      for (int z=0;z<zones;z++)
+        v[z]=Clamp(v[z]-hi*model[z].power,0,1);
+    }
+  }
+
+
+  // the oven is assumed at equilibrium: temperatures equal to the readings
+  void MpcEngine::Reset(const double *temp) {
+    for (int z=0;z<zones;z++) {
+      x[z]=temp[z]-ambient;
+      x[zones+z]=temp[z]-ambient;
+      bias[z]=0;
+      u[z]=0;
+      prediction[z]=temp[z];
+    }
+
+    memset(plan,0,sizeof(plan));
+  }
+
+
+  void MpcEngine::Step(const double *set, const double *temp) {
+    double lin[MPC_VARS],U[MPC_VARS],Y[MPC_VARS],next[MPC_VARS],s[MPC_STATES],t=1;
+
+    if (!valid)
+      return;
+
+    // parallel model driven by the duties of the step just ended, the bias is the error of its reading
+    Predict(x,u,s);
+    memcpy(x,s,states*sizeof(double));
+
+    for (int z=0;z<zones;z++)
+      bias[z]=temp[z]-ambient-x[zones+z];
+
+    for (int i=0;i<vars;i++) {
+      lin[i]=(i<zones)?-moveWeight*u[i]:0;
+      for (int c=0;c<states;c++)
+        lin[i]+=K1[i][c]*x[c];
+      for (int z=0;z<zones;z++)
+        lin[i]+=K2[i][z]*(bias[z]-(set[z]-ambient));
+    }
+
+    // warm start from the previous plan shifted by one move
+    for (int i=0;i<vars;i++)
+      U[i]=plan[(i+zones<vars)?i+zones:i];
+    Project(U);
+    memcpy(Y,U,sizeof(U));
+
+    for (int it=0;it<MPC_ITERATIONS;it++) {
+      for (int i=0;i<vars;i++) {
+        double grad=lin[i];
+
+        for (int j=0;j<vars;j++)
+          grad+=H[i][j]*Y[j];
+        next[i]=Y[i]-grad/lipschitz;
+      }
+      Project(next);
+
+      double tnext=(1+sqrt(1+4*t*t))/2;
+      for (int i=0;i<vars;i++) {
+        Y[i]=next[i]+(t-1)/tnext*(next[i]-U[i]);
+        U[i]=next[i];
+      }
+      t=tnext;
+    }
+
+    memcpy(plan,U,vars*sizeof(double));
+    memcpy(u,U,zones*sizeof(double));
+
+    double traj[MPC_MAX_HORIZON*MPC_ZONES];
+    Simulate(x,U,traj);
+    for (int z=0;z<zones;z++)
+      prediction[z]=traj[(horizon-1)*zones+z]+bias[z]+ambient;
+  }
+
+
+  double MpcEngine::GetDuty(int zone) {
+    return (valid && zone>=0 && zone<zones)?u[zone]:0;
+  }
+
+
+  double MpcEngine::GetBias(int zone) {
+    return (zone>=0 && zone<zones)?bias[zone]:0;
+  }
+
+
+  double MpcEngine::GetPrediction(int zone) {
+    return (zone>=0 && zone<zones)?prediction[zone]:0;
+  }
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _MpcEngine_h_
+#define _MpcEngine_h_
+
+// Model predictive control of coupled heating zones without any Arduino dependency (it is also compiled by the
+// host tools). The model of each zone, in degrees above the ambient, is
+//   dT_i/dt = gain_i*u_i - loss_i*T_i + coupling_i*sum_j(T_j-T_i)
+// (gain in C/s at full duty, loss and coupling in 1/s) and the probe reading follows the temperature with a first
+// order lag (dead time and thermocouple lumped together), dP_i/dt = (T_i-P_i)/lag_i. It is discretized with the
+// step of the controller.
+// Each step the duties over the horizon are chosen minimizing the squared tracking error of all the zones plus
+// moveWeight times the squared duty changes, subject to 0<=u<=1 and to the power budget. The duties may change
+// only in the first moves steps of the horizon (move blocking), the last one is held until its end.
+// The problem is a small box constrained QP: its hessian is precomputed by Configure and each step runs a fixed
+// number of accelerated projected gradient iterations, warm started from the previous solution.
+// A parallel model and the difference between the measured and the modelled temperature (output bias) make
+// the tracking offset free despite the model errors (e.g. the radiation losses).
+
+#define MPC_ZONES       2   // maximum number of zones of the model
+#define MPC_MAX_HORIZON 40  // maximum prediction horizon in steps
+#define MPC_MAX_MOVES   4   // maximum number of duty moves in the horizon
+#define MPC_VARS        (MPC_ZONES*MPC_MAX_MOVES)
+#define MPC_STATES      (2*MPC_ZONES)  // temperature and probe reading of each zone
+
+struct MpcZoneModel {
+  double gain;      // C/s of temperature rise at full duty
+  double loss;      // 1/s, heat loss to the ambient
+  double coupling;  // 1/s, heat exchange with the other zones
+  double lag;       // s, time constant of the probe reading
+  double power;     // heater power in W, for the power budget
+};
+
+
+class MpcEngine {
+public:
+  MpcEngine();
+
+  // returns false if the parameters are not valid (the controller keeps its duties at 0)
+  bool Configure(int _zones, const MpcZoneModel *_model, double _step, int _horizon, int _moves, double _moveWeight, double _budget, double _ambient);
+  int GetZones();
+  unsigned long GetStepMs();
+
+  // starts from the current temperatures with all the heaters off
+  void Reset(const double *temp);
+  // computes the duties of the next step from the set and measured temperatures
+  void Step(const double *set, const double *temp);
+  double GetDuty(int zone);
+  double GetBias(int zone);
+  // temperature predicted at the end of the horizon with the current plan
+  double GetPrediction(int zone);
+
+protected:
+  bool valid;
+  int zones,states,horizon,moves,vars;
+  double step,moveWeight,budget,ambient;
+  MpcZoneModel model[MPC_ZONES];
+
+  double A[MPC_STATES][MPC_STATES],B[MPC_STATES][MPC_ZONES];  // discrete model x(k+1)=A*x(k)+B*u(k)
+  double H[MPC_VARS][MPC_VARS];                  // hessian of the cost
+  double K1[MPC_VARS][MPC_STATES];               // linear term of the initial state
+  double K2[MPC_VARS][MPC_ZONES];                // linear term of the bias minus the set temperature
+  double lipschitz;                              // largest eigenvalue of H
+
+  double x[MPC_STATES];       // parallel model state, temperatures then probe readings
+  double bias[MPC_ZONES];
+  double u[MPC_ZONES];        // duties applied in the current step
+  double plan[MPC_VARS];      // solution of the last step, moves of each zone
+  double prediction[MPC_ZONES];
+
+  void Discretize();
+  void Simulate(const double *x0, const double *U, double *traj);
+  void Predict(const double *x0, const double *uk, double *x1);
+  void Project(double *U);
+};
+
+#endif
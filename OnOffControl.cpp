@@ -31,30 +31,23 @@
   }
 
 
-  void OnOffControl::Control(bool started) { 
+  void OnOffControl::Control(bool started, unsigned long now) { 
     bool active=action->Active();
     
-    Serial.printf("EspOven: OnOffControl %s (%d) heating %d von %d voff %d\n",name,started,active,action->von,action->voff);
+    Serial.printf("EspOven: OnOffControl %s (%d) heating %d demand %f\n",name,started,active,demand);
   
     if (started) {
-      if (active && (*actual)>((*set)+delta)) {
+      if (demand>0 && (*actual)>((*set)+delta)) {
         Serial.printf("EspOven: turning off %s heater set %f actual %f\n", name,*set, *actual);
-        action->Off();
+        demand=0;
       }
-      else if (!active && (*actual)<((*set)-delta)) {
+      else if (demand==0 && (*actual)<((*set)-delta)) {
         Serial.printf("EspOven: turning on %s heater set %f actual %f\n", name,*set, *actual);
-        action->On();
+        demand=1;
       }
     }
     else
     {
-        action->Off();
+        demand=0;
     }
   }
-
-
-  ControlType OnOffControl::GetControlType() {
-    return ControlType::OnOff;
-  }
-  
-  
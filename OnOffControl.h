@@ -26,9 +26,10 @@
 
 class OnOffControl: public IControl {
 public:       
+  static const ControlType Type=ControlType::OnOff;
+
   OnOffControl(const char *_name, IControlAction *_action, double * set, double * actual, int delta);
-  virtual void Control(bool started) override;
-  virtual ControlType GetControlType() override;
+  void Control(bool started, unsigned long now);
   
 protected:
   double *set,*actual;
@@ -1,4 +1,4 @@
-#include "PID_AutoTune.h"
+#include "PID_Autotune.h"
 
 // source of Tyreus-Luyben and Ciancone-Marlin rules:
 // "Autotuning of PID Controllers: A Relay Feedback Approach",
@@ -24,6 +24,7 @@ Tuning tuningRule[PID_ATune::NO_OVERSHOOT_PID + 1] =
   { {  44,  9, 126 } },  // TYREUS_LUYBEN_PID
   { {  66, 80,   0 } },  // CIANCONE_MARLIN_PI
   { {  66, 88, 162 } },  // CIANCONE_MARLIN_PID
+  { {   0,  0,   0 } },  // AMIGOF_PI (not from this table)
   { {  28, 50, 133 } },  // PESSEN_INTEGRAL_PID
   { {  60, 40,  60 } },  // SOME_OVERSHOOT_PID
   { { 100, 40,  60 } }   // NO_OVERSHOOT_PID
@@ -81,8 +82,9 @@ bool PID_ATune::Runtime()
   { 
     // initialize working variables the first time around
     peakType = NOT_A_PEAK;
-    inputCount = 0;
+    clearInputs();
     peakCount = 0;
+    inducedAmplitude = 0.0;
     setpoint = *input;
     outputStart = *output;
     lastPeakTime[0] = now;
@@ -274,31 +276,20 @@ bool PID_ATune::Runtime()
   // store initial inputs
   // we don't want to trust the maxes or mins
   // until the input array is full
-  inputCount++;
-  if (inputCount <= nLookBack)
+  if (inputCount < nLookBack)
   {
-    lastInputs[nLookBack - inputCount] = refVal;
+    pushInput(refVal);
     return false;
   }
 
-  // shift array of process values and identify peaks
-  inputCount = nLookBack;
-  bool isMax = true;
-  bool isMin = true;
-  for (int i = inputCount - 1; i >= 0; i--)
-  {
-    double val = lastInputs[i];
-    if (isMax)
-    {
-      isMax = (refVal >= val);
-    }
-    if (isMin) 
-    {
-      isMin = (refVal <= val);
-    }
-    lastInputs[i + 1] = val;
-  }
-  lastInputs[0] = refVal; 
+  // identify peaks against the lookback window
+  // before the new value enters it
+  double iMax = windowMax();
+  double iMin = windowMin();
+  bool isMax = (refVal >= iMax);
+  bool isMin = (refVal <= iMin);
+  double avgInput = (inputSum + refVal) / (double)(inputCount + 1);
+  pushInput(refVal);
 
   // for AMIGOf tuning rule, perform an initial
   // step change to calculate process gain K_process
@@ -308,23 +299,15 @@ bool PID_ATune::Runtime()
   {
     // check that all the recent inputs are 
     // equal give or take expected noise
-    double iMax = lastInputs[0];
-    double iMin = lastInputs[0];
-    double avgInput = 0.0;
-    for (byte i = 0; i <= inputCount; i++)
+    // (the window and the new value)
+    if (isMax)
     {
-      double val = lastInputs[i];
-      if (iMax < val)
-      {
-        iMax = val;
-      }
-        if (iMin > val)
-      {
-        iMin = val;
-      }
-      avgInput += val;
-    } 
-    avgInput /= (double)(inputCount + 1);
+      iMax = refVal;
+    }
+    if (isMin)
+    {
+      iMin = refVal;
+    }
     
 #if defined (AUTOTUNE_DEBUG)
   Serial.print(F("iMax "));
@@ -349,7 +332,7 @@ bool PID_ATune::Runtime()
       {
         state = STEADY_STATE_AFTER_STEP_UP;
         lastPeaks[0] = avgInput;  
-        inputCount = 0;
+        clearInputs();
         return false;
       }
       // else state == STEADY_STATE_AFTER_STEP_UP
@@ -443,9 +426,9 @@ bool PID_ATune::Runtime()
     Serial.println(isMax);
     Serial.println();
     Serial.println(F("lastInputs:"));
-    for (byte i = 0; i <= inputCount; i++)
+    for (byte i = 0; i < inputCount; i++)
     {
-      Serial.println(lastInputs[i]);
+      Serial.println(lastInputs[(inputHead + i) % nLookBack]);
     }
     Serial.println();
 #endif
@@ -454,7 +437,6 @@ bool PID_ATune::Runtime()
 
   // check for convergence of induced oscillation
   // convergence of amplitude assessed on last 4 peaks (1.5 cycles)
-  double inducedAmplitude = 0.0;
   double phaseLag;
   if (
   
@@ -466,6 +448,7 @@ bool PID_ATune::Runtime()
     (peakCount > 4)
   )
   { 
+    inducedAmplitude = 0.0;
     double absMax = lastPeaks[1];
     double absMin = lastPeaks[1];
     for (byte i = 2; i <= 4; i++)
@@ -587,7 +570,7 @@ bool PID_ATune::Runtime()
   // finish up by calculating tuning parameters
   
   // calculate ultimate gain
-  double Ku = 4.0 * workingOstep / (inducedAmplitude * CONST_PI); 
+  Ku = 4.0 * workingOstep / (inducedAmplitude * CONST_PI); 
 
 #if defined (AUTOTUNE_DEBUG) || defined (USE_SIMULATION)
   Serial.print(F("ultimate gain "));
@@ -596,7 +579,7 @@ bool PID_ATune::Runtime()
 #endif
 
   // calculate ultimate period in seconds
-  double Pu = (double) 0.5 * ((lastPeakTime[1] - lastPeakTime[3]) + (lastPeakTime[2] - lastPeakTime[4])) / 1000.0;  
+  Pu = (double) 0.5 * ((lastPeakTime[1] - lastPeakTime[3]) + (lastPeakTime[2] - lastPeakTime[4])) / 1000.0;  
   
 #if defined (AUTOTUNE_DEBUG) || defined (USE_SIMULATION)
   Serial.print(F("ultimate period "));
@@ -753,6 +736,57 @@ double PID_ATune::GetKd()
   return Kp * Td; 
 }
 
+double PID_ATune::GetKu()
+{
+  return Ku;
+}
+
+double PID_ATune::GetPu()
+{
+  return Pu;
+}
+
+bool PID_ATune::GetTunings(byte rule, double &kp, double &ki, double &kd)
+{
+  // AMIGOf needs the process gain and the phase lag
+  // measured only when it is the control type
+  if ((state != CONVERGED) || (rule > NO_OVERSHOOT_PID) || (rule == AMIGOF_PI))
+  {
+    return false;
+  }
+  kp = Ku / (double) tuningRule[rule].divisor(KP_DIVISOR);
+  ki = kp * (double) tuningRule[rule].divisor(TI_DIVISOR) / Pu;
+  kd = tuningRule[rule].PI_controller() ? 
+       0.0 : kp * Pu / (double) tuningRule[rule].divisor(TD_DIVISOR);
+  return true;
+}
+
+const char *PID_ATune::GetRuleName(byte rule)
+{
+  static const char *names[NO_OVERSHOOT_PID + 1] =
+  {
+    "Ziegler-Nichols PI", "Ziegler-Nichols PID", "Tyreus-Luyben PI", "Tyreus-Luyben PID",
+    "Ciancone-Marlin PI", "Ciancone-Marlin PID", "AMIGOf PI", "Pessen Integral PID",
+    "Some Overshoot PID", "No Overshoot PID"
+  };
+  return (rule <= NO_OVERSHOOT_PID) ? names[rule] : "";
+}
+
+byte PID_ATune::GetState()
+{
+  return state;
+}
+
+byte PID_ATune::GetPeakCount()
+{
+  return peakCount;
+}
+
+double PID_ATune::GetInducedAmplitude()
+{
+  return inducedAmplitude;
+}
+
 void PID_ATune::SetOutputStep(double Step)
 {
   oStep = Step;
@@ -778,6 +812,72 @@ void PID_ATune::SetNoiseBand(double band)
   noiseBand = band;
 }
 
+void PID_ATune::clearInputs()
+{
+  inputHead = 0;
+  inputCount = 0;
+  inputSum = 0.0;
+  maxFront = maxCount = 0;
+  minFront = minCount = 0;
+}
+
+// sliding window extrema with monotonic queues:
+// every value enters and leaves each queue once
+// so the cost per sample is constant on average
+void PID_ATune::pushInput(double val)
+{
+  byte pos;
+  if (inputCount < nLookBack)
+  {
+    pos = (inputHead + inputCount) % nLookBack;
+    inputCount++;
+  }
+  else
+  {
+    // drop the oldest value
+    pos = inputHead;
+    inputHead = (inputHead + 1) % nLookBack;
+    inputSum -= lastInputs[pos];
+    if ((maxCount > 0) && (maxQueue[maxFront] == pos))
+    {
+      maxFront = (maxFront + 1) % AUTOTUNE_MAX_LOOKBACK;
+      maxCount--;
+    }
+    if ((minCount > 0) && (minQueue[minFront] == pos))
+    {
+      minFront = (minFront + 1) % AUTOTUNE_MAX_LOOKBACK;
+      minCount--;
+    }
+  }
+  lastInputs[pos] = val;
+  inputSum += val;
+
+  // values that can no longer be the maximum or the minimum of the window
+  // are removed from the back of the queues
+  while ((maxCount > 0) && (lastInputs[maxQueue[(maxFront + maxCount - 1) % AUTOTUNE_MAX_LOOKBACK]] <= val))
+  {
+    maxCount--;
+  }
+  maxQueue[(maxFront + maxCount) % AUTOTUNE_MAX_LOOKBACK] = pos;
+  maxCount++;
+  while ((minCount > 0) && (lastInputs[minQueue[(minFront + minCount - 1) % AUTOTUNE_MAX_LOOKBACK]] >= val))
+  {
+    minCount--;
+  }
+  minQueue[(minFront + minCount) % AUTOTUNE_MAX_LOOKBACK] = pos;
+  minCount++;
+}
+
+double PID_ATune::windowMax()
+{
+  return lastInputs[maxQueue[maxFront]];
+}
+
+double PID_ATune::windowMin()
+{
+  return lastInputs[minQueue[minFront]];
+}
+
 double PID_ATune::GetNoiseBand()
 {
   return noiseBand;
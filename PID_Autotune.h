@@ -41,6 +41,9 @@
 // set larger value for processes with long delays or time constants
 #define AUTOTUNE_MAX_WAIT_MINUTES 5
 
+// maximum number of samples in the lookback window
+#define AUTOTUNE_MAX_LOOKBACK 100
+
 // Ziegler-Nichols type auto tune rules
 // in tabular form
 struct Tuning
@@ -136,6 +139,16 @@ public:
   double GetKi();                       //   computed tuning parameters.  
   double GetKd();                       //
 
+  double GetKu();                       // * ultimate gain and period (s) of the last converged autotune,
+  double GetPu();                       //   from which every tuning rule derives its parameters
+  bool GetTunings(byte, double&,        // * tuning parameters of any rule but AMIGOf for the last
+      double&, double&);                //   converged autotune, returns false if not available
+  static const char *GetRuleName(byte); // * name of the tuning rule
+
+  byte GetState();                      // * progress of the autotune: state of the finite state machine,
+  byte GetPeakCount();                  //   number of peaks of the induced oscillation and
+  double GetInducedAmplitude();         //   their last amplitude estimate (0 until there are 5 peaks)
+
 
 private:
 
@@ -158,13 +171,24 @@ private:
   unsigned long lastPeakTime[5];        // * peak time, most recent in array element 0
   double lastPeaks[5];                  // * peak value, most recent in array element 0
   byte peakCount;
-  double lastInputs[101];               // * process values, most recent in array element 0
-  byte inputCount;
+  double lastInputs[AUTOTUNE_MAX_LOOKBACK]; // * ring buffer of the process values in the lookback window
+  byte inputHead;                       // * position of the oldest value once the window is full
+  byte inputCount;                      // * number of values in the window
+  double inputSum;                      // * running sum of the window
+  byte maxQueue[AUTOTUNE_MAX_LOOKBACK]; // * positions of decreasing values, window maximum first
+  byte maxFront, maxCount;
+  byte minQueue[AUTOTUNE_MAX_LOOKBACK]; // * positions of increasing values, window minimum first
+  byte minFront, minCount;
+  void clearInputs();                   // * empties the lookback window
+  void pushInput(double);               // * adds a value to the window, dropping the oldest when full
+  double windowMax();                   // * maximum of the window in constant time
+  double windowMin();                   // * minimum of the window in constant time
   double outputStart;
   double workingNoiseBand;
   double workingOstep;
   double inducedAmplitude;
   double Kp, Ti, Td;
+  double Ku, Pu;
 
   // used by AMIGOf tuning rule
   double calculatePhaseLag(double);     // * calculate phase lag from noiseBand and inducedAmplitude
@@ -26,39 +26,48 @@
 
 
 #define DELTA_STABILIZATION 1.5
+#define MIN_OUTPUT_STEP 0.05  // relay step of the autotune as a fraction of the window
+#define MAX_OUTPUT_STEP 0.3
+#define AMBIENT 20             // C, for the gain of the identified model
+#define EVAL_STEP 20           // C, set step of the simulated scenario
+#define EVAL_LOAD 0.1          // duty lost to the simulated disturbance
+#define EVAL_PERIODS 20        // simulated horizon in ultimate periods
 
   void PidAutotuneControl::Reset() {
-    pidtuning->Cancel();
+    pidtuning.Cancel();
     numStable=0;
     status=PidAutotuneStatus::Init;
 
-    PidControl::Control(false);
+    PidControl::Control(false,millis());
   }
 
   
   PidAutotuneControl::PidAutotuneControl(const char *_name, IControlAction *_action, double *set, double *actual, double initialKp, double initialKi, double initialKd, int windowsize) :
-      PidControl(_name,_action,set,actual,initialKp,initialKi,initialKd,windowsize)
+      PidControl(_name,_action,set,actual,initialKp,initialKi,initialKd,windowsize),
+      // the autotune reads the temperature and drives the pid output (ms of the window)
+      pidtuning(actual,&output)
   {    
-    pidtuning=new PID_ATune(set,actual);
-    pidtuning->SetControlType(1); // PID
-    pidtuning->SetNoiseBand(0.5);  // half degree
-    pidtuning->SetOutputStep(10);  // 10 degree
-    pidtuning->SetLookbackSec(20); // 20 seconds
+    pidtuning.SetControlType(1); // PID
+    pidtuning.SetNoiseBand(0.5);  // half degree
+    pidtuning.SetLookbackSec(20); // 20 seconds
+
+    tunedKp=tunedKi=tunedKd=0;
+    saved=false;
+    numCandidates=0;
+    best=-1;
+    startTime=endTime=0;
    
     Reset();
   }
 
 
-  
-  // Parent destructors are always called
-  PidAutotuneControl::~PidAutotuneControl()  {
-    delete pidtuning;
-  }
-
 
-  void PidAutotuneControl::Control(bool started) {
-    if (status==PidAutotuneStatus::Done)
+  void PidAutotuneControl::Control(bool started, unsigned long now) {
+    // once finished the zone is controlled by the pid with the tuned gains (the initial ones if tuning failed)
+    if (status==PidAutotuneStatus::Done || status==PidAutotuneStatus::Failed) {
+      PidControl::Control(started,now);
       return;
+    }
     
     if (!started) {
         Reset();
@@ -67,36 +76,64 @@
 
     // tuning starts when we have reached the setTemp and it is stabilized.
     if (status==PidAutotuneStatus::Tuning) {
-      // pidtuning->Runtime steps the stable output to understand how actual values change accordingly, this must be repeated till it returns a value!=0
-      if (pidtuning->Runtime()!=0) {
-        PidControl::Control(false);
-
-        tunedKp=pidtuning->GetKp();
-        tunedKi=pidtuning->GetKi();
-        tunedKd=pidtuning->GetKd();
+      active=action->Active();
+
+      // pidtuning.Runtime steps the output above and below the stable one to understand how actual values change accordingly, this must be repeated till it returns true
+      if (pidtuning.Runtime()) {
+        endTime=now;
+
+        if (pidtuning.GetState()==PID_ATune::CONVERGED) {
+          RankCandidates();
+          if (best>=0) {
+            tunedKp=candidates[best].gains.kp;
+            tunedKi=candidates[best].gains.ki;
+            tunedKd=candidates[best].gains.kd;
+          }
+          else {
+            tunedKp=pidtuning.GetKp();
+            tunedKi=pidtuning.GetKi();
+            tunedKd=pidtuning.GetKd();
+          }
+          pid.SetTunings(tunedKp,tunedKi,tunedKd);
+
+          status=PidAutotuneStatus::Done;
+          Serial.printf("EspOven: PidAutotuneControl %s autotuning done, rule %s tuned Kp %f Ki %f Kd %f\n",name,(best>=0)?candidates[best].rule:PID_ATune::GetRuleName(pidtuning.GetControlType()),tunedKp,tunedKi,tunedKd);
+        }
+        else {
+          status=PidAutotuneStatus::Failed;
+          Serial.printf("EspOven: PidAutotuneControl %s autotuning failed after %d peaks, keeping the initial gains\n",name,pidtuning.GetPeakCount());
+        }
 
-        status=PidAutotuneStatus::Done;
-        
-        Serial.printf("EspOven: PidAutotuneControl autotuning done, tuned Kp %f Ki %f Kd %d\n",tunedKp,tunedKi,tunedKd);
+        // Runtime has restored the stable output, the pid restarts from it
+        smith.Reset();
+        pid.SetAutomatic(true,*set,*actual,output);
+        PidControl::Control(true,now);
       }
       else {
-        Serial.printf("EspOven: PidAutotuneControl autotuning %s set %f actual %f\n",name,*set,*actual); 
-
-        PidControl::Control(true);
+        demand=constrain(output,0.0,(double) windowsize)/windowsize;
+        Serial.printf("EspOven: PidAutotuneControl autotuning %s set %f actual %f output %f peaks %d\n",name,*set,*actual,output,pidtuning.GetPeakCount()); 
       }
     }
     else {
-      if (status==PidAutotuneStatus::Init)
+      if (status==PidAutotuneStatus::Init) {
         status=PidAutotuneStatus::Stabilization;
+        startTime=now;
+      }
       
       // Before the tuning starts, we need first to stabilize actual to set temp by using standard pid control (25 cycles)
-      PidControl::Control(true);
+      PidControl::Control(true,now);
 
       if (abs(*set-*actual)<DELTA_STABILIZATION) {
         if (numStable++>25) {
           status=PidAutotuneStatus::Tuning;
           numStable=0;
-          Serial.printf("EspOven: PidAutotuneControl actual temp stabilized, moving to the tuning process\n");
+
+          // the relay steps symmetrically around the output holding the temperature, as far as the window allows
+          double step=min(output,windowsize-output);
+          pidtuning.SetOutputStep(constrain(step,MIN_OUTPUT_STEP*windowsize,MAX_OUTPUT_STEP*windowsize));
+          pid.SetAutomatic(false,*set,*actual,output);
+
+          Serial.printf("EspOven: PidAutotuneControl actual temp stabilized, moving to the tuning process (output %f step %f)\n",output,pidtuning.GetOutputStep());
         }
       }
       else {
@@ -107,6 +144,86 @@
     }
   }
 
-ControlType PidAutotuneControl::GetControlType() {
-    return ControlType::PIDAutotune;
+
+  // a single relay oscillation gives the ultimate gain and period used by all the tuning rules: the gains of
+  // each rule are simulated on the model identified from them (with the static gain of the stable output)
+  // and the best one is chosen. Without a consistent model the gains of the autotune control type are used.
+  void PidAutotuneControl::RankCandidates() {
+    double stable=output/windowsize;  // Runtime has restored the stable output
+    double ku=pidtuning.GetKu()/windowsize;
+
+    numCandidates=0;
+    best=-1;
+
+    if (stable<=0 || !FopdtModel::FromUltimate((*set-AMBIENT)/stable,ku,pidtuning.GetPu(),model)) {
+      Serial.printf("EspOven: PidAutotuneControl %s no model from ku %f pu %f stable duty %f\n",name,ku,pidtuning.GetPu(),stable);
+      return;
+    }
+
+    PidEvaluator eval(model,*set-AMBIENT,EVAL_STEP,min(EVAL_LOAD,(1-stable)/2),EVAL_PERIODS*pidtuning.GetPu());
+    if (!eval.IsValid())
+      return;
+
+    for (byte r=0;r<=PID_ATune::NO_OVERSHOOT_PID;r++) {
+      AutotuneCandidate &c=candidates[numCandidates];
+
+      c.rule=PID_ATune::GetRuleName(r);
+      if (pidtuning.GetTunings(r,c.gains.kp,c.gains.ki,c.gains.kd))
+        numCandidates++;
+    }
+    for (int r=0;r<TUNING_RULES;r++) {
+      AutotuneCandidate &c=candidates[numCandidates++];
+
+      c.rule=FopdtModel::GetRuleName((TuningRule) r);
+      c.gains=model.Tune((TuningRule) r,windowsize);
+    }
+
+    for (int i=0;i<numCandidates;i++) {
+      AutotuneCandidate &c=candidates[i];
+
+      c.score=eval.Evaluate(c.gains,windowsize);
+      if (best<0 || c.score.cost<candidates[best].score.cost)
+        best=i;
+
+      Serial.printf("EspOven: PidAutotuneControl %s rule %s Kp %f Ki %f Kd %f overshoot %f cost %f\n",name,c.rule,c.gains.kp,c.gains.ki,c.gains.kd,c.score.overshoot,c.score.cost);
+    }
+
+    Serial.printf("EspOven: PidAutotuneControl %s model gain %f tau %f dead time %f, best rule %s\n",name,model.gain,model.tau,model.deadTime,candidates[best].rule);
+  }
+
+
+  void PidAutotuneControl::GetJson(JsonObject obj) {
+    unsigned long end=(status==PidAutotuneStatus::Done || status==PidAutotuneStatus::Failed)?endTime:millis();
+
+    obj["name"]=name;
+    obj["status"]=(int) status;
+    obj["state"]=pidtuning.GetState();
+    obj["peaks"]=pidtuning.GetPeakCount();
+    obj["amplitude"]=pidtuning.GetInducedAmplitude();
+    obj["elapsed"]=(status==PidAutotuneStatus::Init)?0:(end-startTime)/1000;  // s
+    obj["kp"]=tunedKp;
+    obj["ki"]=tunedKi;
+    obj["kd"]=tunedKd;
+    obj["saved"]=saved;
+
+    if (numCandidates==0)
+      return;
+
+    obj["rule"]=candidates[best].rule;
+    JsonObject m=obj.createNestedObject("model");
+    m["gain"]=model.gain;
+    m["tau"]=model.tau;
+    m["deadTime"]=model.deadTime;
+
+    JsonArray cs=obj.createNestedArray("candidates");
+    for (int i=0;i<numCandidates;i++) {
+      JsonObject c=cs.createNestedObject();
+
+      c["rule"]=candidates[i].rule;
+      c["kp"]=candidates[i].gains.kp;
+      c["ki"]=candidates[i].gains.ki;
+      c["kd"]=candidates[i].gains.kd;
+      c["overshoot"]=candidates[i].score.overshoot;
+      c["cost"]=candidates[i].score.cost;
+    }
   }
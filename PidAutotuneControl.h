@@ -22,32 +22,53 @@
 #ifndef _PidAutotuneControl_h_
 #define _PidAutotuneControl_h_
 
+#include <ArduinoJson.h>
 #include "IControl.h"
 //#include <ESP8266WiFi.h>
-#include <PID_v1.h>
-#include "PID_AutoTune.h"
+#include "PID_Autotune.h"
 #include "PidControl.h"
+#include "FopdtModel.h"
+#include "PidEvaluator.h"
 
-enum PidAutotuneStatus { Init=0, Stabilization=1, Tuning=2, Done=3};
+enum PidAutotuneStatus { Init=0, Stabilization=1, Tuning=2, Done=3, Failed=4};
+
+// the rules of PID_ATune but AMIGOf plus those of FopdtModel
+#define AUTOTUNE_CANDIDATES (PID_ATune::NO_OVERSHOOT_PID+TUNING_RULES)
+
+// gains of a tuning rule and their simulated performance on the identified model
+struct AutotuneCandidate {
+  const char *rule;
+  PidGains gains;
+  PidScore score;
+};
 
 class PidAutotuneControl: public PidControl {
 
 public:
+  static const ControlType Type=ControlType::PIDAutotune;
+
   // set temperature must be fixed at a fixed value for all tuning process
   PidAutotuneControl(const char *_name, IControlAction *_action, double *set, double *actual, double initialKp, double initialKi, double initialKd, int windowsize);
-  ~PidAutotuneControl();
 
-  virtual void Control(bool started) override;
-  virtual ControlType GetControlType() override;
+  void Control(bool started, unsigned long now);
   void Reset();
+  void GetJson(JsonObject obj);
 
   PidAutotuneStatus status;
   double tunedKp,tunedKi,tunedKd;
+  bool saved;  // tuned gains written to the configuration
+  
+  FopdtModel model;  // identified from the relay oscillation and the stable output
+  AutotuneCandidate candidates[AUTOTUNE_CANDIDATES];
+  int numCandidates,best;
   
   protected:
-    PID_ATune *pidtuning;
+    void RankCandidates();
+
+    PID_ATune pidtuning;
     double setTemp;
     int numStable;
+    unsigned long startTime,endTime;
 };
  
 #endif
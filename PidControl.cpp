@@ -20,9 +20,8 @@
  * DEALINGS IN THE SOFTWARE.                                                   *
  *******************************************************************************/
 
-#include <ESP8266WiFi.h>
+#include <Arduino.h>
 #include "PidControl.h"
-#include <PID_v1.h>
 
   // for digital relay control (not SSR)
   PidControl::PidControl(const char *_name, IControlAction *_action, double *_set, double *_actual, double Kp, double Ki, double Kd, int _windowsize) : IControl(_name,_action) {
@@ -31,18 +30,24 @@
     windowsize=_windowsize;
     oldstarted=false;
     output=0;
+    ffWeight=0;
     
-    pid=new PID(actual, &output, set,Kp,Ki,Kd, DIRECT); 
-    //turn the PID off
-    pid->SetMode(MANUAL);
+    pid.SetTunings(Kp,Ki,Kd);
     
     //tell the PID to range between 0 and the full window size
-    pid->SetOutputLimits(0, windowsize);
+    pid.SetOutputLimits(0, windowsize);
   }
 
 
-  PidControl::~PidControl() {
-    delete pid;
+  // gains and feed forward are interpolated from the table using the set temperature, so they don't change
+  // while the oven is heating up but only when the set temperature is changed. Without a table Control leaves the
+  // feed forward alone, so the one of a previous table is cleared here
+  void PidControl::SetGainSchedule(const GainPoint *points, int count, double _ffWeight) {
+    schedule.Set(points,count);
+    ffWeight=_ffWeight;
+
+    if (schedule.GetCount()==0 || ffWeight==0)
+      pid.SetFeedForward(0);
   }
 
 
@@ -60,48 +65,47 @@
    size.  Lastly, we add some logic that translates the PID
    output into "Relay On Time" with the remainder of the
    window being "Relay Off Time"
+
+   The last step is done by the RelayScheduler, here the
+   output is converted to the duty demand of the heater.
  ********************************************************/
-void PidControl::Control(bool started) {
+void PidControl::Control(bool started, unsigned long now) {
     active=action->Active();
     
     if (started) {
       //started is true, turn the PID on if there is a transition from false to true
-      if (!oldstarted)
-        pid->SetMode(AUTOMATIC);
+      if (!oldstarted) {
+        smith.Reset();
+        pid.SetAutomatic(true,*set,*actual,output);
+      }
 
-      // output will contain the number of ms of the window (0,windowsize) that the heater must be on
-      pid->Compute();
+      if (schedule.GetCount()>0) {
+        double kp=pid.GetKp(),ki=pid.GetKi(),kd=pid.GetKd(),duty=0;
 
-      unsigned long now = millis()%windowsize;  // get where we are in windowsize
+        schedule.Interpolate(*set,kp,ki,kd,duty);
+        pid.SetTunings(kp,ki,kd);
+        pid.SetFeedForward(ffWeight*duty*windowsize);
+      }
 
-      Serial.printf("EspOven: PidControl %s (%d) set %f actual %f output %f now %d\n",name,started,*set,*actual,output, now);
+      // the smith predictor adds to the measurement the effect of the demand not yet seen because of the dead time
+      smith.Update(demand,now);
+      double feedback=*actual+smith.GetCorrection();
 
-      if (now<=output) {
-        if (!action->Active()) {
-          Serial.printf("EspOven: PidControl turning on %s heater temperature set %f actual %f\n", name,*set,*actual);
-          action->On();
-        }
-      }
-      else {
-        if (action->Active()) {
-          Serial.printf("EspOven: PidControl turning off %s heater temperature set %f actual %f\n", name,*set,*actual);
-          action->Off();
-        }
-      }
+      // output will contain the number of ms of the window (0,windowsize) that the heater must be on
+      pid.Compute(*set,feedback,now,output);
+
+      demand=output/windowsize;
+
+      Serial.printf("EspOven: PidControl %s (%d) set %f actual %f feedback %f output %f demand %f heating %d\n",name,started,*set,*actual,feedback,output,demand,active);
     }
     // started is false and there has been a transition from true to false.
     else if (oldstarted) {
       //turn the PID off
-      pid->SetMode(MANUAL);
+      pid.SetAutomatic(false,*set,*actual,output);
         
-      action->Off();
+      output=0;
+      demand=0;
     } 
 
     oldstarted=started;
   }
-
-
-  ControlType PidControl::GetControlType() {
-    return ControlType::PID;
-  }
-  
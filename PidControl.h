@@ -24,23 +24,29 @@
 
 #include "IControl.h"
 //#include <ESP8266WiFi.h>
-#include <PID_v1.h>
+#include "PidEngine.h"
+#include "GainSchedule.h"
+#include "SmithPredictor.h"
 
 class PidControl: public IControl {
 public:  
+  static const ControlType Type=ControlType::PID;
+
   bool active;
     
-  PID *pid;
+  PidEngine pid;
+  SmithPredictor smith;  // dead time compensation of the feedback, disabled unless a model is set
   
   PidControl(const char *_name, IControlAction *_action, double *set, double *actual, double Kp, double Ki, double Kd, int windowsize);
-  ~PidControl();
-  virtual void Control(bool started) override;
-  virtual ControlType GetControlType() override;
+  void SetGainSchedule(const GainPoint *points, int count, double _ffWeight);
+  void Control(bool started, unsigned long now);
 
 protected:
   double *set,*actual,output;
   int windowsize;
   bool oldstarted;
+  GainSchedule schedule;
+  double ffWeight;  // fraction of the scheduled steady state duty used as feed forward
 };
 
 #endif
@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include "PidEngine.h"
+
+
+  static double Clamp(double v, double min, double max) {
+    return (v<min)?min:((v>max)?max:v);
+  }
+
+
+  // at steady state (input==set) the proportional term is kp*(b-1)*set, the integral must be able to compensate it
+  // and the feed forward
+  double PidEngine::ClampIntegral(double i, double set) {
+    double offset=kp*(1-b)*set-ff;
+
+    return Clamp(i,outMin+offset,outMax+offset);
+  }
+
+
+  PidEngine::PidEngine() {
+    kp=0;
+    ki=0;
+    kd=0;
+    b=1;
+    n=10;
+    outMin=0;
+    outMax=255;
+    sampleTime=100;
+    lastTime=0;
+    first=true;
+    automatic=false;
+    pTerm=0;
+    iTerm=0;
+    dTerm=0;
+    ff=0;
+    lastInput=0;
+    lastSet=0;
+  }
+
+
+  // the integral absorbs the change of the proportional term, so the output doesn't jump
+  void PidEngine::SetTunings(double _kp, double _ki, double _kd) {
+    if (_kp<0 || _ki<0 || _kd<0)
+      return;
+
+    if (automatic) {
+      double newP=_kp*(b*lastSet-lastInput);
+      iTerm=ClampIntegral(iTerm+pTerm-newP,lastSet);
+      pTerm=newP;
+    }
+
+    kp=_kp;
+    ki=_ki;
+    kd=_kd;
+  }
+
+
+  void PidEngine::SetOutputLimits(double _outMin, double _outMax) {
+    if (_outMin>=_outMax)
+      return;
+
+    outMin=_outMin;
+    outMax=_outMax;
+    iTerm=ClampIntegral(iTerm,lastSet);
+  }
+
+
+  void PidEngine::SetSetpointWeight(double _b) {
+    _b=Clamp(_b,0,1);
+
+    if (automatic) {
+      double newP=kp*(_b*lastSet-lastInput);
+      iTerm=ClampIntegral(iTerm+pTerm-newP,lastSet);
+      pTerm=newP;
+    }
+
+    b=_b;
+  }
+
+
+  void PidEngine::SetDerivativeFilter(double _n) {
+    if (_n>0)
+      n=_n;
+  }
+
+
+  void PidEngine::SetSampleTime(unsigned long ms) {
+    sampleTime=ms;
+  }
+
+
+  void PidEngine::SetFeedForward(double _ff) {
+    ff=_ff;
+  }
+
+
+  void PidEngine::SetAutomatic(bool _automatic, double set, double input, double output) {
+    if (_automatic && !automatic) {
+      // bumpless transfer: the integral starts from the output less the proportional part
+      pTerm=kp*(b*set-input);
+      dTerm=0;
+      iTerm=ClampIntegral(output-pTerm-ff,set);
+      lastInput=input;
+      lastSet=set;
+      first=true;
+    }
+
+    automatic=_automatic;
+  }
+
+
+  bool PidEngine::IsAutomatic() {
+    return automatic;
+  }
+
+
+  bool PidEngine::Compute(double set, double input, unsigned long now, double &output) {
+    if (!automatic)
+      return false;
+
+    // first compute after switching to automatic: no elapsed time yet
+    if (first) {
+      first=false;
+      lastTime=now;
+      lastInput=input;
+      lastSet=set;
+      pTerm=kp*(b*set-input);
+      output=Clamp(pTerm+iTerm+ff,outMin,outMax);
+      return true;
+    }
+
+    unsigned long elapsed=now-lastTime;
+    if (elapsed<sampleTime || elapsed==0)
+      return false;
+
+    double dt=elapsed/1000.0;
+    double error=set-input;
+
+    pTerm=kp*(b*set-input);
+
+    // derivative on measurement with first order filter: tf*dD/dt+D=-kd*dInput/dt
+    double tf=(kp>0 && n>0)?(kd/kp)/n:0;
+    dTerm=(tf*dTerm-kd*(input-lastInput))/(tf+dt);
+
+    // conditional integration: the integral grows only if it does not push the output further in saturation
+    double newI=iTerm+ki*error*dt;
+    double unsat=pTerm+newI+dTerm+ff;
+
+    if (!((unsat>outMax && error>0) || (unsat<outMin && error<0)))
+      iTerm=ClampIntegral(newI,set);
+
+    output=Clamp(pTerm+iTerm+dTerm+ff,outMin,outMax);
+
+    lastInput=input;
+    lastSet=set;
+    lastTime=now;
+
+    return true;
+  }
+
+
+  double PidEngine::GetKp() {
+    return kp;
+  }
+
+
+  double PidEngine::GetKi() {
+    return ki;
+  }
+
+
+  double PidEngine::GetKd() {
+    return kd;
+  }
+
+
+  double PidEngine::GetProportional() {
+    return pTerm;
+  }
+
+
+  double PidEngine::GetIntegral() {
+    return iTerm;
+  }
+
+
+  double PidEngine::GetDerivative() {
+    return dTerm;
+  }
+
+
+  double PidEngine::GetFeedForward() {
+    return ff;
+  }
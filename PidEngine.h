@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _PidEngine_h_
+#define _PidEngine_h_
+
+// Plain PID algorithm without any Arduino dependency (it is also compiled by the host tools).
+// Gains have the same units of PID_v1: Ki per second and Kd in seconds, but the integral and the derivative
+// use the actual time elapsed between two Compute calls instead of assuming a fixed sample time.
+//  - proportional on the weighted error b*set-input (setpoint weighting, b<1 reduces the overshoot on set changes)
+//  - derivative on measurement, low pass filtered with time constant Td/N
+//  - conditional integration anti-windup: the integral is frozen while the output is saturated and the error pushes further
+//  - bumpless transfer when switching from manual to automatic and when changing tunings or setpoint weight
+//  - optional feed forward added to the output (e.g. the steady state output needed to hold the set temperature)
+class PidEngine {
+public:
+  PidEngine();
+
+  void SetTunings(double _kp, double _ki, double _kd);
+  void SetOutputLimits(double _outMin, double _outMax);
+  void SetSetpointWeight(double _b);
+  void SetDerivativeFilter(double _n);
+  void SetSampleTime(unsigned long ms);
+  void SetFeedForward(double _ff);
+
+  // manual mode keeps the output unchanged, switching to automatic starts from output
+  void SetAutomatic(bool automatic, double set, double input, double output);
+  bool IsAutomatic();
+
+  // returns true if the output has been computed (at least sample time ms since the last time)
+  bool Compute(double set, double input, unsigned long now, double &output);
+
+  double GetKp();
+  double GetKi();
+  double GetKd();
+  double GetProportional();
+  double GetIntegral();
+  double GetDerivative();
+  double GetFeedForward();
+
+protected:
+  double kp,ki,kd,b,n;
+  double outMin,outMax;
+  unsigned long sampleTime,lastTime;
+  bool automatic,first;
+
+  double pTerm,iTerm,dTerm,ff;
+  double lastInput,lastSet;
+
+  double ClampIntegral(double i, double set);
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+#include <math.h>
+#include "PidEvaluator.h"
+#include "PidEngine.h"
+
+
+  PidEvaluator::PidEvaluator(const FopdtModel &_model, double _rise, double _step, double _load, double _horizon) {
+    model=_model;
+    rise=_rise;
+    step=_step;
+    load=_load;
+    horizon=_horizon;
+  }
+
+
+  // the initial steady state and the final one with the load must be reachable with a duty in 0..1
+  bool PidEvaluator::IsValid() const {
+    return model.IsValid() && step>0 && horizon>0 && rise>step && rise/model.gain+load<1;
+  }
+
+
+  PidScore PidEvaluator::Evaluate(const PidGains &gains, double outputScale) const {
+    PidScore score={0,0,0};
+    double dt=horizon/EVAL_STEPS;
+    unsigned long dtMs=(unsigned long) (dt*1000);
+    double decay=exp(-dt/model.tau);
+    int delay=(int) (model.deadTime/dt+0.5);
+    double history[EVAL_MAX_DELAY];
+    int head=0;
+
+    if (!IsValid() || dtMs==0)
+      return score;
+    if (delay>=EVAL_MAX_DELAY)
+      delay=EVAL_MAX_DELAY-1;
+
+    // steady state below the set temperature
+    double x=rise-step;
+    double out=x/model.gain*outputScale;
+    for (int i=0;i<delay;i++)
+      history[i]=x/model.gain;
+
+    PidEngine pid;
+    pid.SetTunings(gains.kp,gains.ki,gains.kd);
+    pid.SetOutputLimits(0,outputScale);
+    pid.SetSampleTime(dtMs);
+    pid.SetAutomatic(true,x,x,out);
+
+    for (int k=0;k<EVAL_STEPS;k++) {
+      pid.Compute(rise,x,k*dtMs,out);
+
+      // the duty reaches the zone after the dead time
+      double u=out/outputScale;
+      if (delay>0) {
+        double d=history[head];
+        history[head]=u;
+        head=(head+1)%delay;
+        u=d;
+      }
+      if (k>=EVAL_STEPS/2)
+        u-=load;
+
+      x=model.gain*u+(x-model.gain*u)*decay;
+
+      score.iae+=fabs(rise-x)*dt;
+      if (k<EVAL_STEPS/2 && x-rise>score.overshoot)
+        score.overshoot=x-rise;
+    }
+
+    score.cost=score.iae/(step*horizon)+EVAL_OVERSHOOT_WEIGHT*score.overshoot/step;
+
+    return score;
+  }
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _PidEvaluator_h_
+#define _PidEvaluator_h_
+
+// Closed loop simulation of PidEngine on a first order plus dead time model, without any Arduino dependency
+// (it is also compiled by the host tools), to compare candidate gains before using them on the oven: a step
+// of the set temperature from the steady state below it, then halfway a load disturbance (e.g. the door
+// opened) taking away part of the heater duty. The heater duty is limited to 0..1 as on the oven.
+
+#include "FopdtModel.h"
+
+#define EVAL_STEPS 1000     // simulation steps over the horizon
+#define EVAL_MAX_DELAY 128  // dead time in steps, longer ones are truncated
+#define EVAL_OVERSHOOT_WEIGHT 1.0
+
+
+struct PidScore {
+  double iae;        // C*s, integral of the absolute error over the horizon
+  double overshoot;  // C, maximum above the set temperature after the step
+  double cost;       // iae/(step*horizon)+EVAL_OVERSHOOT_WEIGHT*overshoot/step, lower is better
+};
+
+
+class PidEvaluator {
+public:
+  // rise is the set temperature above the ambient, step the set change and load the duty lost to the disturbance
+  PidEvaluator(const FopdtModel &_model, double _rise, double _step, double _load, double _horizon);
+
+  bool IsValid() const;
+  PidScore Evaluate(const PidGains &gains, double outputScale) const;
+
+protected:
+  FopdtModel model;
+  double rise,step,load,horizon;
+};
+
+#endif
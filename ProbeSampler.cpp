@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <ESP8266WiFi.h>
+#include "ProbeSampler.h"
+
+ProbeSampler probeSampler;
+
+
+  static void ProbeSamplerTimer(void *arg) {
+    ((ProbeSampler *) arg)->OnTimer();
+  }
+
+
+
+  void IntervalStats::Reset() {
+    count=0;
+    shortest=0;
+    longest=0;
+    sum=0;
+    sumSq=0;
+  }
+
+
+  void IntervalStats::Add(unsigned long us) {
+    if (count==0 || us<shortest)
+      shortest=us;
+    if (count==0 || us>longest)
+      longest=us;
+    sum+=us;
+    sumSq+=(double) us*us;
+    count++;
+  }
+
+
+  // ms with the us resolution
+  void IntervalStats::GetJson(JsonObject obj) {
+    double mean=(count>0)?sum/count:0;
+    double var=(count>0)?sumSq/count-mean*mean:0;
+
+    obj["count"]=count;
+    obj["min"]=shortest/1000.0;
+    obj["max"]=longest/1000.0;
+    obj["mean"]=mean/1000.0;
+    obj["std"]=(var>0)?sqrt(var)/1000.0:0;
+  }
+
+
+
+  ProbeSampler::ProbeSampler() {
+    memset(&timer,0,sizeof(timer));
+    memset(probes,0,sizeof(probes));
+    numProbes=0;
+    period=SAMPLE_PERIOD;
+    hook=NULL;
+    lastTick=0;
+    tickStats.Reset();
+    latencyStats.Reset();
+  }
+
+
+  void ProbeSampler::Begin(MAX31855 **_probes, int _numProbes, int _period, SampleHook _hook) {
+    os_timer_disarm(&timer);
+
+    for (int i=0;i<MAX_ZONES;i++)
+      probes[i]=(i<_numProbes)?_probes[i]:NULL;
+    numProbes=_numProbes;
+    period=_period;
+    hook=_hook;
+    lastTick=0;
+
+    // the sdk keeps a repeating timer on its own schedule, a late tick doesn't delay the next ones
+    os_timer_setfn(&timer,ProbeSamplerTimer,this);
+    os_timer_arm(&timer,period,true);
+
+    Serial.printf("EspOven: ProbeSampler %d probes every %d ms\n",numProbes,period);
+  }
+
+
+  // no logging nor allocation here, the words are decoded by the zones in loop()
+  void ProbeSampler::OnTimer() {
+    ProbeSample sample;
+    unsigned long us=micros();
+
+    if (lastTick!=0)
+      tickStats.Add(us-lastTick);
+    lastTick=us;
+
+    sample.ms=millis();
+    for (int i=0;i<MAX_ZONES;i++)
+      sample.status[i]=(probes[i]!=NULL)?probes[i]->readRaw():0;
+
+    if (hook!=NULL)
+      hook(sample);
+    queue.Push(sample);
+  }
+
+
+  bool ProbeSampler::Pop(ProbeSample &sample) {
+    return queue.Pop(sample);
+  }
+
+
+  void ProbeSampler::Controlled(const ProbeSample &sample) {
+    latencyStats.Add((millis()-sample.ms)*1000);
+  }
+
+
+  void ProbeSampler::ResetStats() {
+    tickStats.Reset();
+    latencyStats.Reset();
+  }
+
+
+  void ProbeSampler::GetJson(JsonObject obj) {
+    obj["period"]=period;
+    obj["overruns"]=queue.GetOverruns();
+    tickStats.GetJson(obj.createNestedObject("tick"));
+    latencyStats.GetJson(obj.createNestedObject("latency"));
+  }
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _ProbeSampler_h_
+#define _ProbeSampler_h_
+
+#include <ArduinoJson.h>
+#include "MAX31855.h"
+#include "SampleQueue.h"
+#include "configuration.h"
+
+extern "C" {
+#include "user_interface.h"
+}
+
+#define SAMPLE_PERIOD 100  // ms between two samples of the probes
+#define SAMPLE_QUEUE  16   // samples buffered while loop() is busy (15, 1.5s)
+
+
+// the probes of all the zones read by one tick of the timer
+struct ProbeSample {
+  unsigned long ms;              // millis() of the tick, the time the controls see
+  uint32_t status[MAX_ZONES];    // raw MAX31855 words, see MAX31855::setStatus
+};
+
+
+// called by the timer with each sample before it is queued, for the checks that can't wait for loop()
+typedef void (*SampleHook)(const ProbeSample &sample);
+
+
+// min, max, mean and deviation of a series of intervals in us
+struct IntervalStats {
+  unsigned long count;
+  unsigned long shortest,longest;
+  double sum,sumSq;
+
+  void Reset();
+  void Add(unsigned long us);
+  void GetJson(JsonObject obj);
+};
+
+
+// Reads the probes at a fixed rate from a software timer of the SDK (timer1 drives BurstFire) and hands the samples
+// to loop() through a lock free queue, so the controls get equally spaced samples with their own timestamps however
+// long loop() takes. The timer callback runs between the tasks of the SDK, that is whenever loop() returns or yields
+// (delay, network writes), so the period is late at most by the longest stretch of code that doesn't yield.
+class ProbeSampler {
+public:
+  ProbeSampler();
+  // probes of the zones, NULL for a zone without probe
+  void Begin(MAX31855 **_probes, int _numProbes, int _period, SampleHook _hook=NULL);
+  bool Pop(ProbeSample &sample);
+  // records the delay between the tick of a sample and its control
+  void Controlled(const ProbeSample &sample);
+  void ResetStats();
+  void GetJson(JsonObject obj);
+
+  void OnTimer();  // called by the timer
+
+protected:
+  os_timer_t timer;
+  MAX31855 *probes[MAX_ZONES];
+  int numProbes,period;
+  SampleHook hook;
+  SampleQueue<ProbeSample,SAMPLE_QUEUE> queue;
+  unsigned long lastTick;               // micros() of the last tick, 0 none
+  // period of the ticks and delay from the tick to the control, the callback never preempts loop() so no lock
+  IntervalStats tickStats,latencyStats;
+};
+
+extern ProbeSampler probeSampler;
+
+#endif
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <math.h>
+#include "ProbeVoter.h"
+
+static const char *sourceNames[]={ "both", "primary", "secondary", "none" };
+
+
+  ProbeVoter::ProbeVoter() {
+    tolerance=PROBE_TOLERANCE;
+    divergences=0;
+    fallbacks=0;
+    Reset();
+  }
+
+
+  void ProbeVoter::SetTolerance(double _tolerance) {
+    tolerance=_tolerance;
+  }
+
+
+  void ProbeVoter::Reset() {
+    last=0;
+    bias=0;
+    source=ProbeSource::None;
+    diverging=false;
+    agree=0;
+  }
+
+
+  bool ProbeVoter::Vote(bool ok1, double t1, bool ok2, double t2, double &temp) {
+    ProbeSource next;
+    double t;
+
+    if (ok1 && ok2) {
+      if (fabs(t1-t2)>tolerance) {
+        if (!diverging)
+          divergences++;
+        diverging=true;
+        agree=0;
+      }
+      else if (diverging && ++agree>=PROBE_AGREE)
+        diverging=false;
+
+      if (diverging) {
+        next=(t1>=t2)?ProbeSource::Primary:ProbeSource::Secondary;
+        t=fmax(t1,t2);
+      }
+      else {
+        next=ProbeSource::Both;
+        t=(t1+t2)/2;
+      }
+    }
+    else if (ok1) {
+      next=ProbeSource::Primary;
+      t=t1;
+    }
+    else if (ok2) {
+      next=ProbeSource::Secondary;
+      t=t2;
+    }
+    else {
+      source=ProbeSource::None;
+      bias=0;
+      return false;
+    }
+
+    if (source==ProbeSource::Both && next!=ProbeSource::Both)
+      fallbacks++;
+
+    // the step of a new source fades out, there is nothing to blend from after both probes failed
+    if (next!=source && source!=ProbeSource::None)
+      bias=last-t;
+    else
+      bias*=PROBE_BLEND;
+
+    source=next;
+    last=t+bias;
+    temp=last;
+    return true;
+  }
+
+
+  ProbeSource ProbeVoter::GetSource() {
+    return source;
+  }
+
+
+  unsigned long ProbeVoter::GetDivergences() {
+    return divergences;
+  }
+
+
+  unsigned long ProbeVoter::GetFallbacks() {
+    return fallbacks;
+  }
+
+
+  const char *ProbeVoter::GetSourceName(ProbeSource source) {
+    return sourceNames[(int) source];
+  }
@@ -0,0 +1,59 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _ProbeVoter_h_
+#define _ProbeVoter_h_
+
+#define PROBE_TOLERANCE 10    // default C two probes of a zone may differ and still agree
+#define PROBE_AGREE     50    // samples the probes must agree again after a divergence before they are averaged (5s)
+#define PROBE_BLEND     0.95  // decay each sample of the step of a change of source (about 2s)
+
+enum class ProbeSource { Both=0, Primary=1, Secondary=2, None=3 };
+
+
+// Temperature of a zone read by two thermocouples: their average while they agree within the tolerance, the healthy
+// one on a fault of the other. When both read but disagree two probes make no majority, so the hotter one is kept: a
+// thermocouple failing in an oven (pulled out of its zone, junction damaged, leads shunted) reads low, and controlling
+// on the low reading would overheat. A change of the source is blended in so the controller sees no step. No Arduino
+// dependency, the host tools compile it too.
+class ProbeVoter {
+public:
+  ProbeVoter();
+  void SetTolerance(double _tolerance);
+  void Reset();
+  // false when neither probe can be used, temp is then unchanged
+  bool Vote(bool ok1, double t1, bool ok2, double t2, double &temp);
+
+  ProbeSource GetSource();
+  unsigned long GetDivergences();  // times the probes started to disagree
+  unsigned long GetFallbacks();    // times the zone went from two probes to one
+  static const char *GetSourceName(ProbeSource source);
+
+protected:
+  double tolerance;
+  double last,bias;   // last temperature returned and step still blended in
+  ProbeSource source;
+  bool diverging;
+  int agree;          // samples in agreement during a divergence
+  unsigned long divergences,fallbacks;
+};
+
+#endif
@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+#include <math.h>
+#include "Program.h"
+#include "SafetySupervisor.h"
+
+
+  bool Program::IsValid(int zones) const {
+    if (numSegments<0 || numSegments>MAX_SEGMENTS || holdback<0)
+      return false;
+
+    for (int i=0;i<numSegments;i++) {
+      const ProgramSegment &s=segments[i];
+
+      if (s.zone<0 || s.zone>=zones || s.waitZone<-1 || s.waitZone>=zones || s.rate<0 || s.hold<0 || s.waitBand<0)
+        return false;
+
+      // the same range as the set temperatures of the user
+      if (!(s.target>=MIN_SET_TEMP && s.target<=MAX_SET_TEMP))
+        return false;
+    }
+
+    return true;
+  }
+
+
+  ProgramRunner::ProgramRunner() {
+    running=false;
+    zones=0;
+    program.numSegments=0;
+  }
+
+
+  bool ProgramRunner::Start(const Program &_program, int _zones, const double *actual, double *set, unsigned long now) {
+    if (_zones>PROGRAM_ZONES || !_program.IsValid(_zones))
+      return false;
+
+    program=_program;
+    zones=_zones;
+    lastTime=now;
+    running=true;
+
+    for (int z=0;z<zones;z++) {
+      Next(z,0);
+      if (tracks[z].phase!=SegmentPhase::Done)
+        set[z]=actual[z];
+    }
+
+    return true;
+  }
+
+
+  void ProgramRunner::Stop() {
+    running=false;
+  }
+
+
+  bool ProgramRunner::IsRunning() {
+    return running;
+  }
+
+
+  const Program &ProgramRunner::GetProgram() {
+    return program;
+  }
+
+
+  // first segment of the zone from index from, Done if there are no more
+  void ProgramRunner::Next(int zone, int from) {
+    Track &t=tracks[zone];
+
+    t.segment=-1;
+    t.phase=SegmentPhase::Done;
+    for (int i=from;i<program.numSegments;i++)
+      if (program.segments[i].zone==zone) {
+        t.segment=i;
+        t.phase=SegmentPhase::Ramp;
+        break;
+      }
+  }
+
+
+  bool ProgramRunner::Update(const double *actual, double *set, unsigned long now) {
+    if (!running)
+      return false;
+
+    double dt=(now-lastTime)/1000.0;
+    bool done=true;
+
+    lastTime=now;
+    for (int z=0;z<zones;z++) {
+      Track &t=tracks[z];
+
+      if (t.phase==SegmentPhase::Ramp) {
+        const ProgramSegment &s=program.segments[t.segment];
+        double step=s.rate*dt/60;
+
+        if (s.rate<=0 || fabs(s.target-set[z])<=step)
+          set[z]=s.target;
+        else if (program.holdback<=0 || fabs(actual[z]-set[z])<=program.holdback)
+          set[z]+=(s.target>set[z])?step:-step;
+
+        if (set[z]==s.target)
+          t.phase=SegmentPhase::Wait;
+      }
+
+      if (t.phase==SegmentPhase::Wait) {
+        const ProgramSegment &s=program.segments[t.segment];
+
+        if (s.waitZone<0 || fabs(actual[s.waitZone]-set[s.waitZone])<=s.waitBand) {
+          t.phase=SegmentPhase::Hold;
+          t.holdStart=now;
+        }
+      }
+
+      if (t.phase==SegmentPhase::Hold && now-t.holdStart>=(unsigned long) (program.segments[t.segment].hold*1000))
+        Next(z,t.segment+1);
+
+      done=done && t.phase==SegmentPhase::Done;
+    }
+
+    if (done)
+      running=false;
+
+    return done;
+  }
+
+
+  int ProgramRunner::GetSegment(int zone) {
+    return (running && zone<zones)?tracks[zone].segment:-1;
+  }
+
+
+  SegmentPhase ProgramRunner::GetPhase(int zone) {
+    return (running && zone<zones)?tracks[zone].phase:SegmentPhase::Done;
+  }
+
+
+  double ProgramRunner::GetHoldRemaining(int zone, unsigned long now) {
+    if (GetPhase(zone)!=SegmentPhase::Hold)
+      return 0;
+
+    double remaining=program.segments[tracks[zone].segment].hold-(now-tracks[zone].holdStart)/1000.0;
+
+    return (remaining>0)?remaining:0;
+  }
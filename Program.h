@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _Program_h_
+#define _Program_h_
+
+// Cook programs: ramp/soak profiles of the set temperatures of the zones, without any Arduino dependency (it is
+// also compiled by the host tools). The segments of a zone run in their order, those of different zones in
+// parallel: the set temperature ramps from where it is to the target at the given rate, then the segment waits
+// for its condition (another zone within a band of its set temperature, e.g. the stone ready before starting
+// the cooking timer of the chamber) and holds the target for the hold time. With holdback the ramp pauses
+// while the zone is farther than that from the set temperature, so the set never runs away from what the
+// heater can follow. The program ends when all the zones have completed their segments.
+
+#define MAX_PROGRAMS 4
+#define MAX_SEGMENTS 8        // segments of a program, of all its zones
+#define PROGRAM_NAME_SIZE 16
+#define PROGRAM_ZONES 4       // zones driven by a program (MAX_ZONES of the firmware)
+
+
+struct ProgramSegment {
+  int zone;          // zone whose set temperature is driven
+  double target;     // C
+  double rate;       // C/min of the ramp, 0 steps to the target at once
+  double hold;       // s at the target once reached and the condition is met
+  int waitZone;      // condition: zone within waitBand of its set temperature before holding, -1 none
+  double waitBand;   // C
+};
+
+
+struct Program {
+  char name[PROGRAM_NAME_SIZE];
+  double holdback;   // C, the ramps pause while the zone is farther from the set temperature, 0 disabled
+  bool turnOff;      // the oven is turned off at the end of the program
+  int numSegments;
+  ProgramSegment segments[MAX_SEGMENTS];
+
+  bool IsValid(int zones) const;
+};
+
+
+enum class SegmentPhase { Ramp=0, Wait=1, Hold=2, Done=3 };
+
+
+class ProgramRunner {
+public:
+  ProgramRunner();
+
+  // the set temperatures of the zones with segments start from the actual ones, false if the program is not
+  // valid for the zones
+  bool Start(const Program &_program, int _zones, const double *actual, double *set, unsigned long now);
+  void Stop();
+  bool IsRunning();
+  const Program &GetProgram();
+
+  // moves the set temperatures along the program, returns true once when the program has ended
+  bool Update(const double *actual, double *set, unsigned long now);
+
+  // current segment (index in the program, -1 none left) and phase of a zone
+  int GetSegment(int zone);
+  SegmentPhase GetPhase(int zone);
+  // s to the end of the hold of the current segment, 0 if not holding
+  double GetHoldRemaining(int zone, unsigned long now);
+
+protected:
+  struct Track {
+    int segment;
+    SegmentPhase phase;
+    unsigned long holdStart;
+  };
+
+  Program program;
+  bool running;
+  int zones;
+  Track tracks[PROGRAM_ZONES];
+  unsigned long lastTime;
+
+  void Next(int zone, int from);
+};
+
+#endif
@@ -0,0 +1,151 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+#include <ESP8266WiFi.h>
+#include "FS.h"
+#include "ProgramStore.h"
+#include "string.h"
+#include <ArduinoJson.h>
+#include "Arena.h"
+#include "HeapMonitor.h"
+
+  ProgramStore::ProgramStore() {
+    numPrograms=0;
+  }
+
+
+  // the programs in the json arena
+  void ProgramStore::ToJson() {
+    JsonObject root = jsonArena.to<JsonObject>();
+    JsonArray ps = root.createNestedArray("programs");
+
+    for (int i=0;i<numPrograms;i++) {
+      Program &p=programs[i];
+      JsonObject po = ps.createNestedObject();
+
+      po["name"] = (const char *) p.name;
+      po["holdback"] = p.holdback;
+      po["turnOff"] = p.turnOff;
+
+      JsonArray ss = po.createNestedArray("segments");
+      for (int j=0;j<p.numSegments;j++) {
+        ProgramSegment &s=p.segments[j];
+        JsonObject so = ss.createNestedObject();
+
+        so["zone"] = s.zone;
+        so["target"] = s.target;
+        so["rate"] = s.rate;
+        so["hold"] = s.hold;
+        so["waitZone"] = s.waitZone;
+        so["waitBand"] = s.waitBand;
+      }
+    }
+
+  }
+
+
+  char *ProgramStore::GetJson(char *buf, int len) {
+    HeapScope scope(HeapSubsystem::Json);
+    ToJson();
+    serializeJson(jsonArena,buf,len);
+    Serial.printf("ProgramStore: GetJson returned %s\n",buf);
+
+    return buf;
+  }
+
+
+
+  static void ParseProgram(JsonObject po, Program &p) {
+    JsonArray ss=po["segments"];
+
+    strncpy(p.name,po["name"] | "",PROGRAM_NAME_SIZE-1);
+    p.name[PROGRAM_NAME_SIZE-1]=0;
+    p.holdback=po["holdback"] | 0.0;
+    p.turnOff=po["turnOff"] | false;
+    p.numSegments=ss.size();
+
+    for (int j=0;j<p.numSegments && j<MAX_SEGMENTS;j++) {
+      JsonObject so=ss[j];
+      ProgramSegment &s=p.segments[j];
+
+      s.zone=so["zone"] | -1;
+      s.target=so["target"] | 0.0;
+      s.rate=so["rate"] | 0.0;
+      s.hold=so["hold"] | 0.0;
+      s.waitZone=so["waitZone"] | -1;
+      s.waitBand=so["waitBand"] | 0.0;
+    }
+  }
+
+
+  // all the programs are validated before replacing the current ones, then parsed again in place
+  bool ProgramStore::SetJson(char *buf, int zones) {
+    HeapScope scope(HeapSubsystem::Json);
+    DeserializationError err=deserializeJson(jsonArena,buf);
+    JsonArray ps=jsonArena["programs"];
+    bool ok=(err==DeserializationError::Ok && !ps.isNull() && ps.size()<=MAX_PROGRAMS);
+
+    for (int i=0;ok && i<(int) ps.size();i++) {
+      Program p;
+
+      ParseProgram(ps[i],p);
+      ok=p.IsValid(zones);
+    }
+
+    if (ok) {
+      numPrograms=ps.size();
+      for (int i=0;i<numPrograms;i++)
+        ParseProgram(ps[i],programs[i]);
+      Serial.printf("ProgramStore: SetJson successfully set %d programs\n",numPrograms);
+    }
+    else
+      Serial.printf("ProgramStore: SetJson error parsing %s\n",buf);
+
+    return ok;
+  }
+
+
+
+  bool ProgramStore::Save() {
+    HeapScope scope(HeapSubsystem::Files);
+    ToJson();
+
+    File f = SPIFFS.open("/programs.json", "w");
+    serializeJson(jsonArena,f);
+    f.close();
+
+    return true;
+  }
+
+
+  bool ProgramStore::Load(int zones) {
+    HeapScope scope(HeapSubsystem::Files);
+    File f = SPIFFS.open("/programs.json", "r");
+    if (!f)
+      return false;
+
+    // the parser works in place on the text, which must outlive it
+    String text=f.readString();
+    f.close();
+
+    return SetJson(&text[0],zones);
+  }
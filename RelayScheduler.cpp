@@ -0,0 +1,211 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <Arduino.h>
+#include "RelayScheduler.h"
+
+
+  RelayScheduler::RelayScheduler() {
+    for (int i=0;i<MAX_ZONES;i++)
+      channels[i].action=NULL;
+
+    numChannels=0;
+    windowsize=5000;
+    minOn=0;
+    minOff=0;
+    powerBudget=0;
+    lastUpdate=0;
+  }
+
+
+  void RelayScheduler::Begin(int _windowsize, int _minOn, int _minOff, double _powerBudget) {
+    windowsize=_windowsize;
+    minOn=_minOn;
+    minOff=_minOff;
+    powerBudget=_powerBudget;
+    numChannels=0;
+    lastUpdate=millis();
+
+    for (int i=0;i<MAX_ZONES;i++)
+      channels[i].action=NULL;
+  }
+
+
+  // channels must be attached in order after Begin, the window of each one is shifted by windowsize/MAX_ZONES
+  void RelayScheduler::Attach(int ch, IControlAction *action, double power) {
+    Channel &c=channels[ch];
+    unsigned long now=millis();
+
+    c.action=action;
+    c.power=power;
+    c.demand=0;
+    c.carry=0;
+    c.windowRequested=0;
+    c.windowDelivered=0;
+    c.windowStart=now-(unsigned long) windowsize*ch/MAX_ZONES;
+    c.lastSwitch=0;
+    c.on=action->Active();
+    memset(&c.stats,0,sizeof(c.stats));
+
+    if (ch>=numChannels)
+      numChannels=ch+1;
+  }
+
+
+  void RelayScheduler::SetDemand(int ch, double demand) {
+    channels[ch].demand=constrain(demand,0.0,1.0);
+  }
+
+
+  double RelayScheduler::GetDemand(int ch) {
+    return channels[ch].demand;
+  }
+
+
+  void RelayScheduler::Switch(Channel &c, bool on, unsigned long now) {
+    if (on)
+      c.action->On();
+    else
+      c.action->Off();
+
+    c.on=on;
+    c.lastSwitch=now;
+    c.stats.switches++;
+  }
+
+
+  void RelayScheduler::Update(bool started) {
+    unsigned long now=millis();
+    double dt=now-lastUpdate;
+    double total=0,scale=1,onPower=0;
+    bool want[MAX_ZONES];
+
+    lastUpdate=now;
+
+    for (int i=0;i<numChannels;i++)
+      if (channels[i].action!=NULL)
+        total+=channels[i].demand*channels[i].power;
+
+    // the average power is scaled down proportionally when over budget
+    if (powerBudget>0 && total>powerBudget)
+      scale=powerBudget/total;
+
+    for (int i=0;i<numChannels;i++) {
+      Channel &c=channels[i];
+
+      want[i]=false;
+      if (c.action==NULL)
+        continue;
+
+      if (started)
+        c.stats.elapsedMs+=dt;
+      c.stats.requestedMs+=c.demand*dt;
+      c.windowRequested+=c.demand*scale*dt;
+      if (c.on) {
+        c.stats.deliveredMs+=dt;
+        c.windowDelivered+=dt;
+      }
+
+      if (!started) {
+        // stopping is never delayed by the minimum on time
+        if (c.on || c.action->Active())
+          Switch(c,false,now);
+
+        c.carry=0;
+        c.windowRequested=0;
+        c.windowDelivered=0;
+        continue;
+      }
+
+      // new window: what has not been delivered in the last one is added to the carry, so a demand too small for the
+      // minimum on time builds up until it can be delivered in one interval
+      if (now-c.windowStart>=(unsigned long) windowsize) {
+        c.carry=constrain(c.carry+c.windowRequested-c.windowDelivered,(double) -windowsize,(double) windowsize);
+        c.windowRequested=0;
+        c.windowDelivered=0;
+        c.windowStart+=((now-c.windowStart)/windowsize)*windowsize;
+      }
+
+      double target=c.demand*scale*windowsize+c.carry;
+
+      // too short on intervals are postponed, too short off intervals are skipped
+      if (target<minOn)
+        target=0;
+      else if (target>windowsize-minOff)
+        target=windowsize;
+
+      bool on=(now-c.windowStart)<target;
+
+      if (on!=c.on) {
+        if (c.on && now-c.lastSwitch<(unsigned long) minOn)
+          on=true;
+        else if (!c.on && c.lastSwitch!=0 && now-c.lastSwitch<(unsigned long) minOff)
+          on=false;
+      }
+
+      want[i]=on;
+    }
+
+    if (!started)
+      return;
+
+    // the budget is a hard limit applied last, over the minimum on time: the heaters already on are counted first,
+    // then the others are switched on only if they fit
+    if (powerBudget>0) {
+      for (int pass=0;pass<2;pass++)
+        for (int i=0;i<numChannels;i++) {
+          Channel &c=channels[i];
+
+          if (!want[i] || c.on!=(pass==0))
+            continue;
+
+          if (onPower+c.power>powerBudget)
+            want[i]=false;
+          else
+            onPower+=c.power;
+        }
+    }
+
+    for (int i=0;i<numChannels;i++) {
+      Channel &c=channels[i];
+
+      if (c.action!=NULL && want[i]!=c.on)
+        Switch(c,want[i],now);
+    }
+  }
+
+
+  void RelayScheduler::ResetStats() {
+    for (int i=0;i<MAX_ZONES;i++)
+      memset(&channels[i].stats,0,sizeof(RelayChannelStats));
+  }
+
+
+  // average duties are relative to the time the oven has been started
+  void RelayScheduler::GetJson(int ch, JsonObject obj) {
+    Channel &c=channels[ch];
+    double elapsed=c.stats.elapsedMs;
+
+    obj["demand"]=c.demand;
+    obj["requestedDuty"]=(elapsed>0)?c.stats.requestedMs/elapsed:0;
+    obj["deliveredDuty"]=(elapsed>0)?c.stats.deliveredMs/elapsed:0;
+    obj["switches"]=c.stats.switches;
+  }
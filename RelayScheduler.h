@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _RelayScheduler_h_
+#define _RelayScheduler_h_
+
+#include <ArduinoJson.h>
+#include "IControl.h"
+#include "configuration.h"
+
+
+// Statistics of a relay channel, they are reset each time the oven is started
+struct RelayChannelStats {
+  double elapsedMs;     // time the oven has been started
+  double requestedMs;   // integral of the duty requested by the controller
+  double deliveredMs;   // time the relay has been actually on
+  unsigned long switches;
+};
+
+
+// Converts the duty demand (0..1) of each zone into relay on/off intervals (time proportioning).
+// Each channel has its own window staggered by windowsize/MAX_ZONES from the others to avoid switching
+// all the heaters on at the same time, intervals shorter than the minimum on/off times are carried
+// over to the next window and the sum of the power of the heaters switched on never exceeds the budget,
+// not even to honour the minimum on time.
+// Zones in OutputMode::Burst are not attached, they are driven by BurstFire.
+class RelayScheduler {
+public:
+  RelayScheduler();
+  void Begin(int _windowsize, int _minOn, int _minOff, double _powerBudget);
+  void Attach(int ch, IControlAction *action, double power);
+  void SetDemand(int ch, double demand);
+  double GetDemand(int ch);
+  void Update(bool started);
+  void ResetStats();
+  void GetJson(int ch, JsonObject obj);
+
+protected:
+  struct Channel {
+    IControlAction *action;
+    double power;   // heater power in W
+    double demand;
+    double carry;   // ms requested but not delivered (or delivered in excess) in the previous windows
+    double windowRequested,windowDelivered;
+    unsigned long windowStart,lastSwitch;
+    bool on;
+    RelayChannelStats stats;
+  };
+
+  Channel channels[MAX_ZONES];
+  int numChannels;
+  int windowsize,minOn,minOff;
+  double powerBudget;  // W, 0 means no limit
+  unsigned long lastUpdate;
+
+  void Switch(Channel &c, bool on, unsigned long now);
+};
+
+#endif
@@ -0,0 +1,239 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <math.h>
+#include "SafetySupervisor.h"
+
+static const char *faultNames[]={ "none", "overtemp", "probe fault", "stale samples", "runaway", "no rise", "frozen" };
+
+
+  SafetySupervisor::SafetySupervisor() {
+    Reset(0);
+  }
+
+
+  void SafetySupervisor::Reset(unsigned long now) {
+    for (int i=0;i<SAFETY_ZONES;i++) {
+      zs[i].faults=0;
+      zs[i].windowStart=0;
+      zs[i].onMs=0;
+      zs[i].last=0;
+      zs[i].windowMin=0;
+      zs[i].rise=0;
+      zs[i].offSince=0;
+      zs[i].offMin=NAN;
+      zs[i].word=0;
+      zs[i].wordSince=0;
+      zs[i].wordDuty=0;
+      zs[i].wordOnMs=0;
+      zs[i].duty=0;
+      zs[i].dutyLast=0;
+    }
+
+    lastSample=now;
+    lastControl=now;
+    fault=SafetyFault::None;
+    faultZone=-1;
+    tripTime=0;
+    tripped=false;
+  }
+
+
+  // the first fault is kept
+  void SafetySupervisor::Trip(SafetyFault f, int zone, unsigned long now) {
+    if (tripped)
+      return;
+
+    fault=f;
+    faultZone=zone;
+    tripTime=now;
+    tripped=true;
+  }
+
+
+  // back to back windows: with the heater on for most of a window the temperature of a zone still well below its set
+  // temperature must rise somewhere in it (measured from the lowest point before, so the dip of an opened door doesn't
+  // count)
+  void SafetySupervisor::CheckHeating(ZoneState &s, const SafetyInput &in, int zone, unsigned long now) {
+    if (s.windowStart==0) {
+      s.windowStart=now;
+      s.last=now;
+      s.onMs=0;
+      s.windowMin=in.temp;
+      s.rise=0;
+      return;
+    }
+
+    if (in.heating)
+      s.onMs+=now-s.last;
+    s.last=now;
+
+    if (in.temp<s.windowMin)
+      s.windowMin=in.temp;
+    if (in.temp-s.windowMin>s.rise)
+      s.rise=in.temp-s.windowMin;
+
+    if (now-s.windowStart>=SAFETY_ON_WINDOW) {
+      if (s.onMs>=SAFETY_ON_DUTY*(now-s.windowStart) && s.rise<SAFETY_ON_RISE && in.set-in.temp>SAFETY_ON_BAND)
+        Trip(SafetyFault::NoRise,zone,now);
+
+      s.windowStart=now;
+      s.onMs=0;
+      s.windowMin=in.temp;
+      s.rise=0;
+    }
+  }
+
+
+  // with its heater off the hottest zone can only cool, once the probe lag is over
+  void SafetySupervisor::CheckRunaway(ZoneState &s, const SafetyInput &in, int zone, bool hottest, unsigned long now) {
+    if (in.heating) {
+      s.offSince=0;
+      s.offMin=NAN;
+      return;
+    }
+
+    if (s.offSince==0)
+      s.offSince=now|1;
+
+    if (now-s.offSince<SAFETY_OFF_DELAY || !hottest) {
+      s.offMin=NAN;
+      return;
+    }
+
+    if (isnan(s.offMin) || in.temp<s.offMin)
+      s.offMin=in.temp;
+    if (in.temp>s.offMin+SAFETY_OFF_RISE)
+      Trip(SafetyFault::Runaway,zone,now);
+  }
+
+
+  // the reading of a live probe changes all the time, one that stays the same while the zone is heated harder than
+  // before is frozen
+  void SafetySupervisor::CheckFrozen(ZoneState &s, const SafetyInput &in, int zone, unsigned long now) {
+    unsigned long dt=now-s.dutyLast;
+
+    s.dutyLast=now;
+    if (s.wordSince==0)
+      s.duty=in.heating?1:0;
+    else
+      s.duty+=((in.heating?1:0)-s.duty)*fmin((double) dt/SAFETY_DUTY_TAU,1.0);
+
+    if (s.wordSince==0 || in.word!=s.word) {
+      s.word=in.word;
+      s.wordSince=now|1;
+      s.wordDuty=s.duty;
+      s.wordOnMs=0;
+      return;
+    }
+
+    if (in.heating)
+      s.wordOnMs+=dt;
+    if (now-s.wordSince>=SAFETY_FROZEN_MS && s.wordOnMs>=s.wordDuty*(now-s.wordSince)+SAFETY_FROZEN_EXTRA)
+      Trip(SafetyFault::Frozen,zone,now);
+  }
+
+
+  bool SafetySupervisor::Check(unsigned long now, const SafetyInput *in, int zones) {
+    bool anyOn=false;
+    int hotZone=-1;
+
+    lastSample=now;
+
+    for (int i=0;i<zones && i<SAFETY_ZONES;i++) {
+      ZoneState &s=zs[i];
+
+      anyOn=anyOn || in[i].heating;
+
+      if (!in[i].enabled) {
+        s.faults=0;
+        s.windowStart=0;
+        s.wordSince=0;
+        continue;
+      }
+
+      if (!in[i].probeOk) {
+        if (++s.faults>=SAFETY_FAULT_COUNT)
+          Trip(SafetyFault::ProbeFault,i,now);
+        s.windowStart=0;
+        s.wordSince=0;
+        continue;
+      }
+      s.faults=0;
+
+      if (in[i].temp>SAFETY_MAX_TEMP)
+        Trip(SafetyFault::OverTemp,i,now);
+
+      CheckHeating(s,in[i],i,now);
+      CheckFrozen(s,in[i],i,now);
+
+      if (hotZone<0 || in[i].temp>in[hotZone].temp)
+        hotZone=i;
+    }
+
+    for (int i=0;i<zones && i<SAFETY_ZONES;i++)
+      if (in[i].enabled && in[i].probeOk)
+        CheckRunaway(zs[i],in[i],i,i==hotZone,now);
+
+    // the samples are queued but loop() isn't controlling them while a heater is on
+    if (anyOn && now-lastControl>SAFETY_STALE_MS)
+      Trip(SafetyFault::Stale,-1,now);
+
+    return tripped;
+  }
+
+
+  void SafetySupervisor::Controlled(unsigned long now) {
+    lastControl=now;
+  }
+
+
+  bool SafetySupervisor::CheckSamples(unsigned long now) {
+    if (now-lastSample>SAFETY_STALE_MS)
+      Trip(SafetyFault::Stale,-1,now);
+
+    return tripped;
+  }
+
+
+  bool SafetySupervisor::IsTripped() {
+    return tripped;
+  }
+
+
+  SafetyFault SafetySupervisor::GetFault() {
+    return fault;
+  }
+
+
+  int SafetySupervisor::GetZone() {
+    return faultZone;
+  }
+
+
+  unsigned long SafetySupervisor::GetTripTime() {
+    return tripTime;
+  }
+
+
+  const char *SafetySupervisor::GetFaultName(SafetyFault fault) {
+    return faultNames[(int) fault];
+  }
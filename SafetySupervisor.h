@@ -0,0 +1,120 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _SafetySupervisor_h_
+#define _SafetySupervisor_h_
+
+#include <stdint.h>
+
+#define SAFETY_ZONES        4        // MAX_ZONES
+#define SAFETY_MAX_TEMP     400      // C, a zone above trips at once
+#define SAFETY_FAULT_COUNT  5        // consecutive samples with a probe fault that trip (0.5s)
+#define SAFETY_STALE_MS     3000     // ms without samples, or with a heater on and no control of them, that trip
+#define SAFETY_OFF_DELAY    120000UL // ms the heater of a zone must be off before a rise counts (probe lag)...
+#define SAFETY_OFF_RISE     15       // ...and C it may rise after it while the hottest zone (air recovering from
+                                     // the walls after a door opening)
+#define SAFETY_ON_WINDOW    600000UL // ms of the window of the heating check...
+#define SAFETY_ON_DUTY      0.9      // ...in which a zone with the heater on at least this share of the time...
+#define SAFETY_ON_RISE      3        // ...must have risen at least these C, when at the end of the window...
+#define SAFETY_ON_BAND      10       // ...still more than these C below its set temperature (a heavy load may hold a
+                                     // zone just below it with the heater always on)
+#define SAFETY_FROZEN_MS    60000UL  // ms the raw words of the probes of a zone may stay the same (noise and cold
+                                     // junction change them at almost every sample)...
+#define SAFETY_FROZEN_EXTRA 30000UL  // ...while the heater has been on these ms more than at the average duty before
+                                     // (a quiet probe may read the same at a steady hold, not when heated harder)
+#define SAFETY_DUTY_TAU     300000UL // ms of the time constant of the average duty of the heater of a zone
+
+// range of the set temperatures, of the user (setparams), of the programs, of the schedules and of the targets of
+// the cascade: well below SAFETY_MAX_TEMP, so that a zone held at its set temperature never trips
+#define MIN_SET_TEMP        20
+#define MAX_SET_TEMP        380
+
+enum class SafetyFault { None=0, OverTemp=1, ProbeFault=2, Stale=3, Runaway=4, NoRise=5, Frozen=6 };
+
+
+// a zone in one sample
+struct SafetyInput {
+  bool enabled;   // a disabled zone only counts for its heater, its probe may be missing
+  bool probeOk;   // no fault in the status of the MAX31855
+  double temp;    // C, meaningless with a fault
+  double set;     // C, set temperature of the control of the zone
+  bool heating;   // heater commanded on
+  uint32_t word;  // raw words of the MAX31855 of the zone (both probes combined), only compared with the previous ones
+};
+
+
+// Watches the samples of the probes and the heaters independently from the controls and trips, switching the whole
+// oven off until it is started again, on: a temperature over SAFETY_MAX_TEMP, a probe fault lasting
+// SAFETY_FAULT_COUNT samples, no samples (or a heater on and no control of the samples) for SAFETY_STALE_MS, a
+// thermal runaway of a zone with its heater off (the hottest zone only loses heat to the others, so once the probe
+// lag is over a rise means a relay stuck on), a zone well below its set temperature not rising with its heater on
+// (heater broken or probe out of its zone) and a zone whose raw words don't change for SAFETY_FROZEN_MS while its
+// heater delivers SAFETY_FROZEN_EXTRA more than at its duty before (a frozen reading the control tries to raise: the
+// trip comes once the heater has been driven harder, a reading frozen at the set temperature keeps the hold duty and
+// doesn't trip). Check runs in the sampling timer, so the trip doesn't wait for loop(). No Arduino dependency, the
+// host tools compile it too.
+class SafetySupervisor {
+public:
+  SafetySupervisor();
+  // clears the trip and restarts the checks
+  void Reset(unsigned long now);
+  // a sample of all the zones, true if tripped now or before (no logging nor allocation)
+  bool Check(unsigned long now, const SafetyInput *in, int zones);
+  // loop() has controlled the samples up to now
+  void Controlled(unsigned long now);
+  // from loop(), trips when the samples have stopped
+  bool CheckSamples(unsigned long now);
+
+  bool IsTripped();
+  SafetyFault GetFault();
+  int GetZone();  // zone of the fault, -1 for the whole oven
+  unsigned long GetTripTime();
+  static const char *GetFaultName(SafetyFault fault);
+
+protected:
+  struct ZoneState {
+    int faults;             // consecutive samples with a probe fault
+    unsigned long windowStart,onMs,last;
+    double windowMin,rise;  // lowest temperature in the window and largest rise from it
+    unsigned long offSince; // ms the heater went off, 0 on
+    double offMin;          // lowest temperature while off and the hottest zone after SAFETY_OFF_DELAY, NAN none
+    uint32_t word;          // raw words of the last change...
+    unsigned long wordSince;  // ...since ms, 0 none...
+    double wordDuty;        // ...the average duty then...
+    unsigned long wordOnMs; // ...and the ms the heater has been on since
+    double duty;            // average duty of the heater over SAFETY_DUTY_TAU
+    unsigned long dutyLast; // ms of the last sample
+  };
+
+  ZoneState zs[SAFETY_ZONES];
+  unsigned long lastSample,lastControl;
+  volatile bool tripped;
+  SafetyFault fault;
+  int faultZone;
+  unsigned long tripTime;
+
+  void Trip(SafetyFault f, int zone, unsigned long now);
+  void CheckHeating(ZoneState &s, const SafetyInput &in, int zone, unsigned long now);
+  void CheckRunaway(ZoneState &s, const SafetyInput &in, int zone, bool hottest, unsigned long now);
+  void CheckFrozen(ZoneState &s, const SafetyInput &in, int zone, unsigned long now);
+};
+
+#endif
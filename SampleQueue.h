@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _SampleQueue_h_
+#define _SampleQueue_h_
+
+#include <atomic>
+
+
+// Lock free queue of N-1 items between a single producer and a single consumer (the sampling timer and loop()).
+// head is written only by Push and tail only by Pop, an item is published by the release store of head after it
+// has been copied and its slot is given back by the release store of tail. No Arduino dependency, the host tools
+// compile it too.
+template <typename T, unsigned int N>
+class SampleQueue {
+public:
+  SampleQueue() : head(0), tail(0), overruns(0) { }
+
+  // producer only, the item is dropped (and counted) when the consumer is N-1 items behind
+  bool Push(const T &item) {
+    unsigned int h=head.load(std::memory_order_relaxed),next=(h+1)%N;
+
+    if (next==tail.load(std::memory_order_acquire)) {
+      overruns++;
+      return false;
+    }
+
+    items[h]=item;
+    head.store(next,std::memory_order_release);
+    return true;
+  }
+
+  // consumer only
+  bool Pop(T &item) {
+    unsigned int t=tail.load(std::memory_order_relaxed);
+
+    if (t==head.load(std::memory_order_acquire))
+      return false;
+
+    item=items[t];
+    tail.store((t+1)%N,std::memory_order_release);
+    return true;
+  }
+
+  unsigned long GetOverruns() {
+    return overruns;
+  }
+
+protected:
+  T items[N];
+  std::atomic<unsigned int> head,tail;
+  volatile unsigned long overruns;  // written by the producer
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include "Schedule.h"
+#include "SafetySupervisor.h"
+
+
+  bool Schedule::IsValid(int zones) const {
+    if (days<0 || days>0x7f || ready<0 || ready>=24*60 || duration<0 || zones>SCHEDULE_ZONES)
+      return false;
+
+    // 0 leaves the zone as it is, otherwise the same range as the set temperatures of the user
+    for (int i=0;i<zones;i++)
+      if (set[i]!=0 && !(set[i]>=MIN_SET_TEMP && set[i]<=MAX_SET_TEMP))
+        return false;
+
+    return true;
+  }
+
+
+  unsigned long Schedule::NextReady(unsigned long now) const {
+    if (!enabled)
+      return 0;
+
+    // the session of yesterday may still be running, that of tomorrow may already be preheating
+    unsigned long today=now-now%86400;
+    for (int d=-1;d<=1;d++) {
+      unsigned long day=today+d*86400L;
+      // 1 january 1970 was a thursday
+      int weekday=(day/86400+4)%7;
+      unsigned long readyTime=day+ready*60UL;
+
+      if ((days & (1<<weekday)) && End(readyTime)>now)
+        return readyTime;
+    }
+
+    return 0;
+  }
+
+
+  unsigned long Schedule::End(unsigned long readyTime) const {
+    return readyTime+((duration>0)?duration*60UL:SCHEDULE_LATE);
+  }
+
+
+  unsigned long PreheatLead(const double *eta, int zones) {
+    double lead=0;
+
+    for (int i=0;i<zones;i++) {
+      double t=(eta[i]<0)?SCHEDULE_DEFAULT_PREHEAT:eta[i]*SCHEDULE_MARGIN+SCHEDULE_SLACK;
+
+      if (t>lead)
+        lead=t;
+    }
+
+    return (unsigned long) lead;
+  }
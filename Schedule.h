@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _Schedule_h_
+#define _Schedule_h_
+
+// Scheduled sessions: the zones must be at their set temperatures at a time of the day on some days of the week,
+// without any Arduino dependency (it is also compiled by the host tools). Times are local seconds since 1970 as
+// returned by LocalTime() in the sketch. The oven starts itself at the latest time that still makes it ready, the preheat being
+// forecast by the learned heat-up curve of each zone (HeatupModel), stretched by a margin. A zone without a
+// learned curve takes SCHEDULE_DEFAULT_PREHEAT.
+
+#define MAX_SCHEDULES 4
+#define SCHEDULE_ZONES 4                // zones of a schedule (MAX_ZONES of the firmware)
+#define SCHEDULE_MARGIN 1.1             // the forecast preheat is stretched by 10%...
+#define SCHEDULE_SLACK 300              // ...plus 5 minutes
+#define SCHEDULE_DEFAULT_PREHEAT 3600   // s of preheat of a zone without a learned heat-up curve
+#define SCHEDULE_LATE 3600              // s after the ready time a session without duration can still start
+
+
+struct Schedule {
+  bool enabled;
+  int days;                     // days of the week, bit 0 sunday ... bit 6 saturday
+  int ready;                    // minute of the day the zones must be ready
+  int duration;                 // minutes the oven stays on after the ready time, 0 until stopped
+  double set[SCHEDULE_ZONES];   // set temperatures of the zones
+
+  bool IsValid(int zones) const;
+
+  // ready time of the session running or next to come at now, 0 if none within a day
+  unsigned long NextReady(unsigned long now) const;
+  // end of the session with the given ready time
+  unsigned long End(unsigned long readyTime) const;
+};
+
+
+// s of preheat before the ready time given the forecast time to set of each zone, -1 if not known
+unsigned long PreheatLead(const double *eta, int zones);
+
+#endif
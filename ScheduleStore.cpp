@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+#include <ESP8266WiFi.h>
+#include "FS.h"
+#include "ScheduleStore.h"
+#include "string.h"
+#include <ArduinoJson.h>
+#include "Arena.h"
+#include "HeapMonitor.h"
+
+  ScheduleStore::ScheduleStore() {
+    numSchedules=0;
+    for (int i=0;i<MAX_SCHEDULES;i++) {
+      nextStart[i]=0;
+      nextReady[i]=0;
+      lastSession[i]=0;
+    }
+  }
+
+
+  // the schedules in the json arena
+  void ScheduleStore::ToJson(bool status) {
+    JsonObject root = jsonArena.to<JsonObject>();
+    JsonArray ss = root.createNestedArray("schedules");
+
+    for (int i=0;i<numSchedules;i++) {
+      Schedule &s=schedules[i];
+      JsonObject so = ss.createNestedObject();
+
+      so["enabled"] = s.enabled;
+      so["days"] = s.days;
+      so["ready"] = s.ready;
+      so["duration"] = s.duration;
+
+      JsonArray set = so.createNestedArray("set");
+      for (int j=0;j<SCHEDULE_ZONES;j++)
+        set.add(s.set[j]);
+
+      if (status) {
+        so["nextStart"] = nextStart[i];
+        so["nextReady"] = nextReady[i];
+      }
+    }
+
+  }
+
+
+  char *ScheduleStore::GetJson(char *buf, int len, bool status) {
+    HeapScope scope(HeapSubsystem::Json);
+    ToJson(status);
+    serializeJson(jsonArena,buf,len);
+    Serial.printf("ScheduleStore: GetJson returned %s\n",buf);
+
+    return buf;
+  }
+
+
+
+  bool ScheduleStore::SetJson(char *buf, int zones) {
+    HeapScope scope(HeapSubsystem::Json);
+    Schedule parsed[MAX_SCHEDULES];
+    int count=0;
+
+    DeserializationError err=deserializeJson(jsonArena,buf);
+    JsonArray ss=jsonArena["schedules"];
+    bool ok=(err==DeserializationError::Ok && !ss.isNull() && ss.size()<=MAX_SCHEDULES);
+
+    for (int i=0;ok && i<(int) ss.size();i++) {
+      JsonObject so=ss[i];
+      JsonArray set=so["set"];
+      Schedule &s=parsed[count++];
+
+      s.enabled=so["enabled"] | true;
+      s.days=so["days"] | 0x7f;
+      s.ready=so["ready"] | -1;
+      s.duration=so["duration"] | 0;
+      for (int j=0;j<SCHEDULE_ZONES;j++)
+        s.set[j]=set[j] | 0.0;
+
+      ok=s.IsValid(zones);
+    }
+
+    if (ok) {
+      memcpy(schedules,parsed,sizeof(Schedule)*count);
+      numSchedules=count;
+      for (int i=0;i<MAX_SCHEDULES;i++) {
+        nextStart[i]=0;
+        nextReady[i]=0;
+        lastSession[i]=0;
+      }
+      Serial.printf("ScheduleStore: SetJson successfully set %d schedules\n",count);
+    }
+    else
+      Serial.printf("ScheduleStore: SetJson error parsing %s\n",buf);
+
+    return ok;
+  }
+
+
+
+  bool ScheduleStore::Save() {
+    HeapScope scope(HeapSubsystem::Files);
+    ToJson(false);
+
+    File f = SPIFFS.open("/schedules.json", "w");
+    serializeJson(jsonArena,f);
+    f.close();
+
+    return true;
+  }
+
+
+  bool ScheduleStore::Load(int zones) {
+    HeapScope scope(HeapSubsystem::Files);
+    File f = SPIFFS.open("/schedules.json", "r");
+    if (!f)
+      return false;
+
+    // the parser works in place on the text, which must outlive it
+    String text=f.readString();
+    f.close();
+
+    return SetJson(&text[0],zones);
+  }
@@ -0,0 +1,49 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _ScheduleStore_h_
+#define _ScheduleStore_h_
+
+#include "Schedule.h"
+
+
+// preheat schedules saved in flash (/schedules.json)
+class ScheduleStore {
+  public:
+    Schedule schedules[MAX_SCHEDULES];
+    int numSchedules;
+    // planned by the firmware, not saved: local time of the next start and ready time (0 none) and the ready
+    // time of the last session started, which is not started again once stopped
+    unsigned long nextStart[MAX_SCHEDULES],nextReady[MAX_SCHEDULES],lastSession[MAX_SCHEDULES];
+
+    ScheduleStore();
+    // with status also the planned start and ready times
+    char *GetJson(char *buf, int len, bool status);
+    // replaces all the schedules, nothing is changed if one of them is not valid for the zones
+    bool SetJson(char *buf, int zones);
+    bool Load(int zones);
+    bool Save();
+
+  protected:
+    void ToJson(bool status);
+};
+
+#endif
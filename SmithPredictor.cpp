@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+#include <math.h>
+#include "SmithPredictor.h"
+
+
+  SmithPredictor::SmithPredictor() {
+    model.gain=0;
+    model.tau=0;
+    model.deadTime=0;
+    enabled=false;
+    interval=100;
+    Reset();
+  }
+
+
+  void SmithPredictor::SetModel(const FopdtModel &_model) {
+    model=_model;
+    enabled=model.IsValid();
+
+    if (enabled) {
+      interval=(unsigned long) ceil(model.deadTime*1000/(SMITH_HISTORY-2));
+      if (interval<100)
+        interval=100;
+    }
+
+    Reset();
+  }
+
+
+  bool SmithPredictor::IsEnabled() {
+    return enabled;
+  }
+
+
+  void SmithPredictor::Reset() {
+    x=0;
+    head=0;
+    first=true;
+    lastTime=0;
+    lastSample=0;
+
+    for (int i=0;i<SMITH_HISTORY;i++)
+      history[i]=0;
+  }
+
+
+  void SmithPredictor::Update(double duty, unsigned long now) {
+    if (!enabled)
+      return;
+
+    if (first) {
+      first=false;
+      lastTime=now;
+      lastSample=now;
+      return;
+    }
+
+    x=model.Step(x,duty,(now-lastTime)/1000.0);
+    lastTime=now;
+
+    while (now-lastSample>=interval) {
+      lastSample+=interval;
+      head=(head+1)%SMITH_HISTORY;
+      history[head]=x;
+    }
+  }
+
+
+  double SmithPredictor::GetCorrection() {
+    if (!enabled)
+      return 0;
+
+    double d=model.deadTime*1000/interval;
+    int i=(int) d;
+    double frac=d-i;
+
+    if (i>SMITH_HISTORY-2) {
+      i=SMITH_HISTORY-2;
+      frac=1;
+    }
+
+    double delayed=history[(head-i+SMITH_HISTORY)%SMITH_HISTORY]*(1-frac)+history[(head-i-1+SMITH_HISTORY)%SMITH_HISTORY]*frac;
+
+    return x-delayed;
+  }
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _SmithPredictor_h_
+#define _SmithPredictor_h_
+
+#include "FopdtModel.h"
+
+#define SMITH_HISTORY 64  // samples of the model output kept for the dead time
+
+// Smith predictor for a pid on a process with dead time (e.g. a thermocouple inside a thick stone).
+// The pid is fed the measurement plus the difference between the model output without and with the dead time,
+// so it sees the effect of its output immediately and can run tighter gains. A model error only shows up as
+// a slower correction, since the measurement is still in the loop. The model output is kept in a ring buffer
+// sampled every deadTime/(SMITH_HISTORY-2) (at least 100ms) and the delayed value is interpolated.
+class SmithPredictor {
+public:
+  SmithPredictor();
+
+  // an invalid model disables the predictor (correction 0)
+  void SetModel(const FopdtModel &_model);
+  bool IsEnabled();
+  // the process is assumed at steady state with the heater off
+  void Reset();
+  // advances the model to now, duty has been applied since the previous call
+  void Update(double duty, unsigned long now);
+  // model output without dead time minus the delayed one, to be added to the measurement
+  double GetCorrection();
+
+protected:
+  FopdtModel model;
+  bool enabled,first;
+  double x;
+  float history[SMITH_HISTORY];
+  int head;
+  unsigned long interval,lastTime,lastSample;
+};
+
+#endif
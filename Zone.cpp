@@ -0,0 +1,170 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#include <ESP8266WiFi.h>
+#include "Zone.h"
+
+
+  void ZoneStats::Reset() {
+    minTemp=0;
+    maxTemp=0;
+    samples=0;
+    faults=0;
+    heatingMs=0;
+    lastSample=0;
+  }
+
+
+
+  Zone::Zone() : filter(0) {
+    name="";
+    enabled=false;
+    set=0;
+    target=0;
+    cascaded=false;
+    actual=0;
+    raw=0;
+    cj=0;
+    status=MAX31855::OK;
+    raw2=0;
+    ok2=false;
+    second=-1;
+    probe=NULL;
+    action=NULL;
+    stats.Reset();
+  }
+
+
+  void Zone::Begin(const char *_name, MAX31855 *_probe, IControlAction *_action) {
+    name=_name;
+    probe=_probe;
+    action=_action;
+  }
+
+
+  // the zone owns the controller, GetControl().Emplace<T>(...) replaces it
+  ZoneControl &Zone::GetControl() {
+    return control;
+  }
+
+
+  IControlAction *Zone::GetAction() {
+    return action;
+  }
+
+
+  MAX31855 *Zone::GetProbe() {
+    return probe;
+  }
+
+
+  void Zone::SetSecondProbe(int index, double tolerance) {
+    if (index!=second)
+      voter.Reset();
+
+    second=index;
+    voter.SetTolerance(tolerance);
+  }
+
+
+  int Zone::GetSecondProbe() {
+    return second;
+  }
+
+
+  // Decodes the words read from the probes by the ProbeSampler (the second one only with a second probe), in case of
+  // fault the last valid temperature is kept
+  void Zone::Sample(uint32_t rawStatus, uint32_t rawStatus2) {
+    // a word of zeros (probe not answering) or with the fault bit alone is a fault as for the second probe and the
+    // supervisor, reported with status 0
+    bool ok=!MAX31855::rawFault(rawStatus);
+
+    probe->setStatus(rawStatus);
+    status=probe->checkStatus();
+    if (!ok && status==MAX31855::OK)
+      status=0;
+
+    if (second<0) {
+      if (ok)
+        raw=probe->readTemp();
+      else
+        stats.faults++;
+    }
+    else {
+      double t1=ok?probe->readTemp():raw,t;
+
+      ok2=!MAX31855::rawFault(rawStatus2);
+      if (ok2)
+        raw2=MAX31855::rawTemp(rawStatus2);
+      if (!ok || !ok2)
+        stats.faults++;
+
+      if (voter.Vote(ok,t1,ok2,raw2,t))
+        raw=t;
+    }
+
+    cj=probe->readCJTemp();
+    actual=filter.GetFilteredValue(raw);
+
+    if (stats.samples==0 || actual<stats.minTemp)
+      stats.minTemp=actual;
+    if (stats.samples==0 || actual>stats.maxTemp)
+      stats.maxTemp=actual;
+    stats.samples++;
+  }
+
+
+  void Zone::Control(bool started, unsigned long now) {
+    if (stats.lastSample!=0 && action->Active())
+      stats.heatingMs+=now-stats.lastSample;
+    stats.lastSample=now;
+
+    if (started)
+      heatup.Update(actual,stats.heatingMs,now);
+
+    control.Control(started,now);
+  }
+
+
+  void Zone::GetJson(JsonObject obj) {
+    obj["name"]=name;
+    obj["enabled"]=enabled;
+    obj["temp"]=actual;
+    obj["set"]=set;
+    obj["target"]=target;
+    obj["cj"]=cj;
+    obj["status"]=status;
+    if (second>=0) {
+      obj["temp2"]=raw2;
+      obj["status2"]=ok2?(int) MAX31855::OK:0;
+      obj["source"]=ProbeVoter::GetSourceName(voter.GetSource());
+      obj["divergences"]=voter.GetDivergences();
+      obj["fallbacks"]=voter.GetFallbacks();
+    }
+    obj["heating"]=(enabled && action->Active())?1:0;
+    obj["min"]=stats.minTemp;
+    obj["max"]=stats.maxTemp;
+    obj["faults"]=stats.faults;
+    obj["heatingTime"]=stats.heatingMs/1000;
+    obj["eta"]=enabled?heatup.GetEta(actual,set):-1;
+    obj["rate"]=heatup.GetRate();
+    obj["fullRate"]=heatup.GetFullPowerRate(set);
+  }
@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _Zone_h_
+#define _Zone_h_
+
+#include <ArduinoJson.h>
+#include "IControl.h"
+#include "ControlVariant.h"
+#include "OnOffControl.h"
+#include "PidControl.h"
+#include "PidAutotuneControl.h"
+#include "CascadeControl.h"
+#include "MpcControl.h"
+#include "LowPassFilter.h"
+#include "HeatupModel.h"
+#include "ProbeVoter.h"
+#include "MAX31855.h"
+
+
+// the control of a zone, stored in it and dispatched without virtual calls
+typedef ControlVariant<OnOffControl,PidControl,PidAutotuneControl,CascadeControl,MpcControl> ZoneControl;
+
+
+// Statistics of a zone, they are reset each time the oven is started
+struct ZoneStats {
+  double minTemp,maxTemp;
+  unsigned long samples,faults;
+  unsigned long heatingMs;  // ms the heater has been on
+  unsigned long lastSample;
+
+  void Reset();
+};
+
+
+// A heating zone: a probe, its low pass filter, the controller and the relay driving the heater
+class Zone {
+public:
+  const char *name;
+  bool enabled;
+
+  double set;     // set temperature
+  double target;  // set temperature of the controller: set, unless driven by the cascade of another zone
+  bool cascaded;  // target is driven by a CascadeControl
+  double actual;  // filtered temperature used by the controller
+  double raw;     // last valid temperature read from the probe
+  double cj;      // cold junction temperature
+  int status;     // MAX31855::probeStatus of the last sample, 0 for an unreadable word
+  double raw2;    // last valid temperature read from the second probe
+  bool ok2;       // no fault on the second probe in the last sample
+
+  ZoneStats stats;
+  LowPassFilter filter;
+  HeatupModel heatup;  // learned while the oven is on, forecasts when the zone reaches its set temperature
+  ProbeVoter voter;    // temperature of a zone with two probes
+
+  Zone();
+  void Begin(const char *_name, MAX31855 *_probe, IControlAction *_action);
+  ZoneControl &GetControl();
+  IControlAction *GetAction();
+
+  MAX31855 *GetProbe();
+  void SetSecondProbe(int index, double tolerance);
+  int GetSecondProbe();
+
+  void Sample(uint32_t rawStatus, uint32_t rawStatus2);
+  void Control(bool started, unsigned long now);
+  void GetJson(JsonObject obj);
+
+protected:
+  MAX31855 *probe;
+  IControlAction *action;
+  ZoneControl control;
+  int second;  // board zone of the second probe, -1 none
+};
+
+#endif
@@ -24,27 +24,76 @@
 #include "FS.h"
 #include "configuration.h"
 #include "string.h"
+#include <stddef.h>
 #include <ArduinoJson.h>
+#include "Arena.h"
+#include "HeapMonitor.h"
+#include "SafetySupervisor.h"
+#include "ProbeVoter.h"
 
   char *Configuration::GetJson(char *buf, int len) {
-    StaticJsonDocument<256> jsonBuffer;
-
-    JsonObject root = jsonBuffer.to<JsonObject>();
-    root["enable1"] = enable1;
-    root["control1"] = (int) control1;
-    root["ki1"] = (double) ki1;
-    root["kd1"] = (double) kd1;
-    root["kp1"] = (double) kp1;
-    root["alpha1"] = (double) alpha1;
-
-    root["enable2"] = enable2;
-    root["control2"] = (int) control2;
-    root["ki2"] = (double) ki2;
-    root["kd2"] = (double) kd2;
-    root["kp2"] = (double) kp2;
-    root["alpha2"] = (double) alpha2;
+    HeapScope scope(HeapSubsystem::Json);
+    JsonObject root = jsonArena.to<JsonObject>();
+    root["windowSize"] = windowSize;
+    root["minOnTime"] = minOnTime;
+    root["minOffTime"] = minOffTime;
+    root["powerBudget"] = powerBudget;
+    root["burstSlot"] = burstSlot;
+    root["pidSampleTime"] = pidSampleTime;
+    root["mpcStep"] = mpcStep;
+    root["mpcHorizon"] = mpcHorizon;
+    root["mpcMoves"] = mpcMoves;
+    root["mpcMoveWeight"] = mpcMoveWeight;
+
+    JsonArray zs = root.createNestedArray("zones");
+
+    for (int i=0;i<numZones;i++) {
+      JsonObject z = zs.createNestedObject();
+      z["enable"] = zones[i].enable;
+      z["control"] = (int) zones[i].control;
+      z["ki"] = (double) zones[i].ki;
+      z["kd"] = (double) zones[i].kd;
+      z["kp"] = (double) zones[i].kp;
+      z["alpha"] = (double) zones[i].alpha;
+      z["spWeight"] = (double) zones[i].spWeight;
+      z["dFilter"] = (double) zones[i].dFilter;
+      z["ffWeight"] = (double) zones[i].ffWeight;
+
+      JsonArray gs = z.createNestedArray("gains");
+      for (int j=0;j<MAX_GAIN_POINTS;j++) {
+        GainPoint &g=zones[i].gains[j];
+
+        if (g.temp<=0)
+          continue;
+
+        JsonObject gp = gs.createNestedObject();
+        gp["temp"] = g.temp;
+        gp["kp"] = g.kp;
+        gp["ki"] = g.ki;
+        gp["kd"] = g.kd;
+        gp["duty"] = g.duty;
+      }
+      z["cascadeZone"] = zones[i].cascadeZone;
+      z["cascadeKp"] = (double) zones[i].cascadeKp;
+      z["cascadeKi"] = (double) zones[i].cascadeKi;
+      z["cascadeOffset"] = (double) zones[i].cascadeOffset;
+      z["trimGain"] = (double) zones[i].trimGain;
+      z["trimMax"] = (double) zones[i].trimMax;
+      z["smith"] = zones[i].smith;
+      z["smithGain"] = (double) zones[i].smithGain;
+      z["smithTau"] = (double) zones[i].smithTau;
+      z["smithDeadTime"] = (double) zones[i].smithDeadTime;
+      z["mpcGain"] = (double) zones[i].mpcGain;
+      z["mpcLoss"] = (double) zones[i].mpcLoss;
+      z["mpcCoupling"] = (double) zones[i].mpcCoupling;
+      z["mpcLag"] = (double) zones[i].mpcLag;
+      z["power"] = (double) zones[i].power;
+      z["output"] = (int) zones[i].output;
+      z["probe2"] = zones[i].probe2;
+      z["probeTolerance"] = (double) zones[i].probeTolerance;
+    }
         
-    serializeJsonPretty(root,buf,len);
+    serializeJson(root,buf,len);
     Serial.printf("Configuration: GetJson returned %s\n",buf);    
 
     return buf;
@@ -52,29 +101,154 @@
 
 
 
+  // reads the zone keys, each one with the given suffix (legacy configurations used enable1, kp1, ...), missing keys keep the current value
+  static void SetZoneJson(ZoneConfiguration &zone, JsonObject obj, const char *suffix) {
+    char key[16];
+
+    sprintf(key,"enable%s",suffix);
+    zone.enable=obj[key] | zone.enable;
+    sprintf(key,"control%s",suffix);
+    zone.control=(ControlType) (obj[key] | (int) zone.control);
+    sprintf(key,"kp%s",suffix);
+    zone.kp=obj[key] | zone.kp;
+    sprintf(key,"kd%s",suffix);
+    zone.kd=obj[key] | zone.kd;
+    sprintf(key,"ki%s",suffix);
+    zone.ki=obj[key] | zone.ki;
+    sprintf(key,"alpha%s",suffix);
+    zone.alpha=obj[key] | zone.alpha;
+    sprintf(key,"spWeight%s",suffix);
+    zone.spWeight=obj[key] | zone.spWeight;
+    sprintf(key,"dFilter%s",suffix);
+    zone.dFilter=obj[key] | zone.dFilter;
+    sprintf(key,"ffWeight%s",suffix);
+    zone.ffWeight=obj[key] | zone.ffWeight;
+    sprintf(key,"cascadeZone%s",suffix);
+    zone.cascadeZone=obj[key] | zone.cascadeZone;
+    sprintf(key,"cascadeKp%s",suffix);
+    zone.cascadeKp=obj[key] | zone.cascadeKp;
+    sprintf(key,"cascadeKi%s",suffix);
+    zone.cascadeKi=obj[key] | zone.cascadeKi;
+    sprintf(key,"cascadeOffset%s",suffix);
+    zone.cascadeOffset=obj[key] | zone.cascadeOffset;
+    sprintf(key,"trimGain%s",suffix);
+    zone.trimGain=obj[key] | zone.trimGain;
+    sprintf(key,"trimMax%s",suffix);
+    zone.trimMax=obj[key] | zone.trimMax;
+    sprintf(key,"smith%s",suffix);
+    zone.smith=obj[key] | zone.smith;
+    sprintf(key,"smithGain%s",suffix);
+    zone.smithGain=obj[key] | zone.smithGain;
+    sprintf(key,"smithTau%s",suffix);
+    zone.smithTau=obj[key] | zone.smithTau;
+    sprintf(key,"smithDeadTime%s",suffix);
+    zone.smithDeadTime=obj[key] | zone.smithDeadTime;
+    sprintf(key,"mpcGain%s",suffix);
+    zone.mpcGain=obj[key] | zone.mpcGain;
+    sprintf(key,"mpcLoss%s",suffix);
+    zone.mpcLoss=obj[key] | zone.mpcLoss;
+    sprintf(key,"mpcCoupling%s",suffix);
+    zone.mpcCoupling=obj[key] | zone.mpcCoupling;
+    sprintf(key,"mpcLag%s",suffix);
+    zone.mpcLag=obj[key] | zone.mpcLag;
+    sprintf(key,"power%s",suffix);
+    zone.power=obj[key] | zone.power;
+    sprintf(key,"output%s",suffix);
+    zone.output=(OutputMode) (obj[key] | (int) zone.output);
+    sprintf(key,"probe2%s",suffix);
+    zone.probe2=obj[key] | zone.probe2;
+    sprintf(key,"probeTolerance%s",suffix);
+    zone.probeTolerance=obj[key] | zone.probeTolerance;
+
+    // the gain schedule is replaced as a whole
+    JsonArray gs=obj["gains"];
+    if (!gs.isNull()) {
+      for (int j=0;j<MAX_GAIN_POINTS;j++) {
+        GainPoint &g=zone.gains[j];
+        JsonObject gp=gs[j];
+
+        if (j<(int) gs.size()) {
+          g.temp=gp["temp"] | 0.0;
+          g.kp=gp["kp"] | zone.kp;
+          g.ki=gp["ki"] | zone.ki;
+          g.kd=gp["kd"] | zone.kd;
+          g.duty=gp["duty"] | 0.0;
+        }
+        else
+          g.temp=0;
+      }
+    }
+  }
+
+
+
+  static int ClampInt(const char *name, int value, int low, int high) {
+    if (value>=low && value<=high)
+      return value;
+
+    Serial.printf("Configuration: %s %d out of range %d..%d\n",name,value,low,high);
+    return (value<low)?low:high;
+  }
+
+
+  static double ClampDouble(const char *name, double value, double low, double high) {
+    if (value>=low && value<=high)
+      return value;
+
+    Serial.printf("Configuration: %s %f out of range %f..%f\n",name,value,low,high);
+    return (value>high)?high:low;  // nan to low
+  }
+
+
+  // clamps the values which would stop or crash the controls (e.g. a division by a zero window), both those set by
+  // the cgi, before they are saved, and those loaded from the flash
+  void Configuration::Validate() {
+    windowSize=ClampInt("windowSize",windowSize,MIN_WINDOW_SIZE,MAX_WINDOW_SIZE);
+    minOnTime=ClampInt("minOnTime",minOnTime,0,windowSize-1);
+    minOffTime=ClampInt("minOffTime",minOffTime,0,windowSize-1);
+    powerBudget=ClampDouble("powerBudget",powerBudget,0,1e6);
+    burstSlot=ClampInt("burstSlot",burstSlot,MIN_BURST_SLOT,MAX_BURST_SLOT);
+    pidSampleTime=ClampInt("pidSampleTime",pidSampleTime,MIN_PID_SAMPLE,MAX_PID_SAMPLE);
+
+    for (int i=0;i<MAX_ZONES;i++)
+      zones[i].cascadeOffset=ClampDouble("cascadeOffset",zones[i].cascadeOffset,0,MAX_SET_TEMP);
+  }
+
+
 
-  // no checking on values is enforced, we are in an embedded system inside our lan so it should be safe...in the worst case it will set default values
+  // the values are clamped to their valid range, anything else is up to the user
   bool Configuration::SetJson(char *buf) {
-    StaticJsonDocument<256> root;
+    HeapScope scope(HeapSubsystem::Json);
+    JsonDocument &root=jsonArena;
 
     DeserializationError err = deserializeJson(root,buf);
     if (err!=DeserializationError::Ok) {
       Serial.printf("Configuration: SetJson error parsing %s\n",buf);
       return false;
     }
-    enable1=root["enable1"];
-    control1=(ControlType) root["control1"].as<int>();
-    kp1=root["kp1"].as<double>();
-    kd1=root["kd1"].as<double>();
-    ki1=root["ki1"].as<double>();
-    alpha1=root["alpha1"].as<double>();
-
-    enable2=root["enable2"];
-    control2=(ControlType) root["control2"].as<int>();
-    kp2=root["kp2"].as<double>();
-    kd2=root["kd2"].as<double>();
-    ki2=root["ki2"].as<double>();
-    alpha2=root["alpha2"].as<double>();
+
+    windowSize=root["windowSize"] | windowSize;
+    minOnTime=root["minOnTime"] | minOnTime;
+    minOffTime=root["minOffTime"] | minOffTime;
+    powerBudget=root["powerBudget"] | powerBudget;
+    burstSlot=root["burstSlot"] | burstSlot;
+    pidSampleTime=root["pidSampleTime"] | pidSampleTime;
+    mpcStep=root["mpcStep"] | mpcStep;
+    mpcHorizon=root["mpcHorizon"] | mpcHorizon;
+    mpcMoves=root["mpcMoves"] | mpcMoves;
+    mpcMoveWeight=root["mpcMoveWeight"] | mpcMoveWeight;
+
+    JsonArray zs=root["zones"];
+    if (!zs.isNull()) {
+      for (int i=0;i<numZones && i<(int) zs.size();i++)
+        SetZoneJson(zones[i],zs[i],"");
+    }
+    else {
+      // flat configuration of the two zones firmware
+      SetZoneJson(zones[0],root.as<JsonObject>(),"1");
+      SetZoneJson(zones[1],root.as<JsonObject>(),"2");
+    }
+    Validate();
 
     Serial.printf("Configuration: SetJson successfully set %s\n",buf);    
 
@@ -83,29 +257,249 @@
 
 
 
+  // binary record of the configuration in a slot of the flash
+  struct ConfigurationRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;      // of the whole record
+    uint32_t sequence;  // incremented at each save
+    uint32_t crc;       // of the whole record with the crc zeroed (of what follows before version 3)
+
+    ZoneConfiguration zones[MAX_ZONES];
+    int windowSize,minOnTime,minOffTime;
+    double powerBudget;
+    int burstSlot,pidSampleTime;
+    double mpcStep;
+    int mpcHorizon,mpcMoves;
+    double mpcMoveWeight;
+  };
+
+  #define CONFIG_HEADER_SIZE offsetof(ConfigurationRecord,zones)
+
+
+  // version 1, before the second probe: the zones lacked probe2 and probeTolerance, the last two fields
+  struct alignas(ZoneConfiguration) ZoneConfigurationV1 {
+    char fields[offsetof(ZoneConfiguration,probe2)];
+  };
+
+  struct ConfigurationRecordV1 {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t sequence;
+    uint32_t crc;
+
+    ZoneConfigurationV1 zones[MAX_ZONES];
+    int windowSize,minOnTime,minOffTime;
+    double powerBudget;
+    int burstSlot,pidSampleTime;
+    double mpcStep;
+    int mpcHorizon,mpcMoves;
+    double mpcMoveWeight;
+  };
+
+  static_assert(sizeof(ConfigurationRecordV1)<=sizeof(ConfigurationRecord),"version 1 record larger than the current one");
+
+
+  // the fields common to all the versions
+  template <class R> static void LoadRecord(Configuration &c, const R *r) {
+    c.windowSize=r->windowSize;
+    c.minOnTime=r->minOnTime;
+    c.minOffTime=r->minOffTime;
+    c.powerBudget=r->powerBudget;
+    c.burstSlot=r->burstSlot;
+    c.pidSampleTime=r->pidSampleTime;
+    c.mpcStep=r->mpcStep;
+    c.mpcHorizon=r->mpcHorizon;
+    c.mpcMoves=r->mpcMoves;
+    c.mpcMoveWeight=r->mpcMoveWeight;
+  }
+
+
+  static uint32_t Crc32(const uint8_t *data, size_t len) {
+    uint32_t crc=0xffffffff;
+
+    while (len--) {
+      crc^=*data++;
+      for (int k=0;k<8;k++)
+        crc=(crc>>1)^(0xedb88320 & (0-(crc&1)));
+    }
+
+    return ~crc;
+  }
+
+
+  // crc of a record of len bytes, of its fields after the header before version 3
+  static uint32_t RecordCrc(ConfigurationRecord *r, size_t len) {
+    uint32_t crc=r->crc,ris;
+
+    if (r->version<3)
+      return Crc32((uint8_t *) r+CONFIG_HEADER_SIZE,len-CONFIG_HEADER_SIZE);
+
+    r->crc=0;
+    ris=Crc32((uint8_t *) r,len);
+    r->crc=crc;
+
+    return ris;
+  }
+
+
+  // buffer of Save and LoadSlot, never called concurrently: static so that saving doesn't depend on a free block
+  // of the fragmented heap
+  static ConfigurationRecord record;
+
+
+  static void SlotPath(char *path, int n) {
+    sprintf(path,"/config.%d.bin",n);
+  }
+
+
+
+  Configuration::Configuration() {
+    sequence=0;
+    slot=CONFIG_SLOTS-1;
+    migrate=false;
+  }
+
+
+
   bool Configuration::Save() {
-    char buf[256];
+    HeapScope scope(HeapSubsystem::Files);
+    ConfigurationRecord *r=&record;
+    char path[20];
+
+    memset(r,0,sizeof(ConfigurationRecord));
+    r->magic=CONFIG_MAGIC;
+    r->version=CONFIG_VERSION;
+    r->size=sizeof(ConfigurationRecord);
+    r->sequence=sequence+1;
+    memcpy(r->zones,zones,sizeof(zones));
+    r->windowSize=windowSize;
+    r->minOnTime=minOnTime;
+    r->minOffTime=minOffTime;
+    r->powerBudget=powerBudget;
+    r->burstSlot=burstSlot;
+    r->pidSampleTime=pidSampleTime;
+    r->mpcStep=mpcStep;
+    r->mpcHorizon=mpcHorizon;
+    r->mpcMoves=mpcMoves;
+    r->mpcMoveWeight=mpcMoveWeight;
+    r->crc=RecordCrc(r,sizeof(ConfigurationRecord));
 
-    File f = SPIFFS.open("/config.json", "w");
-    f.print(GetJson(buf,256));      
+    // the other slot, the current record stays valid until the new one is complete
+    int n=(slot+1)%CONFIG_SLOTS;
+    SlotPath(path,n);
+
+    File f = SPIFFS.open(path, "w");
+    bool ris=f && f.write((uint8_t *) r,sizeof(ConfigurationRecord))==sizeof(ConfigurationRecord);
     f.close();
+
+    if (ris) {
+      sequence=r->sequence;
+      slot=n;
+      Serial.printf("Configuration: Save saved sequence %u in slot %d\n",sequence,slot);
+    }
+    else
+      Serial.printf("Configuration: Save unable to write slot %d\n",n);
+
+    return ris;
   }
 
-   
+
+  // the record of the slot n if valid and newer than the loaded one, a record of version 1 or 2 is migrated
+  bool Configuration::LoadSlot(int n) {
+    HeapScope scope(HeapSubsystem::Files);
+    ConfigurationRecord *r=&record;
+    char path[20];
+    bool found,ris=false;
+    size_t len=0;
+
+    SlotPath(path,n);
+    File f = SPIFFS.open(path, "r");
+    found=f;
+    if (found) {
+      len=f.size();
+      ris=(len==sizeof(ConfigurationRecord) || len==sizeof(ConfigurationRecordV1)) && f.read((uint8_t *) r,len)==len;
+      f.close();
+    }
+
+    ris=ris && r->magic==CONFIG_MAGIC && r->size==len &&
+      (((r->version==CONFIG_VERSION || r->version==2) && len==sizeof(ConfigurationRecord)) ||
+       (r->version==1 && len==sizeof(ConfigurationRecordV1))) &&
+      r->crc==RecordCrc(r,len);
+
+    if (ris && (sequence==0 || (int32_t) (r->sequence-sequence)>0)) {
+      // version 2 has the current layout, only its crc differs
+      if (r->version!=1) {
+        memcpy(zones,r->zones,sizeof(zones));
+        LoadRecord(*this,r);
+      }
+      else {
+        ConfigurationRecordV1 *o=(ConfigurationRecordV1 *) r;
+
+        for (int i=0;i<MAX_ZONES;i++) {
+          memcpy(&zones[i],&o->zones[i],sizeof(o->zones[i].fields));
+          zones[i].probe2=-1;
+          zones[i].probeTolerance=PROBE_TOLERANCE;
+        }
+        LoadRecord(*this,o);
+      }
+      migrate=r->version!=CONFIG_VERSION;
+      if (migrate)
+        Serial.printf("Configuration: LoadSlot migrated version %u of slot %d\n",r->version,n);
+      sequence=r->sequence;
+      slot=n;
+      Validate();
+    }
+    else if (found && !ris)
+      Serial.printf("Configuration: LoadSlot slot %d not valid\n",n);
+
+    return ris;
+  }
+
+
   bool Configuration::Load() {
-    char *buf;
-    
+    bool ris=false;
+
+    migrate=false;
+    for (int n=0;n<CONFIG_SLOTS;n++)
+      ris|=LoadSlot(n);
+
+    if (ris) {
+      Serial.printf("Configuration: Load loaded sequence %u from slot %d\n",sequence,slot);
+
+      // an older record is rewritten in the current layout
+      if (migrate)
+        Save();
+      return true;
+    }
+
+    // configuration saved by a previous firmware, from now on saved in the slots: once saved the json is renamed,
+    // otherwise it would be loaded again should the slots become unreadable, undoing all the later changes
+    ris=LoadJson();
+    if (ris && Save())
+      SPIFFS.rename("/config.json","/config.json.old");
+
+    return ris;
+  }
+
+
+  bool Configuration::LoadJson() {
+    HeapScope scope(HeapSubsystem::Files);
     File f = SPIFFS.open("/config.json", "r");
     if (!f) 
       return false;
 
-    buf=(char *) f.readString().c_str();     
-    bool ris=SetJson(buf);
+    // the parser works in place on the text, which must outlive it
+    String text=f.readString();
+    f.close();
+
+    bool ris=SetJson(&text[0]);
 
     if (ris)
-      Serial.printf("Configuration: Load successfully loaded configuration from flash (%s)\n",buf);
+      Serial.printf("Configuration: LoadJson successfully loaded configuration from flash\n");
     else 
-      Serial.printf("Configuration: Load unable to load configuration from flash (%s)\n",buf);
+      Serial.printf("Configuration: LoadJson unable to load configuration from flash\n");
 
     return ris;
   }
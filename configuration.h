@@ -24,21 +24,92 @@
 #define _Configuration_h_
 
 #include "IControl.h"
+#include "GainSchedule.h"
+
+// Capacity of the zone arrays. A board can't drive more zones than its relays: two on board plus
+// the outputs of the optional SX1509 expander, keep it low since each zone costs ram
+#define MAX_ZONES 4
+
+
+// The configuration is saved in flash as a binary record alternating between two slots, a write goes to the slot
+// not holding the current configuration, so a power cut while saving leaves the previous one intact. At boot the
+// valid slot (magic, version, size and crc) with the higher sequence is loaded. Bump the version whenever the
+// layout of the record changes and migrate the older one in LoadSlot (as done for version 1), otherwise it would be
+// ignored and the defaults loaded. Since version 3 the crc covers the whole record, header included, versions 1
+// and 2 are checked with their crc of the fields after the header. The legacy /config.json is loaded only without
+// any slot and then renamed.
+#define CONFIG_MAGIC   0x43564f45  // "EOVC"
+#define CONFIG_VERSION 3
+#define CONFIG_SLOTS   2
+
+// accepted range of the relay time proportioning window in ms
+#define MIN_WINDOW_SIZE 1000
+#define MAX_WINDOW_SIZE 60000
+// of the SSR burst firing slot in ms, timer1 counts at most 23 bits (1677ms at 5000 ticks/ms)
+#define MIN_BURST_SLOT  10
+#define MAX_BURST_SLOT  1000
+// of the minimum interval between two pid computations in ms, the probes are sampled every 100ms
+#define MIN_PID_SAMPLE  100
+#define MAX_PID_SAMPLE  60000
+
+
+// parameters of a single heating zone
+struct ZoneConfiguration {
+  bool enable;
+  ControlType control;
+  double kp,kd,ki,alpha;  // parameters for pid / on off control
+  double spWeight;        // pid setpoint weight of the proportional term (0..1)
+  double dFilter;         // pid derivative filter, the time constant is Td/dFilter
+  GainPoint gains[MAX_GAIN_POINTS];  // pid gain schedule by set temperature, unused points have temp 0
+  double ffWeight;        // fraction of the scheduled steady state duty added as feed forward (0 disabled)
+  int cascadeZone;        // cascade: zone whose target is driven by this one (the chamber heating the stone)
+  double cascadeKp,cascadeKi;  // cascade: outer pid gains, degrees of inner target for each degree of error
+  double cascadeOffset;   // cascade: maximum distance of the inner target from the set temperature
+  double trimGain,trimMax;  // cascade: duty of the own heater for each degree below set and its maximum
+  bool smith;             // smith predictor on the pid feedback, with a first order plus dead time model:
+  double smithGain;       //   C of steady state rise with the heater always on
+  double smithTau;        //   time constant in s
+  double smithDeadTime;   //   dead time in s
+  double mpcGain;         // mpc model: C/s of temperature rise with the heater always on
+  double mpcLoss;         // mpc model: 1/s, heat loss to the ambient
+  double mpcCoupling;     // mpc model: 1/s, heat exchange with the other zones
+  double mpcLag;          // mpc model: s, lag of the probe reading (thermocouple time constant plus dead time)
+  double power;           // heater power in W, used for the power budget
+  OutputMode output;      // relay time proportioning or SSR burst firing
+  int probe2;             // board zone whose probe also reads this zone (a spare MAX31855 channel), -1 none
+  double probeTolerance;  // C the two probes may differ and still be averaged
+};
+
 
 class Configuration {
   public:
-    bool enable1;
-    ControlType control1;
-    double kp1,kd1,ki1,alpha1;  // parameters for pid / on off control
+    ZoneConfiguration zones[MAX_ZONES];
+    int numZones=MAX_ZONES;  // zones present on the board, only these are exported
 
-    bool enable2;
-    ControlType control2;
-    double kp2,kd2,ki2,alpha2;  // parameters for pid / on off control
+    int windowSize;          // relay time proportioning window in ms
+    int minOnTime,minOffTime;  // minimum relay on and off intervals in ms
+    double powerBudget;      // maximum total power of the heaters switched on in W, 0 no limit
+    int burstSlot;           // SSR burst firing slot in ms (a mains half-cycle)
+    int pidSampleTime;       // minimum interval between two pid computations in ms
+    double mpcStep;          // mpc step in s
+    int mpcHorizon;          // mpc prediction horizon in steps
+    int mpcMoves;            // mpc duty changes in the horizon
+    double mpcMoveWeight;    // mpc weight of the duty changes against the squared temperature error
 
+    Configuration();
     char *GetJson(char *buf, int len);
     bool SetJson(char *buf);
     bool Load();    
     bool Save();
+
+  protected:
+    uint32_t sequence;  // of the record in flash, 0 none
+    int slot;           // slot of the record in flash
+    bool migrate;       // the record loaded has an older version
+
+    void Validate();
+    bool LoadSlot(int n);
+    bool LoadJson();
 };
 
 #endif
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Cost of PID_ATune::Runtime with the lookback window of 100 samples (SetLookbackSec(25), 250ms sample time)
+// before (PidATuneShift, shift and scan of the window on every sample) and after (ring buffer with monotonic
+// queues). Both tuners relay the chamber of the oven model around 250C in lockstep, the second one only
+// reading the same input, to check that they take the same decisions; then the recorded input is replayed to
+// each of them to time the calls. Every call takes a sample, as the clock advances by the sample time.
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -I.. -Icommon autotune_benchmark/autotune_benchmark.cpp ../PID_Autotune.cpp -o autotune_benchmark
+
+#include <stdio.h>
+#include <vector>
+#include <chrono>
+#include "OvenModel.h"
+#include "PidATuneShift.h"
+#include "PID_Autotune.h"
+
+#define SET 250.0
+#define SAMPLE_MS 250
+#define LOOKBACK_SEC 25
+#define OUTPUT_STEP 0.3
+#define MAX_HOURS 6
+#define REPEAT 200
+
+unsigned long hostMillis=0;
+
+
+struct Run {
+  std::vector<double> inputs;
+  int mismatches;      // samples where the output or the result differ
+  bool done;
+  double kp[2],ki[2],kd[2];
+};
+
+
+template<class Tuner> void Setup(Tuner &t, byte rule) {
+  t.SetControlType(rule);
+  t.SetNoiseBand(0.5);
+  t.SetOutputStep(OUTPUT_STEP);
+  t.SetLookbackSec(LOOKBACK_SEC);
+}
+
+
+Run Record(byte rule) {
+  OvenModelParams p=OvenModelParams::Default();
+  p.noise=0.1;
+  OvenModel oven(p,7);
+  double duty[OVEN_ZONES]={oven.SteadyStateDuty(SET),0};
+  Run run;
+
+  // settle at the set temperature with the steady state duty
+  for (int i=0;i<4*3600*10;i++)
+    oven.Step(0.1,duty);
+
+  double input=oven.Measure(0),outOld=duty[0],outNew=duty[0];
+  PidATuneShift before(&input,&outOld);
+  PID_ATune after(&input,&outNew);
+  Setup(before,rule);
+  Setup(after,rule);
+
+  hostMillis=0;
+  run.mismatches=0;
+  run.done=false;
+  for (long n=0;n<(long) MAX_HOURS*3600*1000/SAMPLE_MS && !run.done;n++) {
+    input=oven.Measure(0);
+    run.inputs.push_back(input);
+    bool doneOld=before.Runtime();
+    bool doneNew=after.Runtime();
+    if (doneOld!=doneNew || outOld!=outNew)
+      run.mismatches++;
+    run.done=doneOld;
+
+    duty[0]=outOld<0 ? 0 : (outOld>1 ? 1 : outOld);
+    for (int i=0;i<SAMPLE_MS/100;i++)
+      oven.Step(0.1,duty);
+    oven.Step((SAMPLE_MS%100)/1000.0,duty);
+    hostMillis+=SAMPLE_MS;
+  }
+
+  run.kp[0]=before.GetKp(); run.ki[0]=before.GetKi(); run.kd[0]=before.GetKd();
+  run.kp[1]=after.GetKp();  run.ki[1]=after.GetKi();  run.kd[1]=after.GetKd();
+  return run;
+}
+
+
+// ns per Runtime call replaying the recorded input
+template<class Tuner> double Time(const Run &run, byte rule) {
+  double input=run.inputs[0],output=0,sink=0;
+  auto start=std::chrono::steady_clock::now();
+
+  for (int r=0;r<REPEAT;r++) {
+    Tuner t(&input,&output);
+    Setup(t,rule);
+    hostMillis=0;
+    for (double v : run.inputs) {
+      input=v;
+      t.Runtime();
+      sink+=output;
+      hostMillis+=SAMPLE_MS;
+    }
+  }
+
+  double ns=std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count();
+  if (sink==1e300)
+    printf("\n");
+  return ns/((double) REPEAT*run.inputs.size());
+}
+
+
+int main() {
+  struct { byte rule; const char *name; } rules[]={
+    { PID_ATune::ZIEGLER_NICHOLS_PID, "Ziegler-Nichols PID" },
+    { PID_ATune::TYREUS_LUYBEN_PI, "Tyreus-Luyben PI" },
+    { PID_ATune::AMIGOF_PI, "AMIGOf PI" }
+  };
+
+  printf("Chamber relay autotune at %.0fC, lookback %d samples of %dms, output step %.1f\n\n",SET,LOOKBACK_SEC*4,SAMPLE_MS,OUTPUT_STEP);
+  printf("%-20s %8s %8s %8s %10s %10s %8s %10s\n","rule","samples","kp","mismatch","shift ns","ring ns","speedup","max dGain");
+  for (auto &r : rules) {
+    Run run=Record(r.rule);
+    double tOld=Time<PidATuneShift>(run,r.rule);
+    double tNew=Time<PID_ATune>(run,r.rule);
+    double dg=fmax(fabs(run.kp[0]-run.kp[1]),fmax(fabs(run.ki[0]-run.ki[1]),fabs(run.kd[0]-run.kd[1])));
+
+    printf("%-20s %8zu %8.3f %8d %10.1f %10.1f %7.1fx %10.2g\n",r.name,run.inputs.size(),run.kp[1],run.mismatches,
+           tOld,tNew,tOld/tNew,dg);
+  }
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// One relay autotune of the chamber of the oven model at 250C as done by PidAutotuneControl, then the gains
+// of every tuning rule of PID_ATune (from the ultimate gain and period) and of FopdtModel (from the model
+// identified with them) ranked by PidEvaluator on the identified model, against their actual performance on
+// the oven model in the same scenario: set step from 230C to 250C and a loss of 10% of the heater power
+// (door opened) halfway.
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -I.. -Icommon autotune_rank/autotune_rank.cpp ../PID_Autotune.cpp ../FopdtModel.cpp ../PidEvaluator.cpp ../PidEngine.cpp -o autotune_rank
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include "OvenModel.h"
+#include "PID_Autotune.h"
+#include "PidEngine.h"
+#include "PidEvaluator.h"
+
+#define WINDOW_SIZE 5000
+#define SET 250.0
+#define STEP 20.0
+#define LOAD 0.1
+#define ZONE 0  // chamber
+
+unsigned long hostMillis=0;
+
+
+struct Candidate {
+  const char *name;
+  PidGains gains;
+  PidScore predicted,actual;
+};
+
+
+// same scenario of PidEvaluator on the oven model, pid every second
+PidScore RunOven(const PidGains &g, double horizon) {
+  OvenModelParams p=OvenModelParams::Default();
+  p.noise=0.1;
+  OvenModel oven(p,3);
+  double duty[OVEN_ZONES]={oven.SteadyStateDuty(SET-STEP),0};
+  PidScore s={0,0,0};
+
+  for (int i=0;i<4*3600*10;i++)
+    oven.Step(0.1,duty);
+
+  PidEngine pid;
+  double out=duty[ZONE]*WINDOW_SIZE;
+  pid.SetTunings(g.kp,g.ki,g.kd);
+  pid.SetOutputLimits(0,WINDOW_SIZE);
+  pid.SetSampleTime(1000);
+  pid.SetAutomatic(true,SET-STEP,oven.Measure(ZONE),out);
+
+  int steps=(int) horizon;
+  for (int k=0;k<steps;k++) {
+    pid.Compute(SET,oven.Measure(ZONE),k*1000UL,out);
+    duty[ZONE]=out/WINDOW_SIZE;
+    oven.disturbance[ZONE]=(k>=steps/2)?LOAD*p.power[ZONE]:0;
+    for (int i=0;i<10;i++)
+      oven.Step(0.1,duty);
+
+    s.iae+=fabs(SET-oven.temp[ZONE]);
+    if (k<steps/2 && oven.temp[ZONE]-SET>s.overshoot)
+      s.overshoot=oven.temp[ZONE]-SET;
+  }
+  s.cost=s.iae/(STEP*horizon)+EVAL_OVERSHOOT_WEIGHT*s.overshoot/STEP;
+
+  return s;
+}
+
+
+int main() {
+  OvenModelParams p=OvenModelParams::Default();
+  p.noise=0.1;
+  OvenModel oven(p,7);
+  double duty[OVEN_ZONES]={oven.SteadyStateDuty(SET),0};
+
+  for (int i=0;i<4*3600*10;i++)
+    oven.Step(0.1,duty);
+
+  // relay around the stable output as PidAutotuneControl does
+  double input=oven.Measure(ZONE),output=duty[ZONE]*WINDOW_SIZE;
+  double stable=output/WINDOW_SIZE,temp=input;
+  PID_ATune tuner(&input,&output);
+  tuner.SetControlType(PID_ATune::ZIEGLER_NICHOLS_PID);
+  tuner.SetNoiseBand(0.5);
+  tuner.SetLookbackSec(20);
+  tuner.SetOutputStep(std::min(std::max(std::min(output,WINDOW_SIZE-output),0.05*WINDOW_SIZE),0.3*WINDOW_SIZE));
+
+  hostMillis=0;
+  while (!tuner.Runtime()) {
+    input=oven.Measure(ZONE);
+    duty[ZONE]=std::min(std::max(output,0.0),(double) WINDOW_SIZE)/WINDOW_SIZE;
+    oven.Step(0.1,duty);
+    hostMillis+=100;
+  }
+  if (tuner.GetState()!=PID_ATune::CONVERGED) {
+    printf("autotune failed\n");
+    return 1;
+  }
+
+  FopdtModel model;
+  double ku=tuner.GetKu()/WINDOW_SIZE,pu=tuner.GetPu();
+  if (!FopdtModel::FromUltimate((temp-p.ambient)/stable,ku,pu,model)) {
+    printf("inconsistent ultimate gain %f period %f\n",ku,pu);
+    return 1;
+  }
+
+  printf("Relay autotune of the chamber at %.0fC in %lus: ku %.4f duty/C, pu %.0fs\n",SET,hostMillis/1000,ku,pu);
+  printf("Identified model: gain %.0fC tau %.0fs dead time %.0fs\n",model.gain,model.tau,model.deadTime);
+
+  double horizon=20*pu;
+  PidEvaluator eval(model,SET-p.ambient,STEP,LOAD,horizon);
+  std::vector<Candidate> c;
+
+  for (byte r=0;r<=PID_ATune::NO_OVERSHOOT_PID;r++) {
+    Candidate k={ PID_ATune::GetRuleName(r) };
+    if (tuner.GetTunings(r,k.gains.kp,k.gains.ki,k.gains.kd))
+      c.push_back(k);
+  }
+  for (int r=0;r<TUNING_RULES;r++) {
+    Candidate k={ FopdtModel::GetRuleName((TuningRule) r), model.Tune((TuningRule) r,WINDOW_SIZE) };
+    c.push_back(k);
+  }
+
+  for (auto &k : c) {
+    k.predicted=eval.Evaluate(k.gains,WINDOW_SIZE);
+    k.actual=RunOven(k.gains,horizon);
+  }
+
+  std::vector<int> byPredicted(c.size()),byActual(c.size());
+  for (size_t i=0;i<c.size();i++)
+    byPredicted[i]=byActual[i]=i;
+  std::sort(byPredicted.begin(),byPredicted.end(),[&](int a,int b) { return c[a].predicted.cost<c[b].predicted.cost; });
+  std::sort(byActual.begin(),byActual.end(),[&](int a,int b) { return c[a].actual.cost<c[b].actual.cost; });
+
+  printf("\nSet step %.0f->%.0fC and %.0f%% load after %.0fs, horizon %.0fs\n\n",SET-STEP,SET,LOAD*100,horizon/2,horizon);
+  printf("%-20s %8s %8s %8s | %8s %6s %6s | %8s %6s %6s\n","rule","kp","ki","kd","pred os","cost","rank","oven os","cost","rank");
+
+  double d2=0;
+  for (size_t n=0;n<c.size();n++) {
+    int i=byPredicted[n];
+    int ra=std::find(byActual.begin(),byActual.end(),i)-byActual.begin();
+    Candidate &k=c[i];
+
+    printf("%-20s %8.1f %8.3f %8.0f | %8.1f %6.3f %6d | %8.1f %6.3f %6d\n",k.name,k.gains.kp,k.gains.ki,k.gains.kd,
+           k.predicted.overshoot,k.predicted.cost,(int) n+1,k.actual.overshoot,k.actual.cost,ra+1);
+    d2+=(double) (ra-(int) n)*(ra-(int) n);
+  }
+
+  double m=c.size();
+  printf("\nSpearman rank correlation %.2f, best predicted is %s (rank %d on the oven)\n",1-6*d2/(m*(m*m-1)),c[byPredicted[0]].name,
+         (int) (std::find(byActual.begin(),byActual.end(),byPredicted[0])-byActual.begin())+1);
+
+  return 0;
+}
@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Stone preheat on the oven model with the two zones controlled independently (each heater by the pid of its
+// own probe) and with the cascade of CascadeControl: an outer pid on the stone moves the chamber target within
+// set+-offset and the stone heater only trims with a proportional duty. Reports the stone rise, overshoot and
+// settling, the peak of the chamber above its final temperature and the average duty of the stone heater.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon cascade_benchmark/cascade_benchmark.cpp ../PidEngine.cpp ../LowPassFilter.cpp -o cascade_benchmark
+
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "LowPassFilter.h"
+
+#define WINDOW_SIZE 5000
+#define BAND 2.0        // C, tolerance for reaching and settling
+#define DURATION 7200   // s
+
+
+struct Result {
+  double rise;        // s for the stone to reach set-BAND
+  double overshoot;   // stone C above set after the rise
+  double settling;    // s after which the stone stays within BAND
+  double chamberOver; // C of the chamber maximum above its final temperature
+  double stoneDuty;   // average duty of the stone heater
+};
+
+
+PidEngine *NewPid(double kp, double ki, double kd, double outMin, double outMax) {
+  PidEngine *pid=new PidEngine();
+
+  pid->SetTunings(kp,ki,kd);
+  pid->SetOutputLimits(outMin,outMax);
+  pid->SetSampleTime(1000);
+  return pid;
+}
+
+
+// independent: chamber and stone pid, the chamber set is the stone one plus chamberOffset
+struct Independent {
+  double chamberOffset;
+  PidEngine *chamber,*stone;
+
+  Independent(double _chamberOffset) {
+    chamberOffset=_chamberOffset;
+    chamber=NewPid(120,1,200,0,WINDOW_SIZE);
+    stone=NewPid(120,1,200,0,WINDOW_SIZE);
+  }
+  void Start(const double actual[OVEN_ZONES]) {
+    chamber->SetAutomatic(true,0,actual[0],0);
+    stone->SetAutomatic(true,0,actual[1],0);
+  }
+  void Compute(double set, const double actual[OVEN_ZONES], unsigned long now, double output[OVEN_ZONES]) {
+    chamber->Compute(set+chamberOffset,actual[0],now,output[0]);
+    stone->Compute(set,actual[1],now,output[1]);
+  }
+};
+
+
+// same logic of CascadeControl::Control driving the PidControl of the chamber
+struct Cascade {
+  double offset,trimGain,trimMax,target;
+  PidEngine *outer,*chamber;
+
+  Cascade(double kp, double ki, double _offset, double _trimGain, double _trimMax) {
+    offset=_offset;
+    trimGain=_trimGain;
+    trimMax=_trimMax;
+    outer=NewPid(kp,ki,0,-offset,offset);
+    chamber=NewPid(120,1,200,0,WINDOW_SIZE);
+  }
+  void Start(const double actual[OVEN_ZONES]) {
+    outer->SetAutomatic(true,0,actual[1],0);
+    chamber->SetAutomatic(true,0,actual[0],0);
+    target=0;
+  }
+  void Compute(double set, const double actual[OVEN_ZONES], unsigned long now, double output[OVEN_ZONES]) {
+    double out=0;
+
+    if (outer->Compute(set,actual[1],now,out))
+      target=set+out;
+    chamber->Compute(target,actual[0],now,output[0]);
+    output[1]=fmin(fmax(trimGain*(set-actual[1]),0),trimMax)*WINDOW_SIZE;
+  }
+};
+
+
+template<class Controller> Result Run(Controller &c, double set) {
+  OvenModel oven(OvenModelParams::Default());
+  LowPassFilter filter[OVEN_ZONES]={LowPassFilter(0.3),LowPassFilter(0.3)};
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> loopPeriod(100,250);
+  Result r={-1,0,0,0,0};
+  double output[OVEN_ZONES]={0,0},actual[OVEN_ZONES];
+  unsigned long now=1000;
+
+  for (int z=0;z<OVEN_ZONES;z++)
+    actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+  c.Start(actual);
+
+  while (now/1000.0<DURATION) {
+    unsigned long dt=loopPeriod(rng);
+    double heater[OVEN_ZONES];
+
+    // relay state during the next loop period
+    for (int z=0;z<OVEN_ZONES;z++)
+      heater[z]=((now%WINDOW_SIZE)<output[z])?1:0;
+    for (unsigned long t=0;t<dt;t+=100)
+      oven.Step(0.1,heater);
+    now+=dt;
+
+    for (int z=0;z<OVEN_ZONES;z++)
+      actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+    c.Compute(set,actual,now,output);
+
+    double elapsed=now/1000.0;
+    double stone=oven.temp[1];
+
+    if (r.rise<0 && stone>=set-BAND)
+      r.rise=elapsed;
+    if (r.rise>=0 && stone-set>r.overshoot)
+      r.overshoot=stone-set;
+    if (fabs(stone-set)>BAND)
+      r.settling=elapsed;
+    r.chamberOver=fmax(r.chamberOver,oven.temp[0]);
+    r.stoneDuty+=heater[1]*dt/1000.0/DURATION;
+  }
+
+  r.chamberOver-=oven.temp[0];
+  return r;
+}
+
+
+template<class C> void Benchmark(const char *name, C c) {
+  double sets[]={200,250,300};
+
+  printf("%-30s",name);
+  for (double set : sets) {
+    Result r=Run(c,set);
+    printf(" | %6.0f %6.1f %6.0f %6.0f %5.2f",r.rise,r.overshoot,r.settling,r.chamberOver,r.stoneDuty);
+  }
+  printf("\n");
+}
+
+
+int main() {
+  printf("%-30s | %-34s | %-34s | %-34s\n","","stone to 200C","stone to 250C","stone to 300C");
+  printf("%-30s | %6s %6s %6s %6s %5s | %6s %6s %6s %6s %5s | %6s %6s %6s %6s %5s\n","controller",
+    "rise s","over C","settl","ch ovr","duty","rise s","over C","settl","ch ovr","duty","rise s","over C","settl","ch ovr","duty");
+
+  Benchmark("independent, chamber set",Independent(0));
+  Benchmark("independent, chamber set+30",Independent(30));
+  Benchmark("cascade offset 30",Cascade(2,0.005,30,0.05,1));
+  Benchmark("cascade offset 50",Cascade(2,0.005,50,0.05,1));
+  Benchmark("cascade offset 50 trim max 0.5",Cascade(2,0.005,50,0.05,0.5));
+  return 0;
+}
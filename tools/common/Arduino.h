@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _HostArduino_h_
+#define _HostArduino_h_
+
+// Minimal stand-in of the Arduino core for compiling firmware sources that need it (only what they use) in
+// the host tools: build with -DARDUINO=100 and -Icommon. millis() returns hostMillis, which the tool advances
+// with its simulated time, and Serial discards everything.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cmath>
+
+using std::abs;
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define F(s) (s)
+#define pgm_read_byte_near(p) (*(const uint8_t *)(p))
+
+extern unsigned long hostMillis;
+
+inline unsigned long millis() {
+  return hostMillis;
+}
+
+
+struct HostSerial {
+  template<typename T> void print(T) {}
+  template<typename T> void println(T) {}
+  void println() {}
+  template<typename... T> void printf(const char *, T...) {}
+};
+
+static HostSerial Serial __attribute__((unused));
+
+#endif
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _OvenModel_h_
+#define _OvenModel_h_
+
+// Host side thermal model of a two zones oven (chamber and stone) used by the simulation tools.
+// Each zone is a heat capacity heated by its element, losing heat to the ambient (linear convection plus a
+// radiation like term that makes the loss grow strongly with temperature) and exchanging heat with the other
+// zone. The probe reading is delayed (dead time) and lagged (thermocouple in a thick stone), then quantized
+// to the 0.25C of the MAX31855 with optional gaussian noise.
+
+#include <math.h>
+#include <stdint.h>
+#include <random>
+
+#define OVEN_ZONES 2
+
+
+struct OvenModelParams {
+  double ambient;                 // C
+  double power[OVEN_ZONES];       // heater power in W
+  double capacity[OVEN_ZONES];    // heat capacity in J/K
+  double loss[OVEN_ZONES];        // linear loss to ambient in W/K
+  double radiation[OVEN_ZONES];   // loss coefficient of (T^4-Ta^4) in W/K^4
+  double coupling;                // heat exchange between the zones in W/K
+  double probeTau[OVEN_ZONES];    // thermocouple time constant in s
+  double deadTime[OVEN_ZONES];    // transport delay of the reading in s
+  double noise;                   // standard deviation of the probe noise in C
+  double cjNoise;                 // standard deviation of the noise of the cold junction in C
+
+  // a typical pizza oven, the stone is heated mostly by the chamber
+  static OvenModelParams Default() {
+    OvenModelParams p;
+
+    p.ambient=20;
+    p.power[0]=2000;    p.power[1]=1500;
+    p.capacity[0]=3000; p.capacity[1]=12000;
+    p.loss[0]=2.5;      p.loss[1]=1.0;
+    p.radiation[0]=5e-9; p.radiation[1]=1e-9;
+    p.coupling=6;
+    p.probeTau[0]=30;   p.probeTau[1]=60;
+    p.deadTime[0]=10;   p.deadTime[1]=40;
+    p.noise=0;
+    p.cjNoise=0.1;
+
+    return p;
+  }
+};
+
+
+class OvenModel {
+public:
+  OvenModelParams p;
+  double temp[OVEN_ZONES];    // true temperature of the zone
+  double probe[OVEN_ZONES];   // lagged probe temperature (before the dead time)
+  double disturbance[OVEN_ZONES];  // extra loss in W (e.g. door open)
+
+  OvenModel(const OvenModelParams &_p, unsigned seed=1) : p(_p), rng(seed), gauss(0,1) {
+    Reset();
+  }
+
+  void Reset() {
+    t=0;
+    head=0;
+    for (int z=0;z<OVEN_ZONES;z++) {
+      temp[z]=p.ambient;
+      probe[z]=p.ambient;
+      disturbance[z]=0;
+      for (int i=0;i<HISTORY;i++)
+        history[z][i]=p.ambient;
+    }
+  }
+
+  // integrates the model for dt seconds with the heaters driven by duty (0..1, a relay is 0 or 1)
+  void Step(double dt, const double duty[OVEN_ZONES]) {
+    double flow[OVEN_ZONES];
+
+    for (int z=0;z<OVEN_ZONES;z++)
+      flow[z]=p.power[z]*duty[z]-Loss(z,temp[z])-disturbance[z];
+    flow[0]-=p.coupling*(temp[0]-temp[1]);
+    flow[1]+=p.coupling*(temp[0]-temp[1]);
+
+    for (int z=0;z<OVEN_ZONES;z++) {
+      temp[z]+=flow[z]/p.capacity[z]*dt;
+      probe[z]+=(temp[z]-probe[z])*dt/(p.probeTau[z]+dt);
+    }
+
+    // the history keeps one probe value each HISTORY_STEP seconds for the dead time
+    t+=dt;
+    while (t>=HISTORY_STEP) {
+      t-=HISTORY_STEP;
+      head=(head+1)%HISTORY;
+      for (int z=0;z<OVEN_ZONES;z++)
+        history[z][head]=probe[z];
+    }
+  }
+
+  // duty of the chamber heater (zone 0) holding it at temp with the stone heater off, the stone
+  // temperature is found by bisection on its heat balance
+  double SteadyStateDuty(double temp) {
+    double lo=p.ambient,hi=temp;
+
+    for (int i=0;i<50;i++) {
+      double ts=(lo+hi)/2;
+
+      if (p.coupling*(temp-ts)>Loss(1,ts))
+        lo=ts;
+      else
+        hi=ts;
+    }
+
+    return (Loss(0,temp)+p.coupling*(temp-lo))/p.power[0];
+  }
+
+  // heat lost to the ambient by zone z at temperature temp in W
+  double Loss(int z, double temp) {
+    double tk=temp+273.15,ta=p.ambient+273.15;
+
+    return p.loss[z]*(temp-p.ambient)+p.radiation[z]*(tk*tk*tk*tk-ta*ta*ta*ta);
+  }
+
+  // what the MAX31855 would read now
+  double Measure(int z) {
+    int delay=(int) (p.deadTime[z]/HISTORY_STEP);
+    if (delay>=HISTORY)
+      delay=HISTORY-1;
+
+    double v=history[z][(head+HISTORY-delay)%HISTORY];
+    if (p.noise>0)
+      v+=gauss(rng)*p.noise;
+
+    return floor(v*4+0.5)/4;
+  }
+
+  // raw word of the MAX31855 with a reading: the thermocouple in 0.25C and the cold junction (the board, a bit above
+  // the ambient, with the noise of its sensor) in 0.0625C
+  uint32_t Word(double reading) {
+    uint32_t tc=(uint32_t) (int) floor(reading*4+0.5) & 0x3fff;
+    uint32_t cj=(uint32_t) (int) floor((p.ambient+10+gauss(rng)*p.cjNoise)*16+0.5) & 0xfff;
+
+    return (tc<<18)|(cj<<4);
+  }
+
+protected:
+  static const int HISTORY=2048;
+  static constexpr double HISTORY_STEP=0.1;
+
+  double history[OVEN_ZONES][HISTORY];
+  int head;
+  double t;
+  std::mt19937 rng;
+  std::normal_distribution<double> gauss;
+};
+
+#endif
@@ -0,0 +1,445 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _PidATuneShift_h_
+#define _PidATuneShift_h_
+
+// Reference copy of PID_ATune::Runtime as it was before the lookback window became a ring buffer: the
+// process values are shifted through lastInputs on every sample while scanning them for the peaks, and
+// scanned again for the steady state of the AMIGOf rule. The relay bias and debug options are left out (they
+// are disabled in the library). Setters and tuning rules are those of PID_ATune.
+
+#include "PID_Autotune.h"
+
+extern Tuning tuningRule[];
+
+
+class PidATuneShift {
+public:
+  enum { AMIGOF_PI = PID_ATune::AMIGOF_PI };
+  enum Peak { MINIMUM = -1, NOT_A_PEAK = 0, MAXIMUM = 1 };
+  enum AutoTunerState {
+    AUTOTUNER_OFF = 0, STEADY_STATE_AT_BASELINE = 1, STEADY_STATE_AFTER_STEP_UP = 2,
+    RELAY_STEP_UP = 4, RELAY_STEP_DOWN = 8, CONVERGED = 16, FAILED = 128
+  };
+  enum { KP_DIVISOR = 0, TI_DIVISOR = 1, TD_DIVISOR = 2 };
+  static constexpr const double CONST_PI          = 3.14159265358979323846;
+  static constexpr const double CONST_SQRT2_DIV_2 = 0.70710678118654752440;
+
+  PidATuneShift(double *Input, double *Output) {
+    input = Input;
+    output = Output;
+    controlType = PID_ATune::ZIEGLER_NICHOLS_PI;
+    noiseBand = 0.5;
+    state = AUTOTUNER_OFF;
+    oStep = 10.0;
+    SetLookbackSec(10);
+  }
+
+  void SetOutputStep(double Step) { oStep = Step; }
+  void SetControlType(byte type) { controlType = type; }
+  void SetNoiseBand(double band) { noiseBand = band; }
+  void SetLookbackSec(int value) {
+    if (value < 1)
+      value = 1;
+    if (value < 25) {
+      nLookBack = value * 4;
+      sampleTime = 250;
+    }
+    else {
+      nLookBack = 100;
+      sampleTime = value * 10;
+    }
+  }
+
+  double GetKp() { return Kp; }
+  double GetKi() { return Kp / Ti; }
+  double GetKd() { return Kp * Td; }
+
+  bool Runtime() {
+    // check ready for new input
+    unsigned long now = millis();
+
+    if (state == AUTOTUNER_OFF)
+    {
+      // initialize working variables the first time around
+      peakType = NOT_A_PEAK;
+      inputCount = 0;
+      peakCount = 0;
+      setpoint = *input;
+      outputStart = *output;
+      lastPeakTime[0] = now;
+      workingNoiseBand = noiseBand;
+      newWorkingNoiseBand = noiseBand;
+      workingOstep = oStep;
+
+      // move to new state
+      if (controlType == AMIGOF_PI)
+      {
+        state = STEADY_STATE_AT_BASELINE;
+      }
+      else
+      {
+        state = RELAY_STEP_UP;
+      }
+    }
+
+    // otherwise check ready for new input
+    else if ((now - lastTime) < sampleTime)
+    {
+      return false;
+    }
+
+    // get new input
+    lastTime = now;
+    double refVal = *input;
+
+    // local flag variable
+    bool justChanged = false;
+
+    // check input and change relay state if necessary
+    if ((state == RELAY_STEP_UP) && (refVal > setpoint + workingNoiseBand))
+    {
+      state = RELAY_STEP_DOWN;
+      justChanged = true;
+    }
+    else if ((state == RELAY_STEP_DOWN) && (refVal < setpoint - workingNoiseBand))
+    {
+      state = RELAY_STEP_UP;
+      justChanged = true;
+    }
+    if (justChanged)
+    {
+      workingNoiseBand = newWorkingNoiseBand;
+
+    } // if justChanged
+
+    // set output
+    // FIXME need to respect output limits
+    // not knowing output limits is one reason
+    // to pass entire PID object to autotune method(s)
+    if (((byte) state & (STEADY_STATE_AFTER_STEP_UP | RELAY_STEP_UP)) > 0)
+    {
+
+      *output = outputStart + workingOstep;
+
+    }
+    else if (state == RELAY_STEP_DOWN)
+    {
+
+      *output = outputStart - workingOstep;
+
+    }
+
+    // store initial inputs
+    // we don't want to trust the maxes or mins
+    // until the input array is full
+    inputCount++;
+    if (inputCount <= nLookBack)
+    {
+      lastInputs[nLookBack - inputCount] = refVal;
+      return false;
+    }
+
+    // shift array of process values and identify peaks
+    inputCount = nLookBack;
+    bool isMax = true;
+    bool isMin = true;
+    for (int i = inputCount - 1; i >= 0; i--)
+    {
+      double val = lastInputs[i];
+      if (isMax)
+      {
+        isMax = (refVal >= val);
+      }
+      if (isMin)
+      {
+        isMin = (refVal <= val);
+      }
+      lastInputs[i + 1] = val;
+    }
+    lastInputs[0] = refVal;
+
+    // for AMIGOf tuning rule, perform an initial
+    // step change to calculate process gain K_process
+    // this may be very slow for lag-dominated processes
+    // and may never terminate for integrating processes
+    if (((byte) state & (STEADY_STATE_AT_BASELINE | STEADY_STATE_AFTER_STEP_UP)) > 0)
+    {
+      // check that all the recent inputs are
+      // equal give or take expected noise
+      double iMax = lastInputs[0];
+      double iMin = lastInputs[0];
+      double avgInput = 0.0;
+      for (byte i = 0; i <= inputCount; i++)
+      {
+        double val = lastInputs[i];
+        if (iMax < val)
+        {
+          iMax = val;
+        }
+          if (iMin > val)
+        {
+          iMin = val;
+        }
+        avgInput += val;
+      }
+      avgInput /= (double)(inputCount + 1);
+
+      // if recent inputs are stable
+      if ((iMax - iMin) <= 2.0 * workingNoiseBand)
+      {
+
+        if (state == STEADY_STATE_AT_BASELINE)
+        {
+          state = STEADY_STATE_AFTER_STEP_UP;
+          lastPeaks[0] = avgInput;
+          inputCount = 0;
+          return false;
+        }
+        // else state == STEADY_STATE_AFTER_STEP_UP
+        // calculate process gain
+        K_process = (avgInput - lastPeaks[0]) / workingOstep;
+
+        // bad estimate of process gain
+        if (K_process < 1e-10) // zero
+        {
+          state = AUTOTUNER_OFF;
+          return false;
+        }
+        state = RELAY_STEP_DOWN;
+
+        return false;
+      }
+      else
+      {
+        return false;
+      }
+    }
+
+    // increment peak count
+    // and record peak time
+    // for both maxima and minima
+    justChanged = false;
+    if (isMax)
+    {
+      if (peakType == MINIMUM)
+      {
+        justChanged = true;
+      }
+      peakType = MAXIMUM;
+    }
+    else if (isMin)
+    {
+      if (peakType == MAXIMUM)
+      {
+        justChanged = true;
+      }
+      peakType = MINIMUM;
+    }
+
+    // update peak times and values
+    if (justChanged)
+    {
+      peakCount++;
+
+      // shift peak time and peak value arrays
+      for (byte i = (peakCount > 4 ? 4 : peakCount); i > 0; i--)
+      {
+        lastPeakTime[i] = lastPeakTime[i - 1];
+        lastPeaks[i] = lastPeaks[i - 1];
+      }
+    }
+    if (isMax || isMin)
+    {
+      lastPeakTime[0] = now;
+      lastPeaks[0] = refVal;
+
+    }
+
+    // check for convergence of induced oscillation
+    // convergence of amplitude assessed on last 4 peaks (1.5 cycles)
+    double inducedAmplitude = 0.0;
+    double phaseLag;
+    if (
+
+      justChanged &&
+      (peakCount > 4)
+    )
+    {
+      double absMax = lastPeaks[1];
+      double absMin = lastPeaks[1];
+      for (byte i = 2; i <= 4; i++)
+      {
+        double val = lastPeaks[i];
+        inducedAmplitude += abs( val - lastPeaks[i - 1]);
+        if (absMax < val)
+        {
+           absMax = val;
+        }
+        if (absMin > val)
+        {
+           absMin = val;
+        }
+      }
+      inducedAmplitude /= 6.0;
+
+      // source for AMIGOf PI auto tuning method:
+      // "Revisiting the Ziegler-Nichols tuning rules for PI control —
+      //  Part II. The frequency response method."
+      // T. Hägglund and K. J. Åström
+      // Asian Journal of Control, Vol. 6, No. 4, pp. 469-482, December 2004
+      // http://www.ajc.org.tw/pages/paper/6.4PD/AC0604-P469-FR0371.pdf
+      if (controlType == AMIGOF_PI)
+      {
+        phaseLag = calculatePhaseLag(inducedAmplitude);
+
+        // check that phase lag is within acceptable bounds, ideally between 120° and 140°
+        // but 115° to 145° will just about do, and might converge quicker
+        if (abs(phaseLag - CONST_PI * 130.0 / 180.0) > (CONST_PI * 15.0 / 180.0))
+        {
+          // phase lag outside the desired range
+          // set noiseBand to new estimate
+          // aiming for 135° = 0.75 * pi (radians)
+          // sin(135°) = sqrt(2)/2
+          // NB noiseBand = 0.5 * hysteresis
+          newWorkingNoiseBand = 0.5 * inducedAmplitude * CONST_SQRT2_DIV_2;
+
+          return false;
+        }
+      }
+
+      // check convergence criterion for amplitude of induced oscillation
+      if (((0.5 * (absMax - absMin) - inducedAmplitude) / inducedAmplitude) < AUTOTUNE_PEAK_AMPLITUDE_TOLERANCE)
+      {
+        state = CONVERGED;
+      }
+    }
+
+    // if the autotune has not already converged
+    // terminate after 10 cycles
+    // or if too long between peaks
+    // or if too long between relay steps
+    if (
+
+      ((now - lastPeakTime[0]) > (unsigned long) (AUTOTUNE_MAX_WAIT_MINUTES * 60000)) ||
+      (peakCount >= 20)
+    )
+    {
+      state = FAILED;
+    }
+
+    if (((byte) state & (CONVERGED | FAILED)) == 0)
+    {
+      return false;
+    }
+
+    // autotune algorithm has terminated
+    // reset autotuner variables
+    *output = outputStart;
+
+    if (state == FAILED)
+    {
+      // do not calculate gain parameters
+
+      return true;
+    }
+
+    // finish up by calculating tuning parameters
+
+    // calculate ultimate gain
+    double Ku = 4.0 * workingOstep / (inducedAmplitude * CONST_PI);
+
+    // calculate ultimate period in seconds
+    double Pu = (double) 0.5 * ((lastPeakTime[1] - lastPeakTime[3]) + (lastPeakTime[2] - lastPeakTime[4])) / 1000.0;
+
+    // calculate gain parameters using tuning rules
+    // NB PID generally outperforms PI for lag-dominated processes
+
+    // AMIGOf is slow to tune, especially for lag-dominated processes, because it
+    // requires an estimate of the process gain which is implemented in this
+    // routine by steady state change in process variable after step change in set point
+    // It is intended to give robust tunings for both lag- and delay- dominated processes
+    if (controlType == AMIGOF_PI)
+    {
+      // calculate gain ratio
+      double kappa_phi = (1.0 / Ku) / K_process;
+
+      // calculate phase lag
+      phaseLag = calculatePhaseLag(inducedAmplitude);
+
+      // calculate tunings
+      Kp = (( 2.50 - 0.92 * phaseLag) / (1.0 + (10.75 - 4.01 * phaseLag) * kappa_phi)) * Ku;
+      Ti = ((-3.05 + 1.72 * phaseLag) / pow(1.0 + (-6.10 + 3.44 * phaseLag) * kappa_phi, 2)) * Pu;
+      Td = 0.0;
+
+      // converged
+      return true;
+    }
+
+    Kp = Ku / (double) tuningRule[controlType].divisor(KP_DIVISOR);
+    Ti = Pu / (double) tuningRule[controlType].divisor(TI_DIVISOR);
+    Td = tuningRule[controlType].PI_controller() ?
+         0.0 : Pu / (double) tuningRule[controlType].divisor(TD_DIVISOR);
+
+    // converged
+    return true;
+  }
+
+
+private:
+  double fastArcTan(double x) {
+    return x / (1.0 + 0.28125 * pow(x, 2));
+  }
+
+  double calculatePhaseLag(double inducedAmplitude) {
+    double ratio = 2.0 * workingNoiseBand / inducedAmplitude;
+    if (ratio > 1.0)
+      return CONST_PI / 2.0;
+    else
+      return CONST_PI - fastArcTan(ratio / sqrt( 1.0 - pow(ratio, 2)));
+  }
+
+  double *input;
+  double *output;
+  double setpoint;
+  double oStep;
+  double noiseBand;
+  byte nLookBack;
+  byte controlType;
+  enum AutoTunerState state;
+  unsigned long lastTime;
+  unsigned long sampleTime;
+  enum Peak peakType;
+  unsigned long lastPeakTime[5];
+  double lastPeaks[5];
+  byte peakCount;
+  double lastInputs[101];
+  byte inputCount;
+  double outputStart;
+  double workingNoiseBand;
+  double workingOstep;
+  double Kp, Ti, Td;
+  double newWorkingNoiseBand;
+  double K_process;
+};
+
+#endif
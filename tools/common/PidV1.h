@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _PidV1_h_
+#define _PidV1_h_
+
+// Reference implementation of the algorithm of the Arduino PID_v1 library (Brett Beauregard, v1.2.1) used by
+// PidControl before PidEngine, with the time passed explicitly instead of millis(): fixed 100ms sample time
+// assumed in the gains, proportional on error, derivative on measurement without filter and integral
+// clamped to the output limits.
+class PidV1 {
+public:
+  PidV1(double kp, double ki, double kd, double _outMin, double _outMax) {
+    sampleTime=100;
+    SetTunings(kp,ki,kd);
+    outMin=_outMin;
+    outMax=_outMax;
+    automatic=false;
+    outputSum=0;
+    lastInput=0;
+    lastTime=0;
+  }
+
+  void SetTunings(double Kp, double Ki, double Kd) {
+    double sampleTimeInSec=sampleTime/1000.0;
+
+    kp=Kp;
+    ki=Ki*sampleTimeInSec;
+    kd=Kd/sampleTimeInSec;
+  }
+
+  void SetAutomatic(double input, double output, unsigned long now) {
+    outputSum=Clamp(output);
+    lastInput=input;
+    lastTime=now-sampleTime;
+    automatic=true;
+  }
+
+  bool Compute(double set, double input, unsigned long now, double &output) {
+    if (!automatic || now-lastTime<sampleTime)
+      return false;
+
+    double error=set-input;
+    double dInput=input-lastInput;
+
+    outputSum=Clamp(outputSum+ki*error);
+    output=Clamp(kp*error+outputSum-kd*dInput);
+
+    lastInput=input;
+    lastTime=now;
+
+    return true;
+  }
+
+protected:
+  double kp,ki,kd,outMin,outMax,outputSum,lastInput;
+  unsigned long sampleTime,lastTime;
+  bool automatic;
+
+  double Clamp(double v) {
+    return v<outMin?outMin:(v>outMax?outMax:v);
+  }
+};
+
+#endif
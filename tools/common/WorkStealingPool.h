@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+#ifndef _WorkStealingPool_h_
+#define _WorkStealingPool_h_
+
+// Runs count independent tasks, numbered 0..count-1, on a set of threads. Each thread starts with a
+// contiguous share of the tasks in its own deque and takes them from the back; when it runs out it steals
+// from the front of the others (the tasks farthest from their owner), so threads finishing early help the
+// slow ones. Run returns when all the tasks are done. The task function must be safe to call concurrently
+// (e.g. writing only the result slot of its index).
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(int _threads) : threads(_threads>0 ? _threads : 1), queues(threads) {
+  }
+
+  void Run(size_t count, const std::function<void(size_t)> &task) {
+    for (int t=0;t<threads;t++) {
+      size_t first=count*t/threads,last=count*(t+1)/threads;
+
+      for (size_t i=first;i<last;i++)
+        queues[t].tasks.push_back(i);
+    }
+
+    std::vector<std::thread> workers;
+    for (int t=1;t<threads;t++)
+      workers.emplace_back(&WorkStealingPool::Work,this,t,std::cref(task));
+    Work(0,task);
+
+    for (std::thread &w : workers)
+      w.join();
+  }
+
+  int GetThreads() const {
+    return threads;
+  }
+
+protected:
+  struct Queue {
+    std::mutex lock;
+    std::deque<size_t> tasks;
+  };
+
+  int threads;
+  std::vector<Queue> queues;
+
+  bool PopOwn(int t, size_t &i) {
+    std::lock_guard<std::mutex> guard(queues[t].lock);
+    if (queues[t].tasks.empty())
+      return false;
+    i=queues[t].tasks.back();
+    queues[t].tasks.pop_back();
+    return true;
+  }
+
+  bool Steal(int t, size_t &i) {
+    for (int k=1;k<threads;k++) {
+      Queue &q=queues[(t+k)%threads];
+      std::lock_guard<std::mutex> guard(q.lock);
+
+      if (!q.tasks.empty()) {
+        i=q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // no task is ever added while running, so a thread finding all the queues empty is done
+  void Work(int t, const std::function<void(size_t)> &task) {
+    size_t i;
+
+    while (PopOwn(t,i) || Steal(t,i))
+      task(i);
+  }
+};
+
+#endif
@@ -0,0 +1,312 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Cost of a control tick of the zones (the Zone::Control of the firmware: the heating time from the action,
+// then the control) with the controls stored in a ControlVariant and dispatched by their ControlType, and with
+// the previous hierarchy: the controls behind an abstract base with virtual Control and GetControlType, constructed
+// in place in a slot and reached through a pointer, and a virtual action. The control bodies are the firmware ones;
+// the types of the zones are chosen at run time as from the configuration. The two storages run in lockstep on the
+// same temperatures and must give the same demands. It also times Active/On/Off of the action, inline and virtual.
+// Serial of common/Arduino.h discards the logging, which on the esp8266 costs far more than the rest of a tick.
+// PidAutotuneControl needs ArduinoJson and is not in the list: it only adds a comparison to the chains.
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -I.. -Icommon control_dispatch/control_dispatch.cpp ../OnOffControl.cpp ../PidControl.cpp ../CascadeControl.cpp ../MpcControl.cpp ../MpcEngine.cpp ../PidEngine.cpp ../SmithPredictor.cpp ../GainSchedule.cpp ../FopdtModel.cpp -o control_dispatch
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include "ControlVariant.h"
+#include "OnOffControl.h"
+#include "PidControl.h"
+#include "CascadeControl.h"
+#include "MpcControl.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TICKS() __rdtsc()
+#else
+#define TICKS() 0ULL
+#endif
+
+#define ZONES     4
+#define TICKS_RUN 200000UL  // control ticks of each run
+#define RUNS      25
+#define PERIOD    100        // ms between the samples
+#define ACTIONS   2000000UL
+
+unsigned long hostMillis=0;
+
+volatile int pins[16];
+
+// the digitalRead and digitalWrite of the core are not inlined either
+__attribute__((noinline)) void ActionPinMode(int pin) {
+  pins[pin]=LOW;
+}
+
+__attribute__((noinline)) int ActionRead(int pin) {
+  return pins[pin];
+}
+
+__attribute__((noinline)) void ActionWrite(int pin, int value) {
+  pins[pin]=value;
+}
+
+
+typedef ControlVariant<OnOffControl,PidControl,CascadeControl,MpcControl> BenchControl;
+
+
+// previous hierarchy: virtual functions in the base, the object constructed in place in a slot of its zone
+class VirtualControl {
+public:
+  virtual ~VirtualControl() { }
+  virtual void Control(bool started, unsigned long now)=0;
+  virtual ControlType GetControlType()=0;
+  virtual double GetDemand()=0;
+};
+
+template <class T> class VirtualAdapter: public VirtualControl {
+public:
+  T c;
+
+  template <class... Args> VirtualAdapter(Args... args) : c(args...) { }
+  void Control(bool started, unsigned long now) override { c.Control(started,now); }
+  ControlType GetControlType() override { return T::Type; }
+  double GetDemand() override { return c.GetDemand(); }
+};
+
+class VirtualAction {
+public:
+  virtual bool Active()=0;
+  virtual void On()=0;
+  virtual void Off()=0;
+};
+
+class RelayAction: public VirtualAction {
+public:
+  IControlAction a;
+
+  RelayAction(int pin) : a(pin,false) { }
+  bool Active() override { return a.Active(); }
+  void On() override { a.On(); }
+  void Off() override { a.Off(); }
+};
+
+union VirtualSlot {
+  char onOff[sizeof(VirtualAdapter<OnOffControl>)];
+  char pid[sizeof(VirtualAdapter<PidControl>)];
+  char cascade[sizeof(VirtualAdapter<CascadeControl>)];
+  char mpc[sizeof(VirtualAdapter<MpcControl>)];
+  double align;
+  void *alignPtr;
+};
+
+
+struct BenchZone {
+  double set,target,actual;
+  unsigned long heatingMs,lastSample;
+};
+
+
+// the zones of the firmware set up with one of the two storages, the chamber of the cascade is zone 1
+class Bench {
+public:
+  BenchZone zones[ZONES];
+  IControlAction actions[ZONES]={ IControlAction(0,false), IControlAction(1,false), IControlAction(2,false), IControlAction(3,false) };
+  RelayAction relays[ZONES]={ RelayAction(4), RelayAction(5), RelayAction(6), RelayAction(7) };
+  VirtualAction *virtualActions[ZONES];
+  BenchControl controls[ZONES];
+  VirtualSlot slots[ZONES];
+  VirtualControl *virtuals[ZONES];
+  MpcGroup group[2];
+
+  Bench(const ControlType *types) {
+    MpcZoneModel model={ 0.5, 0.0005, 0, 60, 2000 };
+
+    for (int i=0;i<2;i++)
+      group[i].engine.Configure(1,&model,10,20,2,0.01,3000,20);
+
+    for (int i=0;i<ZONES;i++) {
+      zones[i]={ 220, 220, 20, 0, 0 };
+      virtualActions[i]=&relays[i];
+      Emplace(i,types[i]);
+    }
+  }
+
+  void Emplace(int i, ControlType type) {
+    BenchZone &z=zones[i];
+    IControlAction *a=&actions[i];
+    IControlAction *va=&relays[i].a;
+    double *inner=&zones[1].target;
+
+    switch (type) {
+      case ControlType::OnOff:
+        controls[i].Emplace<OnOffControl>("zone",a,&z.set,&z.actual,5);
+        virtuals[i]=new (&slots[i]) VirtualAdapter<OnOffControl>("zone",va,&z.set,&z.actual,5);
+        break;
+      case ControlType::Cascade:
+        controls[i].Emplace<CascadeControl>("zone",a,&z.target,&z.actual,inner,2.0,0.01,30.0)->SetTrim(0.05,0.3);
+        ((VirtualAdapter<CascadeControl> *) (virtuals[i]=new (&slots[i]) VirtualAdapter<CascadeControl>("zone",va,&z.target,&z.actual,inner,2.0,0.01,30.0)))->c.SetTrim(0.05,0.3);
+        break;
+      case ControlType::MPC:
+        controls[i].Emplace<MpcControl>("zone",a,&group[0],0,&z.target,&z.actual);
+        virtuals[i]=new (&slots[i]) VirtualAdapter<MpcControl>("zone",va,&group[1],0,&z.target,&z.actual);
+        break;
+      default:
+        controls[i].Emplace<PidControl>("zone",a,&z.target,&z.actual,2000.0,2.0,0.0,5000);
+        virtuals[i]=new (&slots[i]) VirtualAdapter<PidControl>("zone",va,&z.target,&z.actual,2000.0,2.0,0.0,5000);
+        break;
+    }
+  }
+
+  // temperatures of the tick, the same for both storages: a triangle wave of 50C over 400s and a bit of noise
+  void Sample(unsigned long tick) {
+    for (int i=0;i<ZONES;i++) {
+      unsigned long phase=(tick+i*1000)%4000;
+
+      zones[i].actual=175+((phase<2000)?phase:4000-phase)*0.025+((tick*7919+i*104729)%100)*0.01;
+    }
+  }
+
+  void TickVariant(bool started, unsigned long now) {
+    for (int i=0;i<ZONES;i++) {
+      BenchZone &z=zones[i];
+
+      if (z.lastSample!=0 && actions[i].Active())
+        z.heatingMs+=now-z.lastSample;
+      z.lastSample=now;
+      controls[i].Control(started,now);
+    }
+  }
+
+  void TickVirtual(bool started, unsigned long now) {
+    for (int i=0;i<ZONES;i++) {
+      BenchZone &z=zones[i];
+
+      if (z.lastSample!=0 && virtualActions[i]->Active())
+        z.heatingMs+=now-z.lastSample;
+      z.lastSample=now;
+      virtuals[i]->Control(started,now);
+    }
+  }
+};
+
+
+struct Timing {
+  double ns,ticks;
+};
+
+
+// ns and tsc ticks of a Control() of a zone: the loops with the samples alone, with the variant and with the
+// virtual controls are interleaved and the fastest of RUNS runs of each is kept (the least disturbed by the rest of
+// the machine), the samples alone are subtracted. The demands of the two storages are compared after each run.
+void Run(const ControlType *types, bool started, Timing &variant, Timing &virtuals, bool &same) {
+  Bench bench(types);
+  Timing best[3];
+
+  for (int p=0;p<3;p++)
+    best[p]={ 1e30, 1e30 };
+  same=true;
+
+  for (int run=0;run<RUNS;run++) {
+    // 0 samples alone, 1 variant, 2 virtual
+    for (int p=0;p<3;p++) {
+      unsigned long base=run*TICKS_RUN;
+      auto start=std::chrono::steady_clock::now();
+      unsigned long long tsc=TICKS();
+
+      for (unsigned long t=0;t<TICKS_RUN;t++) {
+        unsigned long now=1+(base+t)*PERIOD;
+
+        bench.Sample(base+t);
+        if (p==1)
+          bench.TickVariant(started,now);
+        else if (p==2)
+          bench.TickVirtual(started,now);
+      }
+
+      best[p].ticks=std::min(best[p].ticks,(TICKS()-tsc)/(double) (TICKS_RUN*ZONES));
+      best[p].ns=std::min(best[p].ns,std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count()/(TICKS_RUN*ZONES));
+    }
+
+    for (int i=0;i<ZONES;i++)
+      same=same && bench.controls[i].GetDemand()==bench.virtuals[i]->GetDemand() && bench.controls[i].GetControlType()==bench.virtuals[i]->GetControlType();
+  }
+
+  variant={ best[1].ns-best[0].ns, best[1].ticks-best[0].ticks };
+  virtuals={ best[2].ns-best[0].ns, best[2].ticks-best[0].ticks };
+}
+
+
+template <class A> double TimeActions(A &action) {
+  double best=1e30;
+
+  for (int run=0;run<RUNS;run++) {
+    auto start=std::chrono::steady_clock::now();
+
+    for (unsigned long i=0;i<ACTIONS;i++) {
+      if (action.Active())
+        action.Off();
+      else
+        action.On();
+    }
+    best=std::min(best,std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count()/ACTIONS);
+  }
+  return best;
+}
+
+
+int main() {
+  static const ControlType mixed[ZONES]={ ControlType::PID, ControlType::PID, ControlType::Cascade, ControlType::MPC };
+  static const ControlType onOff[ZONES]={ ControlType::OnOff, ControlType::OnOff, ControlType::OnOff, ControlType::OnOff };
+  static const ControlType pid[ZONES]={ ControlType::PID, ControlType::PID, ControlType::PID, ControlType::PID };
+  static const struct { const char *name; const ControlType *types; bool started; } cases[]={
+    { "pid, pid, cascade, mpc, started", mixed, true },
+    { "pid, pid, cascade, mpc, stopped", mixed, false },
+    { "4 pid, started", pid, true },
+    { "4 on/off, started", onOff, true },
+  };
+
+  printf("per Control() of a zone, best of %d runs of %lu ticks of %d zones\n\n",RUNS,TICKS_RUN,ZONES);
+  printf("%-34s %10s %10s %11s %11s %9s %6s\n","","variant ns","virtual ns","variant tsc","virtual tsc","variant","same");
+  for (auto &c : cases) {
+    Timing variant,virtuals;
+    bool same;
+
+    Run(c.types,c.started,variant,virtuals,same);
+    printf("%-34s %10.2f %10.2f %11.1f %11.1f %+8.1f%% %6s\n",c.name,variant.ns,virtuals.ns,variant.ticks,virtuals.ticks,
+      100*(variant.ns-virtuals.ns)/virtuals.ns,same?"yes":"NO");
+  }
+  printf("(variant: time of the variant against the virtual hierarchy, + slower; same: equal demands and types)\n");
+
+  // the action is reached through a pointer in both, as in the zones
+  IControlAction action(8,false);
+  RelayAction relay(9);
+  IControlAction *direct=&action;
+  VirtualAction *indirect=&relay;
+
+  double directNs=TimeActions(*direct),virtualNs=TimeActions(*indirect);
+  printf("\naction Active()+On()/Off(): inline %.2f ns, virtual %.2f ns\n",directNs,virtualNs);
+
+  printf("storage of a zone control: variant %zu bytes, virtual slot %zu bytes\n",sizeof(BenchControl),sizeof(VirtualSlot));
+  return 0;
+}
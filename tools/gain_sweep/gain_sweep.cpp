@@ -0,0 +1,301 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Gain sweep of the chamber PidControl (PidEngine, low pass filter of the probe, relay time proportioning)
+// over a grid of kp, ki, kd, window sizes and filter alphas, each simulated on a set of randomized ovens
+// (Monte Carlo on the parameters of the oven model, probe noise, ambient and a door opening), distributed on
+// all the cores by a work stealing pool. Every oven is the same for all the grid points (same parameters
+// and random sequences), so the results don't depend on the number of threads. The Pareto front of the 90th
+// percentile over the ovens of overshoot and time to setpoint shows the gains that hold up on all of them.
+// Gains are in ms of the relay window as in the firmware configuration.
+//
+//   -n ovens (16)  -j threads (all cores)  -s seed (1)  -t set temperature (250)  -o csv file of all the grid points
+//
+// g++ -O2 -std=c++11 -pthread -I.. -Icommon gain_sweep/gain_sweep.cpp ../PidEngine.cpp ../LowPassFilter.cpp -o gain_sweep
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "LowPassFilter.h"
+#include "WorkStealingPool.h"
+
+#define BAND 2.0          // C, tolerance for reaching the set temperature
+#define DURATION 6000     // s of simulation from ambient
+#define PERCENTILE 0.9
+#define DOOR_FROM 3600    // s, the door opens at a random time in this interval
+#define DOOR_TO 4800
+
+
+struct Config {
+  double kp,ki,kd;
+  int window;      // ms
+  double alpha;
+};
+
+struct Oven {
+  OvenModelParams p;
+  unsigned seed;
+  double doorOpen,doorClose;  // s
+  double doorLoss;            // W
+};
+
+struct Outcome {
+  double rise;       // s to reach set-BAND, INFINITY if never
+  double overshoot;  // C above set after the rise, before the door opens
+  double drop;       // C below set after the door opens
+  double recovery;   // s from the door closing to be back within BAND
+};
+
+struct Summary {
+  double rise,overshoot,maxOvershoot,drop,recovery;
+  int failures;
+  bool pareto;
+};
+
+
+double Vary(std::mt19937 &rng, double value, double spread) {
+  return value*std::uniform_real_distribution<double>(1-spread,1+spread)(rng);
+}
+
+
+// a slightly different oven of the fleet
+Oven RandomOven(std::mt19937 &rng) {
+  Oven o;
+  OvenModelParams &p=o.p;
+
+  p=OvenModelParams::Default();
+  p.ambient=std::uniform_real_distribution<double>(10,30)(rng);
+  for (int z=0;z<OVEN_ZONES;z++) {
+    p.power[z]=Vary(rng,p.power[z],0.1);
+    p.capacity[z]=Vary(rng,p.capacity[z],0.15);
+    p.loss[z]=Vary(rng,p.loss[z],0.2);
+    p.radiation[z]=Vary(rng,p.radiation[z],0.2);
+    p.probeTau[z]=Vary(rng,p.probeTau[z],0.3);
+    p.deadTime[z]=Vary(rng,p.deadTime[z],0.3);
+  }
+  p.coupling=Vary(rng,p.coupling,0.2);
+  p.noise=std::uniform_real_distribution<double>(0,0.3)(rng);
+
+  o.seed=rng();
+  o.doorOpen=std::uniform_real_distribution<double>(DOOR_FROM,DOOR_TO)(rng);
+  o.doorClose=o.doorOpen+std::uniform_real_distribution<double>(20,60)(rng);
+  o.doorLoss=std::uniform_real_distribution<double>(1000,2500)(rng);
+
+  return o;
+}
+
+
+// preheat of the chamber (stone heater off) with the logic of PidControl and loop() of the firmware
+Outcome Simulate(const Config &c, const Oven &o, double set) {
+  OvenModel oven(o.p,o.seed);
+  std::mt19937 rng(o.seed);
+  std::uniform_int_distribution<int> loopPeriod(100,250);
+  LowPassFilter filter(c.alpha);
+  PidEngine pid;
+  Outcome r={INFINITY,0,0,0};
+  unsigned long now=1000;
+  double output=0;
+  bool back=false;
+
+  pid.SetTunings(c.kp,c.ki,c.kd);
+  pid.SetOutputLimits(0,c.window);
+  pid.SetSampleTime(1000);
+  pid.SetAutomatic(true,set,oven.Measure(0),0);
+
+  while (now<DURATION*1000UL) {
+    unsigned long dt=loopPeriod(rng);
+    double heater[OVEN_ZONES]={((now%c.window)<output)?1.0:0.0,0};
+    double t=now/1000.0;
+
+    oven.disturbance[0]=(t>=o.doorOpen && t<o.doorClose)?o.doorLoss:0;
+    for (unsigned long s=0;s<dt;s+=100)
+      oven.Step(0.1,heater);
+    now+=dt;
+
+    pid.Compute(set,filter.GetFilteredValue(oven.Measure(0)),now,output);
+
+    double temp=oven.temp[0];
+    t=now/1000.0;
+    if (r.rise==INFINITY && temp>=set-BAND)
+      r.rise=t;
+    if (t<o.doorOpen) {
+      if (r.rise!=INFINITY && temp-set>r.overshoot)
+        r.overshoot=temp-set;
+    }
+    else {
+      r.drop=fmax(r.drop,set-temp);
+      if (t>=o.doorClose && !back) {
+        if (fabs(temp-set)<=BAND)
+          back=true;
+        else
+          r.recovery=t-o.doorClose;
+      }
+    }
+  }
+
+  return r;
+}
+
+
+double Percentile(std::vector<double> v, double q) {
+  std::sort(v.begin(),v.end());
+  return v[(size_t) ceil(q*(v.size()-1))];
+}
+
+
+int main(int argc, char *argv[]) {
+  int ovens=16,threads=std::thread::hardware_concurrency();
+  unsigned seed=1;
+  double set=250;
+  const char *csv=NULL;
+
+  for (int i=1;i<argc;i++) {
+    if (i+1<argc && strcmp(argv[i],"-n")==0)
+      ovens=atoi(argv[++i]);
+    else if (i+1<argc && strcmp(argv[i],"-j")==0)
+      threads=atoi(argv[++i]);
+    else if (i+1<argc && strcmp(argv[i],"-s")==0)
+      seed=atoi(argv[++i]);
+    else if (i+1<argc && strcmp(argv[i],"-t")==0)
+      set=atof(argv[++i]);
+    else if (i+1<argc && strcmp(argv[i],"-o")==0)
+      csv=argv[++i];
+    else {
+      fprintf(stderr,"usage: %s [-n ovens] [-j threads] [-s seed] [-t set] [-o file.csv]\n",argv[0]);
+      return 1;
+    }
+  }
+  if (ovens<1)
+    ovens=1;
+
+  std::vector<Config> configs;
+  for (double kp : {60,120,250,500})
+    for (double ki : {0.25,0.5,1.0,2.0})
+      for (double kd : {0,200,1000,4000})
+        for (int window : {2000,5000,10000})
+          for (double alpha : {0.1,0.3,0.6})
+            configs.push_back(Config{kp,ki,kd,window,alpha});
+
+  std::mt19937 rng(seed);
+  std::vector<Oven> fleet;
+  for (int i=0;i<ovens;i++)
+    fleet.push_back(RandomOven(rng));
+
+  std::vector<Outcome> outcomes(configs.size()*ovens);
+  WorkStealingPool pool(threads);
+  auto start=std::chrono::steady_clock::now();
+
+  pool.Run(outcomes.size(),[&](size_t i) {
+    outcomes[i]=Simulate(configs[i/ovens],fleet[i%ovens],set);
+  });
+
+  double elapsed=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+  std::vector<Summary> summary(configs.size());
+  for (size_t c=0;c<configs.size();c++) {
+    std::vector<double> rise,overshoot,drop,recovery;
+    Summary &s=summary[c];
+
+    s.failures=0;
+    for (int o=0;o<ovens;o++) {
+      const Outcome &r=outcomes[c*ovens+o];
+
+      s.failures+=(r.rise==INFINITY);
+      rise.push_back(r.rise);
+      overshoot.push_back(r.overshoot);
+      drop.push_back(r.drop);
+      recovery.push_back(r.recovery);
+    }
+    s.rise=Percentile(rise,PERCENTILE);
+    s.overshoot=Percentile(overshoot,PERCENTILE);
+    s.maxOvershoot=Percentile(overshoot,1);
+    s.drop=Percentile(drop,PERCENTILE);
+    s.recovery=Percentile(recovery,PERCENTILE);
+  }
+
+  // not dominated in both rise and overshoot by another grid point reaching the set temperature on all the ovens
+  std::vector<int> front;
+  for (size_t c=0;c<configs.size();c++) {
+    Summary &s=summary[c];
+
+    s.pareto=(s.failures==0);
+    for (size_t k=0;k<configs.size() && s.pareto;k++) {
+      Summary &o=summary[k];
+
+      if (k!=c && o.failures==0 && o.rise<=s.rise && o.overshoot<=s.overshoot && (o.rise<s.rise || o.overshoot<s.overshoot))
+        s.pareto=false;
+    }
+    if (s.pareto)
+      front.push_back(c);
+  }
+  std::sort(front.begin(),front.end(),[&](int a,int b) { return summary[a].rise<summary[b].rise; });
+
+  printf("Chamber preheat to %.0fC: %zu grid points x %d ovens = %zu simulations on %d threads in %.1fs (%.0f/s)\n",set,
+         configs.size(),ovens,outcomes.size(),pool.GetThreads(),elapsed,outcomes.size()/elapsed);
+  printf("p90 over the ovens, door opened %.0f-%.0f min after start\n\n",DOOR_FROM/60.0,DOOR_TO/60.0);
+  printf("%6s %6s %6s %6s %5s | %8s %8s %8s %8s %8s %5s\n","kp","ki","kd","window","alpha","rise s","over C","max C","drop C","recov s","fail");
+
+  auto Print=[&](size_t c) {
+    const Config &k=configs[c];
+    const Summary &s=summary[c];
+
+    printf("%6g %6g %6g %6d %5g | %8.0f %8.1f %8.1f %8.1f %8.0f %5d\n",k.kp,k.ki,k.kd,k.window,k.alpha,s.rise,s.overshoot,s.maxOvershoot,
+           s.drop,s.recovery,s.failures);
+  };
+
+  for (int c : front)
+    Print(c);
+
+  // the firmware defaults for reference
+  for (size_t c=0;c<configs.size();c++)
+    if (configs[c].kp==120 && configs[c].ki==1 && configs[c].kd==200 && configs[c].window==5000 && configs[c].alpha==0.3) {
+      printf("\nFirmware defaults (%s):\n",summary[c].pareto?"on the front":"dominated");
+      Print(c);
+    }
+
+  if (csv!=NULL) {
+    FILE *f=fopen(csv,"w");
+
+    if (f==NULL) {
+      fprintf(stderr,"can't write %s\n",csv);
+      return 1;
+    }
+    fprintf(f,"kp,ki,kd,window,alpha,rise,overshoot,maxOvershoot,drop,recovery,failures,pareto\n");
+    for (size_t c=0;c<configs.size();c++) {
+      const Config &k=configs[c];
+      const Summary &s=summary[c];
+
+      fprintf(f,"%g,%g,%g,%d,%g,%.0f,%.2f,%.2f,%.2f,%.0f,%d,%d\n",k.kp,k.ki,k.kd,k.window,k.alpha,s.rise,s.overshoot,s.maxOvershoot,
+              s.drop,s.recovery,s.failures,s.pareto);
+    }
+    fclose(f);
+  }
+
+  return 0;
+}
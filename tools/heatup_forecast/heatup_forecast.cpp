@@ -0,0 +1,155 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Accuracy of the ready time forecast of HeatupModel on the oven model: a preheat each day, a bake of an hour
+// at the set temperature and the oven off overnight, with the heater power losing a few percent a day as the
+// elements age. At fixed times into each preheat the forecast of each zone is compared with the time it
+// actually became ready, both with the learned curve and with the extrapolation of the recent heating rate
+// the model falls back to. The learned full power rate at the set temperature tracks the loss of power.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon heatup_forecast/heatup_forecast.cpp ../HeatupModel.cpp ../PidEngine.cpp ../LowPassFilter.cpp -o heatup_forecast
+
+#include <stdio.h>
+#include <math.h>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "LowPassFilter.h"
+#include "HeatupModel.h"
+
+#define WINDOW_SIZE 5000
+#define LOOP_MS 200
+#define DAYS 6
+#define AGING 0.03        // heater power lost each day
+#define BAKE 3600         // s at the set temperature after the preheat
+#define CHECKPOINTS 4
+
+const double setTemp[OVEN_ZONES]={ 300, 280 };
+const int checkpoints[CHECKPOINTS]={ 120, 300, 600, 1200 };  // s into the preheat
+
+
+struct Forecast {
+  double model,rate;  // forecast ready time (s from the start), -1 if none
+};
+
+
+int main() {
+  OvenModelParams params=OvenModelParams::Default();
+  OvenModel oven(params);
+  HeatupModel heatup[OVEN_ZONES];
+  double errModel[CHECKPOINTS]={0},errRate[CHECKPOINTS]={0};
+  int countModel[CHECKPOINTS]={0},countRate[CHECKPOINTS]={0};
+
+  printf("%-4s %-5s %8s |","day","zone","ready s");
+  for (int c=0;c<CHECKPOINTS;c++)
+    printf(" %4ds: model   rate |",checkpoints[c]);
+  printf(" full C/min\n");
+
+  for (int day=0;day<DAYS;day++) {
+    PidEngine pid[OVEN_ZONES];
+    LowPassFilter filter[OVEN_ZONES]={LowPassFilter(0.3),LowPassFilter(0.3)};
+    double output[OVEN_ZONES]={0,0},actual[OVEN_ZONES];
+    unsigned long heatingMs[OVEN_ZONES]={0,0},now=1000;
+    double ready[OVEN_ZONES]={-1,-1};
+    Forecast forecast[OVEN_ZONES][CHECKPOINTS];
+    int next=0;
+
+    for (int z=0;z<OVEN_ZONES;z++) {
+      oven.p.power[z]=params.power[z]*pow(1-AGING,day);
+      actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+      pid[z].SetTunings(120,1,200);
+      pid[z].SetOutputLimits(0,WINDOW_SIZE);
+      pid[z].SetSampleTime(1000);
+      pid[z].SetAutomatic(true,0,actual[z],0);
+    }
+
+    while (ready[0]<0 || ready[1]<0 || now<(unsigned long) (fmax(ready[0],ready[1])+BAKE)*1000) {
+      double heater[OVEN_ZONES];
+
+      for (int z=0;z<OVEN_ZONES;z++) {
+        heater[z]=((now%WINDOW_SIZE)<output[z])?1:0;
+        if (heater[z]>0)
+          heatingMs[z]+=LOOP_MS;
+      }
+      oven.Step(LOOP_MS/1000.0,heater);
+      now+=LOOP_MS;
+
+      for (int z=0;z<OVEN_ZONES;z++) {
+        actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+        pid[z].Compute(setTemp[z],actual[z],now,output[z]);
+        heatup[z].Update(actual[z],heatingMs[z],now);
+        if (ready[z]<0 && heatup[z].GetEta(actual[z],setTemp[z])==0)
+          ready[z]=now/1000.0;
+      }
+
+      // the forecast, as shown by the ui at the checkpoint, of the time the zone will be ready
+      if (next<CHECKPOINTS && now>=checkpoints[next]*1000UL) {
+        for (int z=0;z<OVEN_ZONES;z++) {
+          double eta=heatup[z].GetEta(actual[z],setTemp[z]);
+          Forecast &f=forecast[z][next];
+
+          f.model=heatup[z].IsValid()?now/1000.0+eta:-1;
+          // what the model falls back to before it has learned the curve
+          f.rate=heatup[z].GetRate()>0?now/1000.0+fmax(setTemp[z]-HEATUP_BAND-actual[z],0)/(heatup[z].GetRate()/60):-1;
+        }
+        next++;
+      }
+    }
+
+    for (int z=0;z<OVEN_ZONES;z++) {
+      printf("%-4d %-5s %8.0f |",day+1,z==0?"ch.":"stone",ready[z]);
+      for (int c=0;c<CHECKPOINTS;c++) {
+        Forecast &f=forecast[z][c];
+        double remaining=ready[z]-checkpoints[c];
+
+        if (remaining<=0) {
+          printf(" %17s |","ready");
+          continue;
+        }
+        printf(" %10.0f %6.0f |",f.model,f.rate);
+        // relative error on the remaining time
+        if (f.model>=0) {
+          errModel[c]+=fabs(f.model-ready[z])/remaining;
+          countModel[c]++;
+        }
+        if (f.rate>=0) {
+          errRate[c]+=fabs(f.rate-ready[z])/remaining;
+          countRate[c]++;
+        }
+      }
+      printf(" %9.2f\n",heatup[z].GetFullPowerRate(setTemp[z]));
+    }
+
+    // overnight the oven is off and cools down
+    double off[OVEN_ZONES]={0,0};
+    for (int s=0;s<12*3600;s++)
+      oven.Step(1,off);
+    for (int s=0;s<1000;s++)
+      oven.Step(0.1,off);
+  }
+
+  printf("\nmean relative error of the remaining time:\n");
+  for (int c=0;c<CHECKPOINTS;c++)
+    printf("  at %4ds: learned curve %5.1f%% (%d), recent rate %5.1f%% (%d)\n",checkpoints[c],
+      countModel[c]?errModel[c]/countModel[c]*100:0,countModel[c],countRate[c]?errRate[c]/countRate[c]*100:0,countRate[c]);
+
+  return 0;
+}
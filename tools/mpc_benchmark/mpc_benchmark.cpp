@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Preheat of chamber and stone on the oven model with independent pids, the cascade of CascadeControl and
+// the model predictive control of MpcEngine, whose model is linearized from the oven model itself. Reports the
+// time to ready (both zones within BAND of their set temperature), when they stay there, the overshoot
+// of each zone. The power budget of the mpc limits the duties, the instantaneous limit of RelayScheduler is
+// not simulated.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon mpc_benchmark/mpc_benchmark.cpp ../PidEngine.cpp ../MpcEngine.cpp ../LowPassFilter.cpp -o mpc_benchmark
+
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "MpcEngine.h"
+#include "LowPassFilter.h"
+
+#define WINDOW_SIZE 5000
+#define BAND 2.0        // C, tolerance for ready and settling
+#define DURATION 7200   // s
+
+
+struct Result {
+  double ready;                   // s when both zones first are within BAND
+  double settling;                // s after which both zones stay within BAND
+  double overshoot[OVEN_ZONES];   // C above set
+};
+
+
+PidEngine *NewPid(double kp, double ki, double kd, double outMin, double outMax) {
+  PidEngine *pid=new PidEngine();
+
+  pid->SetTunings(kp,ki,kd);
+  pid->SetOutputLimits(outMin,outMax);
+  pid->SetSampleTime(1000);
+  return pid;
+}
+
+
+struct Independent {
+  PidEngine *pid[OVEN_ZONES];
+
+  Independent() {
+    for (int z=0;z<OVEN_ZONES;z++)
+      pid[z]=NewPid(120,1,200,0,WINDOW_SIZE);
+  }
+  void Start(const double actual[OVEN_ZONES], unsigned long now) {
+    for (int z=0;z<OVEN_ZONES;z++)
+      pid[z]->SetAutomatic(true,0,actual[z],0);
+  }
+  void Compute(const double set[OVEN_ZONES], const double actual[OVEN_ZONES], unsigned long now, double output[OVEN_ZONES]) {
+    for (int z=0;z<OVEN_ZONES;z++)
+      pid[z]->Compute(set[z],actual[z],now,output[z]);
+  }
+};
+
+
+// cascade on the stone set temperature (the chamber one is not used), defaults of the firmware
+struct Cascade {
+  double target;
+  PidEngine *outer,*chamber;
+
+  Cascade() {
+    outer=NewPid(2,0.005,0,-50,50);
+    chamber=NewPid(120,1,200,0,WINDOW_SIZE);
+  }
+  void Start(const double actual[OVEN_ZONES], unsigned long now) {
+    outer->SetAutomatic(true,0,actual[1],0);
+    chamber->SetAutomatic(true,0,actual[0],0);
+    target=0;
+  }
+  void Compute(const double set[OVEN_ZONES], const double actual[OVEN_ZONES], unsigned long now, double output[OVEN_ZONES]) {
+    double out=0;
+
+    if (outer->Compute(set[1],actual[1],now,out))
+      target=set[1]+out;
+    chamber->Compute(target,actual[0],now,output[0]);
+    output[1]=fmin(fmax(0.05*(set[1]-actual[1]),0),1)*WINDOW_SIZE;
+  }
+};
+
+
+// same logic of MpcControl: one step each GetStepMs, the duties are held in between
+struct Mpc {
+  MpcEngine mpc;
+  unsigned long last;
+
+  Mpc(double step, int horizon, int moves, double moveWeight, double budget, bool lag=true) {
+    OvenModelParams p=OvenModelParams::Default();
+    OvenModel oven(p);
+    MpcZoneModel m[OVEN_ZONES];
+
+    // losses linearized at 250C
+    for (int z=0;z<OVEN_ZONES;z++) {
+      m[z].gain=p.power[z]/p.capacity[z];
+      m[z].loss=oven.Loss(z,250)/(250-p.ambient)/p.capacity[z];
+      m[z].coupling=p.coupling/p.capacity[z];
+      m[z].power=p.power[z];
+      m[z].lag=lag?p.probeTau[z]+p.deadTime[z]:0;
+    }
+
+    if (!mpc.Configure(OVEN_ZONES,m,step,horizon,moves,moveWeight,budget,p.ambient))
+      printf("invalid mpc parameters\n");
+  }
+  void Start(const double actual[OVEN_ZONES], unsigned long now) {
+    mpc.Reset(actual);
+    last=now-mpc.GetStepMs();
+  }
+  void Compute(const double set[OVEN_ZONES], const double actual[OVEN_ZONES], unsigned long now, double output[OVEN_ZONES]) {
+    if (now-last>=mpc.GetStepMs()) {
+      last+=mpc.GetStepMs();
+      mpc.Step(set,actual);
+    }
+    for (int z=0;z<OVEN_ZONES;z++)
+      output[z]=mpc.GetDuty(z)*WINDOW_SIZE;
+  }
+};
+
+
+template<class Controller> Result Run(Controller &c, const double set[OVEN_ZONES]) {
+  OvenModelParams p=OvenModelParams::Default();
+  OvenModel oven(p);
+  LowPassFilter filter[OVEN_ZONES]={LowPassFilter(0.3),LowPassFilter(0.3)};
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> loopPeriod(100,250);
+  Result r={-1,0,{0,0}};
+  double output[OVEN_ZONES]={0,0},actual[OVEN_ZONES];
+  unsigned long now=1000;
+
+  for (int z=0;z<OVEN_ZONES;z++)
+    actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+  c.Start(actual,now);
+
+  while (now/1000.0<DURATION) {
+    unsigned long dt=loopPeriod(rng);
+    double heater[OVEN_ZONES];
+
+    // relay state during the next loop period, the windows of the two relays are staggered like in RelayScheduler
+    for (int z=0;z<OVEN_ZONES;z++)
+      heater[z]=(((now+z*WINDOW_SIZE/2)%WINDOW_SIZE)<output[z])?1:0;
+    for (unsigned long t=0;t<dt;t+=100)
+      oven.Step(0.1,heater);
+    now+=dt;
+
+    for (int z=0;z<OVEN_ZONES;z++)
+      actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+    c.Compute(set,actual,now,output);
+
+    double elapsed=now/1000.0;
+    bool inBand=true;
+
+    for (int z=0;z<OVEN_ZONES;z++) {
+      inBand=inBand && fabs(oven.temp[z]-set[z])<=BAND;
+      r.overshoot[z]=fmax(r.overshoot[z],oven.temp[z]-set[z]);
+    }
+
+    if (r.ready<0 && inBand)
+      r.ready=elapsed;
+    if (!inBand)
+      r.settling=elapsed;
+  }
+
+  return r;
+}
+
+
+template<class C> void Benchmark(const char *name, C c) {
+  double sets[][OVEN_ZONES]={ {250,250}, {300,250}, {330,300} };
+
+  printf("%-26s",name);
+  for (auto &set : sets) {
+    Result r=Run(c,set);
+    printf(" | %6.0f %6.0f %5.1f %5.1f",r.ready,r.settling,r.overshoot[0],r.overshoot[1]);
+  }
+  printf("\n");
+}
+
+
+int main() {
+  printf("%-26s | %-27s | %-27s | %-27s\n","","chamber 250C stone 250C","chamber 300C stone 250C","chamber 330C stone 300C");
+  printf("%-26s | %6s %6s %5s %5s | %6s %6s %5s %5s | %6s %6s %5s %5s\n","controller",
+    "ready","settl","ch ov","st ov","ready","settl","ch ov","st ov","ready","settl","ch ov","st ov");
+
+  Benchmark("independent pids",Independent());
+  Benchmark("cascade (stone set only)",Cascade());
+  Benchmark("mpc 10s 20 steps",Mpc(10,20,3,1000,0));
+  Benchmark("mpc without probe lag",Mpc(10,20,3,1000,0,false));
+  Benchmark("mpc budget 2500W",Mpc(10,20,3,1000,2500));
+  Benchmark("mpc 30s 20 steps",Mpc(30,20,3,1000,0));
+
+  return 0;
+}
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Closed loop comparison of PidEngine against the PID_v1 algorithm on the oven model: preheat of the chamber
+// from ambient and a set temperature step, with the relay time proportioning of the firmware and the loop
+// period jitter of loop() (delay(100) plus http and serial work).
+// The second table compares fixed gains with the gain schedule and feed forward of PidControl when
+// preheating to low, medium and high temperatures.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon pid_benchmark/pid_benchmark.cpp ../PidEngine.cpp ../LowPassFilter.cpp ../GainSchedule.cpp -o pid_benchmark
+
+#include <stdio.h>
+#include <random>
+#include "OvenModel.h"
+#include "PidV1.h"
+#include "PidEngine.h"
+#include "LowPassFilter.h"
+#include "GainSchedule.h"
+
+#define WINDOW_SIZE 5000
+#define BAND 2.0        // C, tolerance for reaching and settling
+
+
+struct Gains {
+  double kp,ki,kd;
+};
+
+struct Result {
+  double rise;       // s to reach set-BAND
+  double overshoot;  // C above set after the rise
+  double settling;   // s after which the temperature stays within BAND
+  double iae;        // C*min
+  double ripple;     // peak to peak in the last 15 minutes, C
+};
+
+
+// simulates a set temperature step from the current state of the model for duration seconds
+template<class Controller> Result Run(OvenModel &oven, Controller &pid, LowPassFilter &filter, double set, double duration, unsigned long &now, std::mt19937 &rng) {
+  std::uniform_int_distribution<int> loopPeriod(100,250);
+  Result r={-1,0,0,0,0};
+  double output=0,rippleMin=1e9,rippleMax=-1e9;
+  double start=now/1000.0;
+
+  while (now/1000.0-start<duration) {
+    unsigned long dt=loopPeriod(rng);
+    double heater[OVEN_ZONES]={0,0};
+
+    // relay state during the next loop period
+    heater[0]=((now%WINDOW_SIZE)<output)?1:0;
+    for (unsigned long t=0;t<dt;t+=100)
+      oven.Step(0.1,heater);
+    now+=dt;
+
+    double actual=filter.GetFilteredValue(oven.Measure(0));
+    pid.Compute(set,actual,now,output);
+
+    double elapsed=now/1000.0-start;
+    double temp=oven.temp[0];
+
+    if (r.rise<0 && temp>=set-BAND)
+      r.rise=elapsed;
+    if (r.rise>=0 && temp-set>r.overshoot)
+      r.overshoot=temp-set;
+    if (fabs(temp-set)>BAND)
+      r.settling=elapsed;
+    r.iae+=fabs(temp-set)*dt/60000.0;
+    if (elapsed>duration-900) {
+      rippleMin=fmin(rippleMin,temp);
+      rippleMax=fmax(rippleMax,temp);
+    }
+  }
+
+  r.ripple=rippleMax-rippleMin;
+  return r;
+}
+
+
+// adapters with the same Compute signature
+struct V1 {
+  PidV1 pid;
+  V1(Gains g) : pid(g.kp,g.ki,g.kd,0,WINDOW_SIZE) { }
+  void Start(double in, unsigned long now) { pid.SetAutomatic(in,0,now); }
+  void Compute(double set, double in, unsigned long now, double &out) { pid.Compute(set,in,now,out); }
+};
+
+struct Engine {
+  PidEngine pid;
+  Engine(Gains g, double b) {
+    pid.SetTunings(g.kp,g.ki,g.kd);
+    pid.SetOutputLimits(0,WINDOW_SIZE);
+    pid.SetSetpointWeight(b);
+    pid.SetSampleTime(1000);
+  }
+  void Start(double in, unsigned long now) { pid.SetAutomatic(true,0,in,0); }
+  void Compute(double set, double in, unsigned long now, double &out) { pid.Compute(set,in,now,out); }
+};
+
+
+// same logic of PidControl::Control with a gain schedule
+struct Scheduled: Engine {
+  GainSchedule schedule;
+  double ffWeight;
+  Scheduled(const GainPoint *points, int count, double _ffWeight) : Engine(Gains{points[0].kp,points[0].ki,points[0].kd},1) {
+    schedule.Set(points,count);
+    ffWeight=_ffWeight;
+  }
+  void Compute(double set, double in, unsigned long now, double &out) {
+    double kp,ki,kd,duty;
+    schedule.Interpolate(set,kp,ki,kd,duty);
+    pid.SetTunings(kp,ki,kd);
+    pid.SetFeedForward(ffWeight*duty*WINDOW_SIZE);
+    pid.Compute(set,in,now,out);
+  }
+};
+
+
+template<class C> void Preheat(const char *name, C &c) {
+  double sets[]={150,250,320};
+
+  printf("%-28s",name);
+  for (double set : sets) {
+    OvenModel oven(OvenModelParams::Default());
+    LowPassFilter filter(0.3);
+    std::mt19937 rng(42);
+    unsigned long now=1000;
+    C controller=c;
+
+    controller.Start(oven.Measure(0),now);
+    Result r=Run(oven,controller,filter,set,5400,now,rng);
+    printf(" | %7.0f %7.1f %7.0f %6.1f",r.rise,r.overshoot,r.settling,r.ripple);
+  }
+  printf("\n");
+}
+
+
+template<class C> void Benchmark(const char *name, C &c) {
+  OvenModel oven(OvenModelParams::Default());
+  LowPassFilter filter(0.3);
+  std::mt19937 rng(42);
+  unsigned long now=1000;
+
+  c.Start(oven.Measure(0),now);
+  Result preheat=Run(oven,c,filter,250,5400,now,rng);
+  Result step=Run(oven,c,filter,300,3600,now,rng);
+
+  printf("%-28s | %7.0f %7.1f %7.0f %7.1f %6.1f | %7.0f %7.1f %7.0f %7.1f %6.1f\n",name,
+    preheat.rise,preheat.overshoot,preheat.settling,preheat.iae,preheat.ripple,
+    step.rise,step.overshoot,step.settling,step.iae,step.ripple);
+}
+
+
+int main() {
+  Gains gains[]={ {100,5,1}, {120,1,0}, {120,1,200}, {250,2,500} };
+
+  printf("%-28s | %-38s | %-38s\n","","preheat 20->250C (90 min)","step 250->300C (60 min)");
+  printf("%-28s | %7s %7s %7s %7s %6s | %7s %7s %7s %7s %6s\n","controller (kp/ki/kd)","rise s","over C","settl s","IAE","ripple","rise s","over C","settl s","IAE","ripple");
+
+  for (Gains &g : gains) {
+    char name[64];
+    V1 v1(g);
+    Engine engine(g,1),weighted(g,0.5);
+
+    sprintf(name,"PID_v1    %g/%g/%g",g.kp,g.ki,g.kd);
+    Benchmark(name,v1);
+    sprintf(name,"PidEngine %g/%g/%g",g.kp,g.ki,g.kd);
+    Benchmark(name,engine);
+    sprintf(name,"PidEngine b=0.5 %g/%g/%g",g.kp,g.ki,g.kd);
+    Benchmark(name,weighted);
+  }
+
+  // gains scaled with the steady state duty (the process gain drops as the heat loss grows), duty from the model
+  OvenModel model(OvenModelParams::Default());
+  GainPoint points[]={ {150,100,0.8,160,0}, {250,120,1,200,0}, {350,150,1.3,250,0} };
+  for (GainPoint &p : points)
+    p.duty=model.SteadyStateDuty(p.temp);
+
+  printf("\n%-28s | %-29s | %-29s | %-29s\n","","preheat to 150C","preheat to 250C","preheat to 320C");
+  printf("%-28s | %7s %7s %7s %6s | %7s %7s %7s %6s | %7s %7s %7s %6s\n","controller","rise s","over C","settl s","ripple","rise s","over C","settl s","ripple","rise s","over C","settl s","ripple");
+
+  Engine fixed(Gains{120,1,200},1);
+  Scheduled scheduled(points,3,0),feedforward(points,3,0.5);
+  Preheat("PidEngine 120/1/200",fixed);
+  Preheat("gain schedule",scheduled);
+  Preheat("schedule+50% feed forward",feedforward);
+
+  return 0;
+}
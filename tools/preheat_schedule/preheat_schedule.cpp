@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Scheduled preheat on the oven model: every morning the zones must be ready at 11:30, then the oven bakes for two
+// hours and is off until the next morning, with the heater power losing a few percent a day as the elements age.
+// The start planned by PreheatLead from the learned heat-up curves (HeatupModel) is compared with fixed preheat
+// times: minutes late, minutes the oven waited hot before the ready time and heater energy until the ready time.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon preheat_schedule/preheat_schedule.cpp ../Schedule.cpp ../HeatupModel.cpp ../PidEngine.cpp ../LowPassFilter.cpp -o preheat_schedule
+
+#include <stdio.h>
+#include <math.h>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "LowPassFilter.h"
+#include "HeatupModel.h"
+#include "Schedule.h"
+
+#define WINDOW_SIZE 5000
+#define LOOP_MS 200
+#define DAYS 10
+#define AGING 0.02          // heater power lost each day
+#define MORNING (6*3600)    // s, the day starts with the oven off
+#define READY (11*3600+1800)
+#define BAKE 7200
+
+const double setTemp[OVEN_ZONES]={ 300, 320 };
+
+
+struct Totals {
+  double late,idle,energy;  // min, min, kWh
+  int lateDays;
+};
+
+
+// lead <0 plans the start from the learned heat-up curves, else a fixed preheat in s
+Totals Run(double fixedLead, bool print) {
+  OvenModelParams params=OvenModelParams::Default();
+  OvenModel oven(params);
+  HeatupModel heatup[OVEN_ZONES];
+  LowPassFilter filter[OVEN_ZONES]={LowPassFilter(0.3),LowPassFilter(0.3)};
+  double actual[OVEN_ZONES];
+  unsigned long heatingMs[OVEN_ZONES]={0,0};
+  Totals tot={0,0,0,0};
+  unsigned long now=1000;
+  double off[OVEN_ZONES]={0,0};
+
+  for (int day=0;day<DAYS;day++) {
+    for (int z=0;z<OVEN_ZONES;z++)
+      oven.p.power[z]=params.power[z]*pow(1-AGING,day);
+
+    // waiting for the start, the firmware checks the schedule each loop, here each 10s
+    unsigned long dayStart=now,start=0;
+    while (start==0) {
+      double eta[OVEN_ZONES];
+
+      for (int z=0;z<OVEN_ZONES;z++) {
+        actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+        eta[z]=heatup[z].IsValid()?heatup[z].GetEta(actual[z],setTemp[z]):-1;
+      }
+
+      unsigned long lead=(fixedLead<0)?PreheatLead(eta,OVEN_ZONES):(unsigned long) fixedLead;
+      if ((now-dayStart)/1000+MORNING+lead>=READY)
+        start=now;
+      else {
+        for (int s=0;s<100;s++)
+          oven.Step(0.1,off);
+        now+=10000;
+      }
+    }
+
+    PidEngine pid[OVEN_ZONES];
+    double output[OVEN_ZONES]={0,0},ready[OVEN_ZONES]={-1,-1},energy=0;
+    unsigned long readyTime=dayStart+(READY-MORNING)*1000UL;
+
+    for (int z=0;z<OVEN_ZONES;z++) {
+      pid[z].SetTunings(120,1,200);
+      pid[z].SetOutputLimits(0,WINDOW_SIZE);
+      pid[z].SetSampleTime(1000);
+      pid[z].SetAutomatic(true,0,actual[z],0);
+    }
+
+    while (now<readyTime+BAKE*1000UL) {
+      double heater[OVEN_ZONES];
+
+      for (int z=0;z<OVEN_ZONES;z++) {
+        heater[z]=((now%WINDOW_SIZE)<output[z])?1:0;
+        if (heater[z]>0) {
+          heatingMs[z]+=LOOP_MS;
+          if (now<readyTime)
+            energy+=oven.p.power[z]*LOOP_MS/3.6e9;
+        }
+      }
+      oven.Step(LOOP_MS/1000.0,heater);
+      now+=LOOP_MS;
+
+      for (int z=0;z<OVEN_ZONES;z++) {
+        actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+        pid[z].Compute(setTemp[z],actual[z],now,output[z]);
+        heatup[z].Update(actual[z],heatingMs[z],now);
+        if (ready[z]<0 && actual[z]>=setTemp[z]-HEATUP_BAND)
+          ready[z]=now;
+      }
+    }
+
+    double last=fmax(ready[0],ready[1]);
+    double late=(last>readyTime)?(last-readyTime)/60000:0;
+    double idle=(last<readyTime)?(readyTime-last)/60000:0;
+
+    if (print)
+      printf("  day %2d: preheat %5.1f min, late %5.1f min, hot before ready %5.1f min, %.2f kWh\n",
+        day+1,(readyTime-start)/60000.0,late,idle,energy);
+    tot.late+=late;
+    tot.idle+=idle;
+    tot.energy+=energy;
+    if (late>1)
+      tot.lateDays++;
+
+    // the night, the oven is off (the firmware stops updating the curves)
+    for (int s=0;s<24*3600-(READY-MORNING)-BAKE;s++)
+      oven.Step(1,off);
+    now+=(24*3600-(READY-MORNING)-BAKE)*1000UL;
+  }
+
+  return tot;
+}
+
+
+int main() {
+  struct { const char *name; double lead; } strategies[]={
+    { "learned curves", -1 },
+    { "fixed 45 min", 2700 },
+    { "fixed 60 min", 3600 },
+    { "fixed 90 min", 5400 },
+  };
+
+  printf("learned curves:\n");
+  Run(-1,true);
+
+  printf("\n%-16s | %9s %9s | %9s | %10s\n","preheat","late min","late days","hot min","kWh");
+  for (auto &s : strategies) {
+    Totals t=Run(s.lead,false);
+
+    printf("%-16s | %9.1f %9d | %9.1f | %10.2f\n",s.name,t.late,t.lateDays,t.idle,t.energy);
+  }
+
+  return 0;
+}
@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// A full load baked in an oven without the stone heater, the chamber read by its probe alone and by its probe plus
+// the idle stone probe with ProbeVoter, on the oven model with SafetySupervisor watching as in the firmware. At a
+// random time of the bake the chamber probe fails: open circuit, pulled out of the chamber (reading slides towards
+// the ambient), drifting high, or shorted so it reads the cold junction. Over many runs it prints the runs aborted by
+// the supervisor, the share of the bake after the failure with the true chamber temperature within 15C of the set
+// one, and the highest true temperature. The first row has no failure.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon probe_redundancy/probe_redundancy.cpp ../ProbeVoter.cpp ../SafetySupervisor.cpp ../PidEngine.cpp ../LowPassFilter.cpp -o probe_redundancy
+
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "LowPassFilter.h"
+#include "ProbeVoter.h"
+#include "SafetySupervisor.h"
+
+#define WINDOW_SIZE 5000
+#define TICK_MS     100
+#define RUNS        50
+#define PREHEAT     2400000UL  // ms before the bake
+#define BAKE        7200000UL  // ms of the bake
+#define SET_TEMP    300
+#define BAND        15         // C around the set temperature counted as baking
+
+enum Failure { None, Open, PulledOut, DriftHigh, Shorted, FAILURES };
+const char *failureNames[FAILURES]={ "none", "open circuit", "pulled out", "drift high", "shorted (cold junction)" };
+
+
+struct Result {
+  bool aborted;
+  double inBand;  // share of the time after the failure
+  double peak;
+};
+
+
+// a second thermocouple in the chamber: its own lag, a small offset from the other spot and the quantization
+struct SecondProbe {
+  double tau,offset,value;
+
+  double Step(double temp, double dt, double noise) {
+    value+=(temp-value)*dt/(tau+dt);
+    return floor((value+offset+noise)*4+0.5)/4;
+  }
+};
+
+
+Result Run(Failure f, bool dual, unsigned long failMs, unsigned seed) {
+  OvenModelParams params=OvenModelParams::Default();
+  params.noise=0.25;
+  params.power[1]=0;  // no stone heater
+  OvenModel oven(params,seed);
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> gauss(0,0.25);
+  SafetySupervisor supervisor;
+  ProbeVoter voter;
+  PidEngine pid;
+  LowPassFilter filter(0.3);
+  SecondProbe second={ 45, 3, params.ambient };
+  double output=0,raw=params.ambient,actual=filter.GetFilteredValue(raw);
+  unsigned long now=0,inBand=0,after=0;
+  Result r={ false, 0, 0 };
+
+  pid.SetTunings(120,1,200);
+  pid.SetOutputLimits(0,WINDOW_SIZE);
+  pid.SetSampleTime(1000);
+  pid.SetAutomatic(true,0,actual,0);
+  supervisor.Reset(now);
+
+  while (now<PREHEAT+BAKE) {
+    bool on=!supervisor.IsTripped() && (now%WINDOW_SIZE)<output;
+    double heater[OVEN_ZONES]={ on?1.0:0.0, 0 };
+
+    oven.Step(TICK_MS/1000.0,heater);
+    now+=TICK_MS;
+
+    // the probes
+    bool ok1=true,ok2=true;
+    double t1=oven.Measure(0),t2=second.Step(oven.temp[0],TICK_MS/1000.0,gauss(rng));
+
+    if (now>=failMs) {
+      double s=(now-failMs)/1000.0;
+
+      switch (f) {
+        case None: break;
+        case Open: ok1=false; break;
+        case PulledOut: t1-=fmin(s*0.5,t1-params.ambient-30); break;
+        case DriftHigh: t1+=fmin(s*0.1,60); break;
+        case Shorted: t1=25; break;
+        default: break;
+      }
+
+      after++;
+      if (fabs(oven.temp[0]-SET_TEMP)<=BAND)
+        inBand++;
+      r.peak=fmax(r.peak,oven.temp[0]);
+    }
+
+    // the supervisor in the sampling timer, with the zone hotter probe as in SuperviseSample
+    SafetyInput in[OVEN_ZONES]={ { true, ok1, t1, SET_TEMP, on, oven.Word(t1) }, { false, true, 0, 0, false, 0 } };
+    if (dual && ok2) {
+      uint32_t w2=oven.Word(t2);
+
+      in[0].temp=ok1?fmax(t1,t2):t2;
+      in[0].probeOk=true;
+      in[0].word^=(w2<<1)|(w2>>31);
+    }
+    if (supervisor.Check(now,in,OVEN_ZONES))
+      r.aborted=true;
+
+    // the zone temperature in loop()
+    double t;
+    if (!dual) {
+      if (ok1)
+        raw=t1;
+    }
+    else if (voter.Vote(ok1,t1,ok2,t2,t))
+      raw=t;
+    actual=filter.GetFilteredValue(raw);
+    pid.Compute(SET_TEMP,actual,now,output);
+    supervisor.Controlled(now);
+  }
+
+  r.inBand=after?(double) inBand/after:0;
+  return r;
+}
+
+
+int main() {
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> failTime(0,3600);
+
+  printf("%-26s | %-26s | %-26s\n","","single probe","two probes, voted");
+  printf("%-26s | %7s %9s %8s | %7s %9s %8s\n","failure","aborted","in band","peak C","aborted","in band","peak C");
+
+  for (int f=0;f<FAILURES;f++) {
+    int aborted[2]={0,0};
+    double inBand[2]={0,0},peak[2]={0,0};
+
+    for (int run=0;run<RUNS;run++) {
+      unsigned long failMs=PREHEAT+failTime(rng)*1000UL;
+
+      for (int d=0;d<2;d++) {
+        Result r=Run((Failure) f,d==1,failMs,run+1);
+
+        aborted[d]+=r.aborted?1:0;
+        inBand[d]+=r.inBand/RUNS;
+        peak[d]=fmax(peak[d],r.peak);
+      }
+    }
+
+    printf("%-26s | %4d/%-2d %8.0f%% %8.1f | %4d/%-2d %8.0f%% %8.1f\n",failureNames[f],aborted[0],RUNS,inBand[0]*100,peak[0],
+      aborted[1],RUNS,inBand[1]*100,peak[1]);
+  }
+
+  return 0;
+}
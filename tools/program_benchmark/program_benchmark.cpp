@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Preheat of the chamber and of the stone of the oven model with independent pids (the firmware default gains)
+// given a step of the set temperatures, as setparams.cgi does, and driven by a program ramping them at
+// different rates, with and without holdback. The stone program waits for the chamber before its last hold.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon program_benchmark/program_benchmark.cpp ../Program.cpp ../PidEngine.cpp ../LowPassFilter.cpp -o program_benchmark
+
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "LowPassFilter.h"
+#include "Program.h"
+
+#define WINDOW_SIZE 5000
+#define BAND 2.0        // C, tolerance for reaching the set temperature
+#define DURATION 7200   // s
+
+
+struct Result {
+  double rise[OVEN_ZONES];       // s to reach the final set-BAND
+  double overshoot[OVEN_ZONES];  // C above the final set
+  double end;                    // s to the end of the program
+};
+
+
+// rate 0 is the step of setparams.cgi
+Result Run(double chamber, double stone, double rate, double holdback) {
+  OvenModel oven(OvenModelParams::Default());
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> loopPeriod(100,250);
+  PidEngine pid[OVEN_ZONES];
+  LowPassFilter filter[OVEN_ZONES]={LowPassFilter(0.3),LowPassFilter(0.3)};
+  double output[OVEN_ZONES]={0,0},actual[OVEN_ZONES],set[OVEN_ZONES]={chamber,stone};
+  Result r={{-1,-1},{0,0},-1};
+  unsigned long now=1000;
+
+  Program p;
+  strcpy(p.name,"bench");
+  p.holdback=holdback;
+  p.turnOff=false;
+  p.numSegments=2;
+  p.segments[0]=ProgramSegment{0,chamber,rate,600,-1,0};
+  p.segments[1]=ProgramSegment{1,stone,rate,600,0,BAND};
+
+  for (int z=0;z<OVEN_ZONES;z++) {
+    actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+    pid[z].SetTunings(120,1,200);
+    pid[z].SetOutputLimits(0,WINDOW_SIZE);
+    pid[z].SetSampleTime(1000);
+    pid[z].SetAutomatic(true,0,actual[z],0);
+  }
+
+  ProgramRunner runner;
+  if (rate>0)
+    runner.Start(p,OVEN_ZONES,actual,set,now);
+
+  while (now<DURATION*1000UL) {
+    unsigned long dt=loopPeriod(rng);
+    double heater[OVEN_ZONES];
+
+    for (int z=0;z<OVEN_ZONES;z++)
+      heater[z]=((now%WINDOW_SIZE)<output[z])?1:0;
+    for (unsigned long t=0;t<dt;t+=100)
+      oven.Step(0.1,heater);
+    now+=dt;
+
+    for (int z=0;z<OVEN_ZONES;z++)
+      actual[z]=filter[z].GetFilteredValue(oven.Measure(z));
+    if (runner.Update(actual,set,now))
+      r.end=now/1000.0;
+
+    for (int z=0;z<OVEN_ZONES;z++) {
+      double final=(z==0)?chamber:stone;
+
+      pid[z].Compute(set[z],actual[z],now,output[z]);
+      if (r.rise[z]<0 && oven.temp[z]>=final-BAND)
+        r.rise[z]=now/1000.0;
+      if (oven.temp[z]-final>r.overshoot[z])
+        r.overshoot[z]=oven.temp[z]-final;
+    }
+  }
+
+  return r;
+}
+
+
+int main() {
+  double sets[][2]={ {250,250}, {300,320} };
+  struct { const char *name; double rate,holdback; } modes[]={
+    { "step (setparams)", 0, 0 },
+    { "ramp 10C/min", 10, 0 },
+    { "ramp 5C/min", 5, 0 },
+    { "ramp 10C/min hb 10", 10, 10 },
+    { "ramp 20C/min hb 10", 20, 10 },
+  };
+
+  for (auto &s : sets) {
+    printf("\nChamber to %.0fC, stone to %.0fC\n",s[0],s[1]);
+    printf("%-22s | %8s %8s | %8s %8s | %8s\n","set temperatures","ch. rise","over C","st. rise","over C","end s");
+    for (auto &m : modes) {
+      Result r=Run(s[0],s[1],m.rate,m.holdback);
+
+      printf("%-22s | %8.0f %8.1f | %8.0f %8.1f | %8.0f\n",m.name,r.rise[0],r.overshoot[0],r.rise[1],r.overshoot[1],r.end);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Share of the time the heaters are on with the time proportioning of RelayScheduler for steady demands, including
+// the ones below the minimum on time (delivered every few windows through the carry) and above the window less the
+// minimum off time, with a single channel and with two channels under a power budget. Update is called as by loop(),
+// every 20-40ms. It prints the demanded and delivered share and the relay switches per hour, and exits with 1 if any
+// delivered share is off by more than DUTY_TOLERANCE.
+//
+// g++ -O2 -std=c++11 -DARDUINO=100 -I.. -Icommon relay_scheduler/relay_scheduler.cpp ../RelayScheduler.cpp -o relay_scheduler
+
+#include <stdio.h>
+#include <random>
+#include "RelayScheduler.h"
+
+#define WINDOW          5000
+#define MIN_ON          500
+#define MIN_OFF         500
+#define HOURS           1
+#define DUTY_TOLERANCE  0.005
+
+unsigned long hostMillis=0;
+
+static int pins[MAX_ZONES];
+
+
+void ActionPinMode(int pin) {
+}
+
+
+int ActionRead(int pin) {
+  return pins[pin];
+}
+
+
+void ActionWrite(int pin, int value) {
+  pins[pin]=value;
+}
+
+
+// runs the channels with steady demands and returns the delivered shares and the switches per hour of the first one
+static bool Run(const double *demands, const double *powers, int channels, double budget, double *share, double *switches) {
+  RelayScheduler scheduler;
+  IControlAction *actions[MAX_ZONES];
+  unsigned long onMs[MAX_ZONES],changes=0;
+  unsigned long duration=HOURS*3600000UL;
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> period(20,40);
+  bool ok=true;
+
+  hostMillis=1000;
+  scheduler.Begin(WINDOW,MIN_ON,MIN_OFF,budget);
+  for (int i=0;i<channels;i++) {
+    pins[i]=LOW;
+    actions[i]=new IControlAction(i,false);
+    scheduler.Attach(i,actions[i],powers[i]);
+    scheduler.SetDemand(i,demands[i]);
+    onMs[i]=0;
+  }
+
+  unsigned long start=hostMillis;
+  int last=pins[0];
+
+  while (hostMillis-start<duration) {
+    unsigned long dt=period(rng);
+    double power=0;
+
+    scheduler.Update(true);
+    if (pins[0]!=last)
+      changes++;
+    last=pins[0];
+
+    for (int i=0;i<channels;i++)
+      if (pins[i]==HIGH) {
+        onMs[i]+=dt;
+        power+=powers[i];
+      }
+
+    if (budget>0 && power>budget)
+      ok=false;
+
+    hostMillis+=dt;
+  }
+
+  for (int i=0;i<channels;i++) {
+    share[i]=(double) onMs[i]/(hostMillis-start);
+    delete actions[i];
+  }
+  *switches=changes/(double) HOURS;
+
+  return ok;
+}
+
+
+int main() {
+  const double demands[]={ 0.01, 0.04, 0.08, 0.1, 0.25, 0.5, 0.9, 0.95, 0.98 };
+  bool ok=true;
+
+  printf("window %dms, min on %dms, min off %dms, %d hour\n\n",WINDOW,MIN_ON,MIN_OFF,HOURS);
+  printf("%-8s %10s %10s %10s\n","demand","delivered","error","switch/h");
+
+  for (double d : demands) {
+    double power=1000,share,switches;
+
+    Run(&d,&power,1,0,&share,&switches);
+
+    bool pass=fabs(share-d)<=DUTY_TOLERANCE;
+    ok=ok && pass;
+    printf("%-8.2f %9.2f%% %9.2f%% %10.0f%s\n",d,share*100,(share-d)*100,switches,pass?"":"  FAILED");
+  }
+
+  // two 1000W heaters at 80% under a 1000W budget: the average power is scaled down to the budget and the heaters
+  // are never on together
+  const double budgetDemands[]={ 0.8, 0.8 },budgetPowers[]={ 1000, 1000 };
+  double shares[2],switches;
+  bool budgetOk=Run(budgetDemands,budgetPowers,2,1000,shares,&switches);
+  bool pass=budgetOk && fabs(shares[0]-0.5)<=DUTY_TOLERANCE*2 && fabs(shares[1]-0.5)<=DUTY_TOLERANCE*2;
+
+  ok=ok && pass;
+  printf("\nbudget 1000W, two 1000W heaters at 80%%: delivered %.2f%% and %.2f%%, budget %s%s\n",shares[0]*100,
+    shares[1]*100,budgetOk?"respected":"exceeded",pass?"":"  FAILED");
+
+  printf("\n%s\n",ok?"all shares within tolerance":"FAILED");
+  return ok?0:1;
+}
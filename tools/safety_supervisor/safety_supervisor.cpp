@@ -0,0 +1,233 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Worst case latency of SafetySupervisor on the oven model: the chamber and the stone are preheated to 300 and 280C
+// by their pids with the relay time proportioning and baked at the set temperatures, with the probes sampled every
+// 100ms as by ProbeSampler. At a random time during the bake a fault is injected and the time until the supervisor
+// trips (the sampling timer switches the heaters off in the same tick) is measured over many runs, with the highest
+// true temperature of the zone after the fault (a stuck probe returns the same raw word from the fault on). Two
+// last sets of runs without faults count the false trips: one with the door opened during the bake and after the
+// oven is stopped, one with quiet probes (no noise on the thermocouples nor on the cold junctions) whose words stay
+// the same for minutes at the steady hold. The peak is over all the runs, tripped or not.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon safety_supervisor/safety_supervisor.cpp ../SafetySupervisor.cpp ../PidEngine.cpp ../LowPassFilter.cpp -o safety_supervisor
+
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "LowPassFilter.h"
+#include "SafetySupervisor.h"
+
+#define WINDOW_SIZE 5000
+#define TICK_MS     100
+#define RUNS        50
+#define PREHEAT     3600000UL  // ms before the bake
+#define AFTER       3600000UL  // ms of simulation after the fault
+
+enum Fault { None, ProbeOpen, ProbeStuck, WeldedRunning, WeldedStopped, HeaterBroken, LoopStall, TimerStopped, FAULTS };
+
+const char *faultNames[FAULTS]={ "none", "probe open", "probe stuck", "relay welded, running", "relay welded, stopped", "heater broken", "loop stalled", "timer stopped" };
+const double setTemp[OVEN_ZONES]={ 300, 280 };
+
+
+struct Result {
+  bool tripped;
+  SafetyFault fault;
+  double latency;  // s from the fault to the trip
+  double peak;     // highest true temperature of the faulty zone after the fault
+};
+
+
+// fault on the chamber (zone 0) at faultMs, -1 none; with doors the door is opened now and then, quiet probes have
+// no noise
+Result Run(Fault f, unsigned long faultMs, bool doors, bool quiet, unsigned seed) {
+  OvenModelParams params=OvenModelParams::Default();
+  params.noise=quiet?0:0.25;
+  if (quiet)
+    params.cjNoise=0;
+  OvenModel oven(params,seed);
+  SafetySupervisor supervisor;
+  PidEngine pid[OVEN_ZONES];
+  LowPassFilter filter[OVEN_ZONES]={LowPassFilter(0.3),LowPassFilter(0.3)};
+  double output[OVEN_ZONES]={0,0},actual[OVEN_ZONES],raw[OVEN_ZONES];
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> doorGap(600,1800),doorLength(10,40);
+  unsigned long now=0,stop=faultMs+AFTER,door=PREHEAT+doorGap(rng)*1000UL,doorEnd=0;
+  bool started=true,faulty=false;
+  double stuck=0;
+  uint32_t stuckWord=0;
+  Result r={ false, SafetyFault::None, 0, 0 };
+
+  for (int z=0;z<OVEN_ZONES;z++) {
+    raw[z]=oven.Measure(z);
+    actual[z]=filter[z].GetFilteredValue(raw[z]);
+    pid[z].SetTunings(120,1,200);
+    pid[z].SetOutputLimits(0,WINDOW_SIZE);
+    pid[z].SetSampleTime(1000);
+    pid[z].SetAutomatic(true,0,actual[z],0);
+  }
+  supervisor.Reset(now);
+
+  while (now<stop) {
+    double heater[OVEN_ZONES];
+    bool commanded[OVEN_ZONES];
+
+    if (!faulty && now>=faultMs) {
+      faulty=true;
+      if (f==HeaterBroken)
+        oven.p.power[0]=0;
+      if (f==WeldedStopped)
+        started=false;
+    }
+
+    // without faults the oven is stopped half way and cools with the door opened now and then
+    if (f==None && now>=faultMs)
+      started=false;
+    if (doors && now>=door) {
+      oven.disturbance[0]=1500;
+      doorEnd=now+doorLength(rng)*1000UL;
+      door=now+doorGap(rng)*1000UL;
+    }
+    if (now>=doorEnd)
+      oven.disturbance[0]=0;
+
+    for (int z=0;z<OVEN_ZONES;z++) {
+      commanded[z]=started && !supervisor.IsTripped() && (now%WINDOW_SIZE)<output[z];
+      heater[z]=commanded[z]?1:0;
+    }
+    // a welded relay heats whatever the command
+    if (faulty && (f==WeldedRunning || f==WeldedStopped))
+      heater[0]=1;
+
+    oven.Step(TICK_MS/1000.0,heater);
+    now+=TICK_MS;
+    if (faulty && oven.temp[0]>r.peak)
+      r.peak=oven.temp[0];
+
+    // the tick of the sampling timer, with the supervisor
+    SafetyInput in[OVEN_ZONES];
+    for (int z=0;z<OVEN_ZONES;z++) {
+      in[z].enabled=true;
+      in[z].probeOk=true;
+      in[z].temp=oven.Measure(z);
+      in[z].set=setTemp[z];
+      in[z].heating=commanded[z];
+      in[z].word=oven.Word(in[z].temp);
+    }
+    if (faulty && f==ProbeOpen)
+      in[0].probeOk=false;
+    // the converter returns the same word from the fault on
+    if (faulty && f==ProbeStuck) {
+      if (stuckWord==0) {
+        stuck=in[0].temp;
+        stuckWord=in[0].word;
+      }
+      in[0].temp=stuck;
+      in[0].word=stuckWord;
+    }
+
+    if (!(faulty && f==TimerStopped) && supervisor.Check(now,in,OVEN_ZONES) && !r.tripped) {
+      r.tripped=true;
+      r.fault=supervisor.GetFault();
+      r.latency=(now-(faulty?faultMs:0))/1000.0;
+      if (!faulty)
+        return r;
+    }
+
+    // loop(): the controls of the sample, unless stalled or with no sample
+    if (faulty && (f==LoopStall || f==TimerStopped)) {
+      if (supervisor.CheckSamples(now) && !r.tripped) {
+        r.tripped=true;
+        r.fault=supervisor.GetFault();
+        r.latency=(now-faultMs)/1000.0;
+      }
+      continue;
+    }
+
+    for (int z=0;z<OVEN_ZONES;z++) {
+      // a probe fault keeps the last valid temperature
+      if (in[z].probeOk)
+        raw[z]=in[z].temp;
+      actual[z]=filter[z].GetFilteredValue(raw[z]);
+      pid[z].Compute(setTemp[z],actual[z],now,output[z]);
+    }
+    supervisor.Controlled(now);
+
+    if (r.tripped && now-r.latency*1000>faultMs+60000)
+      break;
+  }
+
+  return r;
+}
+
+
+int main() {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> faultTime(0,3600);
+
+  printf("%-24s %6s %-14s %9s %9s %9s %9s\n","fault","trips","as","min s","mean s","max s","peak C");
+  for (int f=ProbeOpen;f<FAULTS;f++) {
+    double minLatency=1e9,maxLatency=0,sum=0,peak=0;
+    int trips=0;
+    SafetyFault as=SafetyFault::None;
+
+    for (int run=0;run<RUNS;run++) {
+      Result r=Run((Fault) f,PREHEAT+faultTime(rng)*1000UL,false,false,run+1);
+
+      peak=fmax(peak,r.peak);
+      if (!r.tripped)
+        continue;
+      trips++;
+      as=r.fault;
+      minLatency=fmin(minLatency,r.latency);
+      maxLatency=fmax(maxLatency,r.latency);
+      sum+=r.latency;
+    }
+
+    printf("%-24s %3d/%-2d %-14s %9.1f %9.1f %9.1f %9.1f\n",faultNames[f],trips,RUNS,SafetySupervisor::GetFaultName(as),
+      trips?minLatency:0,trips?sum/trips:0,maxLatency,peak);
+  }
+
+  int falseTrips=0,quietTrips=0;
+  for (int run=0;run<RUNS;run++) {
+    Result r=Run(None,PREHEAT+faultTime(rng)*1000UL,true,false,run+100);
+
+    if (r.tripped) {
+      falseTrips++;
+      printf("false trip: run %d %s at %.0fs\n",run,SafetySupervisor::GetFaultName(r.fault),r.latency);
+    }
+  }
+  for (int run=0;run<RUNS;run++) {
+    Result r=Run(None,PREHEAT+faultTime(rng)*1000UL,false,true,run+200);
+
+    if (r.tripped) {
+      quietTrips++;
+      printf("false trip, quiet probes: run %d %s at %.0fs\n",run,SafetySupervisor::GetFaultName(r.fault),r.latency);
+    }
+  }
+  printf("\nno fault, door openings, stop and cool down: %d false trips in %d runs\n",falseTrips,RUNS);
+  printf("no fault, quiet probes, steady hold: %d false trips in %d runs\n",quietTrips,RUNS);
+
+  return 0;
+}
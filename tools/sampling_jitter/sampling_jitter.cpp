@@ -0,0 +1,241 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Period of the probe samples with the previous loop() cadence (sample, control, network, delay(100)) and with the
+// ProbeSampler timer posting samples to loop() through SampleQueue, on a model of the cooperative scheduling of the
+// esp8266: loop() runs stretches of code that don't yield (serial logging, json, flash writes) separated by yields
+// (delay, network writes waiting for the acks), and the callback of the sdk timer runs only at a yield, as soon as
+// it is due. The web page is open (getsensordata.cgi every second, getschedules.cgi every minute), a page is loaded
+// every 5 minutes and the configuration saved every 10. A second test checks SampleQueue with two threads.
+//
+// g++ -O2 -std=c++11 -pthread -I.. -Icommon sampling_jitter/sampling_jitter.cpp -o sampling_jitter
+
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "SampleQueue.h"
+
+#define PERIOD_US   100000UL    // SAMPLE_PERIOD
+#define HOURS       4
+#define CONTROL_US  60000UL     // a control tick of two zones: about 700 characters of log at 115200 baud
+#define LOOP_US     1000UL      // rest of loop(): heap monitor, schedules, polling the server
+#define STRESS      1000000UL   // items of the threaded test
+
+
+// a stretch of code of loop(), yielding at its end
+struct Chunk {
+  unsigned long us;
+};
+
+
+// the http requests served by one call of handleHttpRequests (one client at a time)
+class Workload {
+public:
+  Workload(unsigned int seed) : rng(seed), nextSensor(0), nextSchedules(0), nextPage(60000000UL), nextSave(120000000UL) { }
+
+  // chunks of the request due at now, if any
+  void Request(unsigned long now, std::vector<Chunk> &chunks) {
+    std::uniform_int_distribution<int> jitter(0,20000);
+
+    if (now>=nextSave) {
+      // config.html, then setconf.cgi writing a slot of the configuration to the flash
+      File(14500,chunks);
+      chunks.push_back({ 12000 });
+      chunks.push_back({ 30000 });
+      nextSave+=600000000UL;
+    }
+    else if (now>=nextPage) {
+      File(6600,chunks);
+      nextPage+=300000000UL;
+    }
+    else if (now>=nextSchedules) {
+      chunks.push_back({ 6000 });
+      chunks.push_back({ 2000 });
+      nextSchedules+=60000000UL;
+    }
+    else if (now>=nextSensor) {
+      // json of the zones and its write
+      chunks.push_back({ 9000 });
+      chunks.push_back({ 3000 });
+      nextSensor=now+1000000UL+jitter(rng);
+    }
+  }
+
+protected:
+  std::mt19937 rng;
+  unsigned long nextSensor,nextSchedules,nextPage,nextSave;
+
+  // chunks of HTTP_BODY_SIZE from spiffs, each write waits for the ack of the browser
+  void File(int len, std::vector<Chunk> &chunks) {
+    std::uniform_int_distribution<int> ack(15000,60000);
+
+    for (int sent=0;sent<len;sent+=4096) {
+      chunks.push_back({ 2000 });
+      chunks.push_back({ (unsigned long) ack(rng) });
+    }
+  }
+};
+
+
+struct Stats {
+  std::vector<double> values;  // ms
+
+  void Add(double ms) {
+    values.push_back(ms);
+  }
+
+  void Print(const char *name) {
+    std::vector<double> v=values;
+    double sum=0,sumSq=0;
+
+    std::sort(v.begin(),v.end());
+    for (double x : v) {
+      sum+=x;
+      sumSq+=x*x;
+    }
+    double mean=sum/v.size();
+
+    printf("%-32s %8.1f %8.2f %8.1f %8.1f %8.1f %8.1f\n",name,mean,sqrt(std::max(sumSq/v.size()-mean*mean,0.0)),v.front(),
+      v[v.size()*99/100],v[v.size()*999/1000],v.back());
+  }
+};
+
+
+// previous firmware: the probes are read at the start of the control tick of each loop()
+void RunLoop(Stats &period) {
+  Workload work(1);
+  std::vector<Chunk> chunks;
+  unsigned long now=0,last=0;
+
+  while (now<HOURS*3600000000UL) {
+    if (last!=0)
+      period.Add((now-last)/1000.0);
+    last=now;
+    now+=CONTROL_US+LOOP_US;
+
+    chunks.clear();
+    work.Request(now,chunks);
+    for (Chunk &c : chunks)
+      now+=c.us;
+
+    now+=100000;  // delay(100)
+  }
+}
+
+
+struct Sample {
+  unsigned long us;
+};
+
+
+// timer: the callbacks due run at every yield, loop() controls the samples queued
+void RunTimer(Stats &period, Stats &latency, unsigned long &overruns) {
+  Workload work(1);
+  SampleQueue<Sample,16> queue;
+  std::vector<Chunk> chunks;
+  unsigned long now=0,due=PERIOD_US,last=0;
+
+  auto yield=[&](unsigned long until) {
+    // the time goes on in the chunk, the timer fires at its end or during a delay
+    while (due<=until) {
+      unsigned long fire=std::max(due,now);
+
+      if (last!=0)
+        period.Add((fire-last)/1000.0);
+      last=fire;
+      queue.Push({ fire });
+      due+=PERIOD_US;
+    }
+    now=until;
+  };
+
+  while (now<HOURS*3600000000UL) {
+    chunks.clear();
+    chunks.push_back({ LOOP_US });
+    work.Request(now,chunks);
+    for (Chunk &c : chunks) {
+      now+=c.us;
+      yield(now);
+    }
+
+    Sample s;
+    while (queue.Pop(s)) {
+      now+=CONTROL_US;
+      latency.Add((now-s.us)/1000.0);  // the decision is taken once the tick has been logged
+      yield(now);
+    }
+
+    // delay(10): the timer can fire any time in it
+    yield(now+10000);
+  }
+  overruns=queue.GetOverruns();
+}
+
+
+// a producer thread and a consumer thread pushing and popping a sequence, the consumer checks it's in order
+bool Stress() {
+  static SampleQueue<unsigned long,16> queue;
+  unsigned long expected=0,value;
+  bool ok=true;
+
+  std::thread producer([]() {
+    for (unsigned long i=0;i<STRESS;)
+      if (queue.Push(i))
+        i++;
+      else
+        std::this_thread::yield();
+  });
+
+  while (expected<STRESS)
+    if (queue.Pop(value)) {
+      ok=ok && value==expected;
+      expected++;
+    }
+    else
+      std::this_thread::yield();
+
+  producer.join();
+  return ok;
+}
+
+
+int main() {
+  Stats loopPeriod,timerPeriod,timerLatency;
+  unsigned long overruns;
+
+  RunLoop(loopPeriod);
+  RunTimer(timerPeriod,timerLatency,overruns);
+
+  printf("%d hours, web page open, ms:\n\n",HOURS);
+  printf("%-32s %8s %8s %8s %8s %8s %8s\n","","mean","std","min","p99","p99.9","max");
+  loopPeriod.Print("loop+delay(100) sample period");
+  timerPeriod.Print("timer sample period");
+  timerLatency.Print("timer sample to control");
+  printf("\ntimer samples %zu (%.1f/s), loop samples %zu (%.1f/s), queue overruns %lu\n",timerPeriod.values.size()+1,
+    (timerPeriod.values.size()+1)/(HOURS*3600.0),loopPeriod.values.size()+1,(loopPeriod.values.size()+1)/(HOURS*3600.0),overruns);
+
+  printf("SampleQueue two threads, %lu items: %s\n",STRESS,Stress()?"in order":"FAILED");
+  return 0;
+}
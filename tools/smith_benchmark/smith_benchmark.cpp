@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Stone zone (heated by its own element, chamber off) on the oven model: preheat to 250C and a step to 280C
+// with PidEngine alone and with the SmithPredictor of PidControl, for moderate and tight gains and with model
+// errors. The first order plus dead time model of the stone comes from a step response of the oven model
+// around 250C (gain 370C, tau 3150s, dead time 100s including the thermocouple lag).
+//
+// g++ -O2 -std=c++11 -I.. -Icommon smith_benchmark/smith_benchmark.cpp ../PidEngine.cpp ../SmithPredictor.cpp ../FopdtModel.cpp ../LowPassFilter.cpp -o smith_benchmark
+
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include "OvenModel.h"
+#include "PidEngine.h"
+#include "SmithPredictor.h"
+#include "LowPassFilter.h"
+
+#define WINDOW_SIZE 5000
+#define BAND 2.0        // C, tolerance for reaching and settling
+#define ZONE 1          // stone
+
+
+struct Result {
+  double rise;       // s to reach set-BAND
+  double overshoot;  // C above set after the rise
+  double settling;   // s after which the temperature stays within BAND
+  double ripple;     // peak to peak in the last 30 minutes, C
+};
+
+
+// same logic of PidControl::Control
+struct Controller {
+  PidEngine pid;
+  SmithPredictor smith;
+  double demand;
+
+  Controller(double kp, double ki, double kd, const FopdtModel *model) {
+    pid.SetTunings(kp,ki,kd);
+    pid.SetOutputLimits(0,WINDOW_SIZE);
+    pid.SetSampleTime(1000);
+    if (model)
+      smith.SetModel(*model);
+    demand=0;
+  }
+  void Start(double in, unsigned long now) {
+    smith.Reset();
+    pid.SetAutomatic(true,0,in,0);
+  }
+  void Compute(double set, double in, unsigned long now, double &out) {
+    smith.Update(demand,now);
+    pid.Compute(set,in+smith.GetCorrection(),now,out);
+    demand=out/WINDOW_SIZE;
+  }
+};
+
+
+Result Run(OvenModel &oven, Controller &c, LowPassFilter &filter, double set, double duration, unsigned long &now, std::mt19937 &rng) {
+  std::uniform_int_distribution<int> loopPeriod(100,250);
+  Result r={-1,0,0,0};
+  double output=0,rippleMin=1e9,rippleMax=-1e9;
+  double start=now/1000.0;
+
+  while (now/1000.0-start<duration) {
+    unsigned long dt=loopPeriod(rng);
+    double heater[OVEN_ZONES]={0,0};
+
+    heater[ZONE]=((now%WINDOW_SIZE)<output)?1:0;
+    for (unsigned long t=0;t<dt;t+=100)
+      oven.Step(0.1,heater);
+    now+=dt;
+
+    c.Compute(set,filter.GetFilteredValue(oven.Measure(ZONE)),now,output);
+
+    double elapsed=now/1000.0-start;
+    double temp=oven.temp[ZONE];
+
+    if (r.rise<0 && temp>=set-BAND)
+      r.rise=elapsed;
+    if (r.rise>=0 && temp-set>r.overshoot)
+      r.overshoot=temp-set;
+    if (fabs(temp-set)>BAND)
+      r.settling=elapsed;
+    if (elapsed>duration-1800) {
+      rippleMin=fmin(rippleMin,temp);
+      rippleMax=fmax(rippleMax,temp);
+    }
+  }
+
+  r.ripple=rippleMax-rippleMin;
+  return r;
+}
+
+
+void Benchmark(const char *name, double kp, double ki, double kd, const FopdtModel *model) {
+  OvenModel oven(OvenModelParams::Default());
+  LowPassFilter filter(0.3);
+  std::mt19937 rng(42);
+  unsigned long now=1000;
+  Controller c(kp,ki,kd,model);
+
+  c.Start(filter.GetFilteredValue(oven.Measure(ZONE)),now);
+  Result preheat=Run(oven,c,filter,250,3*3600,now,rng);
+  Result step=Run(oven,c,filter,280,2*3600,now,rng);
+
+  printf("%-34s | %6.0f %6.1f %6.0f %6.1f | %6.0f %6.1f %6.0f %6.1f\n",name,
+    preheat.rise,preheat.overshoot,preheat.settling,preheat.ripple,step.rise,step.overshoot,step.settling,step.ripple);
+}
+
+
+int main() {
+  FopdtModel model={370,3150,100};
+
+  printf("%-34s | %-27s | %-27s\n","","preheat 20->250C (3 h)","step 250->280C (2 h)");
+  printf("%-34s | %6s %6s %6s %6s | %6s %6s %6s %6s\n","controller (kp/ki/kd)","rise s","over C","settl","ripple","rise s","over C","settl","ripple");
+
+  Benchmark("pid 200/0.3/0",200,0.3,0,NULL);
+  Benchmark("pid 800/1/0",800,1,0,NULL);
+  Benchmark("smith 800/1/0",800,1,0,&model);
+  Benchmark("pid 800/10/0",800,10,0,NULL);
+  Benchmark("smith 800/10/0",800,10,0,&model);
+  Benchmark("pid 2000/3/0",2000,3,0,NULL);
+  Benchmark("smith 2000/3/0",2000,3,0,&model);
+
+  // model errors
+  FopdtModel errors[]={ {370,3150,150}, {370,3150,50}, {260,3150,100}, {480,3150,100}, {370,2200,100} };
+  for (FopdtModel &m : errors) {
+    char name[64];
+    snprintf(name,sizeof(name),"smith 800/10/0 model %g/%g/%g",m.gain,m.tau,m.deadTime);
+    Benchmark(name,800,10,0,&m);
+  }
+
+  return 0;
+}
@@ -0,0 +1,406 @@
+/*******************************************************************************
+ * Copyright (c) 2017 Federico Di Marco <fededim@gmail.com>                    *
+ *                                                                             *
+ * Permission is hereby granted, free of charge, to any person obtaining a     *
+ * copy of this software and associated documentation files (the "Software"),  *
+ * to deal in the Software without restriction, including without limitation   *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,    *
+ * and/or sell copies of the Software, and to permit persons to whom the       *
+ * Software is furnished to do so, subject to the following conditions:        *
+ *                                                                             *
+ * The above copyright notice and this permission notice shall be included in  *
+ * all copies or substantial portions of the Software.                         *
+ *                                                                             *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR  *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,    *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER      *
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER         *
+ * DEALINGS IN THE SOFTWARE.                                                   *
+ *******************************************************************************/
+
+// Offline identification of the oven from logged traces. Reads the TRACE lines printed by the firmware on the
+// serial port (TRACE,millis,temp0,heating0,temp1,heating1,...), other lines are ignored, so a capture of the
+// serial monitor during any cook can be used as it is. The trace is averaged on a step of a few seconds and
+//  - for each zone fits y(k+1)=a*y(k)+b*u(k-d)+c by least squares for each dead time d, keeping the best one,
+//    and converts it to a first order plus dead time model (gain, tau, dead time), then prints the pid gains
+//    of the tuning rules of FopdtModel and the SmithPredictor parameters
+//  - with -c fits the coupled model of the zones, y_i(k+1)=sum_j(a_ij*y_j(k))+b_i*u_i(k-d_i)+c_i, and prints
+//    the parameters of MpcEngine
+// The fit is validated by the free run simulation of the model on the whole trace (rms error).
+// --synth writes a trace of the oven model with random heater duties, to try the tool without an oven.
+//
+// g++ -O2 -std=c++11 -I.. -Icommon sysid/sysid.cpp ../FopdtModel.cpp -o sysid
+// ./sysid [-t step_s] [-d max_dead_time_s] [-w window_ms] [-c] trace.log
+// ./sysid --synth trace.log [hours]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include "FopdtModel.h"
+#include "OvenModel.h"
+
+#define MAX_ZONES 4
+#define MAX_PARAMS (MAX_ZONES+2)
+
+
+struct Sample {
+  double t;                 // s
+  double temp[MAX_ZONES];
+  double duty[MAX_ZONES];   // relay state 0/1 or duty
+};
+
+
+struct Trace {
+  int zones;
+  std::vector<Sample> samples;
+};
+
+
+bool ReadTrace(const char *path, Trace &trace) {
+  FILE *f=fopen(path,"r");
+  char line[512];
+
+  if (!f)
+    return false;
+
+  trace.zones=0;
+  while (fgets(line,sizeof(line),f)) {
+    char *p=strstr(line,"TRACE,");
+    double v[1+2*MAX_ZONES];
+    int n=0;
+
+    if (!p)
+      continue;
+
+    for (p=strtok(p+6,",\r\n");p && n<1+2*MAX_ZONES;p=strtok(NULL,",\r\n"))
+      v[n++]=atof(p);
+
+    if (n<3 || (n-1)%2!=0)
+      continue;
+    if (trace.zones==0)
+      trace.zones=(n-1)/2;
+    if ((n-1)/2!=trace.zones)
+      continue;
+
+    Sample s;
+    s.t=v[0]/1000;
+    for (int z=0;z<trace.zones;z++) {
+      s.temp[z]=v[1+2*z];
+      s.duty[z]=v[2+2*z];
+    }
+    trace.samples.push_back(s);
+  }
+
+  fclose(f);
+  return trace.samples.size()>0;
+}
+
+
+// averages of the samples in each step, a step without samples (gap in the log) repeats the previous one
+std::vector<Sample> Resample(const Trace &trace, double step) {
+  std::vector<Sample> out;
+  double t0=trace.samples[0].t;
+  size_t i=0;
+
+  while (i<trace.samples.size()) {
+    Sample s={0,{0},{0}};
+    int n=0;
+    double end=t0+(out.size()+1)*step;
+
+    for (;i<trace.samples.size() && trace.samples[i].t<end;i++,n++)
+      for (int z=0;z<trace.zones;z++) {
+        s.temp[z]+=trace.samples[i].temp[z];
+        s.duty[z]+=trace.samples[i].duty[z];
+      }
+
+    s.t=end-step;
+    if (n>0)
+      for (int z=0;z<trace.zones;z++) {
+        s.temp[z]/=n;
+        s.duty[z]/=n;
+      }
+    else if (!out.empty())
+      s=out.back(),s.t=end-step;
+    else
+      break;
+
+    out.push_back(s);
+  }
+
+  return out;
+}
+
+
+// least squares by the normal equations and gaussian elimination, returns the rms residual (-1 if singular)
+double LeastSquares(const std::vector<std::vector<double> > &X, const std::vector<double> &y, int n, double *theta) {
+  double M[MAX_PARAMS][MAX_PARAMS+1];
+
+  for (int i=0;i<n;i++)
+    for (int j=0;j<=n;j++)
+      M[i][j]=0;
+
+  for (size_t k=0;k<y.size();k++)
+    for (int i=0;i<n;i++) {
+      for (int j=0;j<n;j++)
+        M[i][j]+=X[k][i]*X[k][j];
+      M[i][n]+=X[k][i]*y[k];
+    }
+
+  for (int c=0;c<n;c++) {
+    int pivot=c;
+    for (int r=c+1;r<n;r++)
+      if (fabs(M[r][c])>fabs(M[pivot][c]))
+        pivot=r;
+    if (fabs(M[pivot][c])<1e-12)
+      return -1;
+    for (int j=0;j<=n;j++) {
+      double t=M[c][j];
+      M[c][j]=M[pivot][j];
+      M[pivot][j]=t;
+    }
+    for (int r=0;r<n;r++)
+      if (r!=c) {
+        double f=M[r][c]/M[c][c];
+        for (int j=c;j<=n;j++)
+          M[r][j]-=f*M[c][j];
+      }
+  }
+
+  for (int i=0;i<n;i++)
+    theta[i]=M[i][n]/M[i][i];
+
+  double sum=0;
+  for (size_t k=0;k<y.size();k++) {
+    double e=y[k];
+    for (int i=0;i<n;i++)
+      e-=X[k][i]*theta[i];
+    sum+=e*e;
+  }
+
+  return sqrt(sum/y.size());
+}
+
+
+// arx model of zone z: y_z(k+1)=sum over the regressor zones of a_j*y_j(k)+b*u_z(k-d)+c
+struct ArxFit {
+  int delay;          // steps
+  double a[MAX_ZONES],b,c;
+  double rms;         // one step ahead residual
+};
+
+
+ArxFit FitZone(const std::vector<Sample> &s, int zones, int z, bool coupled, int maxDelay) {
+  ArxFit best;
+  best.rms=-1;
+
+  for (int d=0;d<=maxDelay;d++) {
+    std::vector<std::vector<double> > X;
+    std::vector<double> y;
+    double theta[MAX_PARAMS];
+    int n=coupled?zones+2:3;
+
+    for (size_t k=maxDelay;k+1<s.size();k++) {
+      std::vector<double> row;
+
+      if (coupled)
+        for (int j=0;j<zones;j++)
+          row.push_back(s[k].temp[j]);
+      else
+        row.push_back(s[k].temp[z]);
+      row.push_back(s[k-d].duty[z]);
+      row.push_back(1);
+      X.push_back(row);
+      y.push_back(s[k+1].temp[z]);
+    }
+
+    double rms=LeastSquares(X,y,n,theta);
+    if (rms<0 || (best.rms>=0 && rms>=best.rms))
+      continue;
+
+    best.rms=rms;
+    best.delay=d;
+    for (int j=0;j<MAX_ZONES;j++)
+      best.a[j]=0;
+    if (coupled)
+      for (int j=0;j<zones;j++)
+        best.a[j]=theta[j];
+    else
+      best.a[z]=theta[0];
+    best.b=theta[n-2];
+    best.c=theta[n-1];
+  }
+
+  return best;
+}
+
+
+// rms error of the free run simulation of the fitted models on the whole trace
+double Validate(const std::vector<Sample> &s, int zones, const ArxFit *fits, int z) {
+  std::vector<Sample> sim(s);
+  double sum=0;
+  int maxDelay=0;
+
+  for (int j=0;j<zones;j++)
+    if (fits[j].delay>maxDelay)
+      maxDelay=fits[j].delay;
+
+  for (size_t k=maxDelay;k+1<s.size();k++) {
+    for (int i=0;i<zones;i++) {
+      if (fits[i].rms<0)
+        continue;
+      double y=fits[i].b*s[k-fits[i].delay].duty[i]+fits[i].c;
+      for (int j=0;j<zones;j++)
+        y+=fits[i].a[j]*sim[k].temp[j];
+      sim[k+1].temp[i]=y;
+    }
+
+    double e=sim[k+1].temp[z]-s[k+1].temp[z];
+    sum+=e*e;
+  }
+
+  return sqrt(sum/(s.size()-maxDelay-1));
+}
+
+
+void Synthesize(const char *path, double hours) {
+  OvenModelParams p=OvenModelParams::Default();
+  p.noise=0.25;
+  OvenModel oven(p,7);
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<double> duty(0,1);
+  std::uniform_int_distribution<int> hold(600,1800);
+  FILE *f=fopen(path,"w");
+  double target[OVEN_ZONES]={0.6,0.4},heater[OVEN_ZONES];
+  unsigned long now=0,change=1200000;
+
+  if (!f) {
+    printf("unable to write %s\n",path);
+    return;
+  }
+
+  // random duties of the relay time proportioning (5s window), the loop runs every 200ms like the firmware
+  while (now<hours*3600000) {
+    if (now>=change) {
+      for (int z=0;z<OVEN_ZONES;z++)
+        target[z]=duty(rng);
+      change=now+hold(rng)*1000UL;
+    }
+
+    for (int z=0;z<OVEN_ZONES;z++)
+      heater[z]=(((now+z*2500)%5000)<target[z]*5000)?1:0;
+    oven.Step(0.1,heater);
+    oven.Step(0.1,heater);
+    now+=200;
+
+    fprintf(f,"TRACE,%lu",now);
+    for (int z=0;z<OVEN_ZONES;z++)
+      fprintf(f,",%.2f,%d",oven.Measure(z),(int) heater[z]);
+    fprintf(f,"\n");
+  }
+
+  fclose(f);
+  printf("written %s, %g hours of the oven model with random duties\n",path,hours);
+}
+
+
+int main(int argc, char **argv) {
+  double step=5,maxDeadTime=300,window=5000;
+  bool coupled=false;
+  const char *path=NULL;
+
+  if (argc>=3 && strcmp(argv[1],"--synth")==0) {
+    Synthesize(argv[2],(argc>3)?atof(argv[3]):8);
+    return 0;
+  }
+
+  for (int i=1;i<argc;i++) {
+    if (strcmp(argv[i],"-t")==0 && i+1<argc)
+      step=atof(argv[++i]);
+    else if (strcmp(argv[i],"-d")==0 && i+1<argc)
+      maxDeadTime=atof(argv[++i]);
+    else if (strcmp(argv[i],"-w")==0 && i+1<argc)
+      window=atof(argv[++i]);
+    else if (strcmp(argv[i],"-c")==0)
+      coupled=true;
+    else
+      path=argv[i];
+  }
+
+  Trace trace;
+  if (!path || !ReadTrace(path,trace)) {
+    printf("usage: sysid [-t step_s] [-d max_dead_time_s] [-w window_ms] [-c] trace.log\n       sysid --synth trace.log [hours]\n");
+    return 1;
+  }
+
+  std::vector<Sample> s=Resample(trace,step);
+  int maxDelay=(int) (maxDeadTime/step);
+
+  printf("%d zones, %zu samples, %.0f s, resampled every %g s\n",trace.zones,trace.samples.size(),trace.samples.back().t-trace.samples[0].t,step);
+  if ((int) s.size()<maxDelay+20) {
+    printf("trace too short\n");
+    return 1;
+  }
+
+  ArxFit fits[MAX_ZONES];
+  for (int z=0;z<trace.zones;z++)
+    fits[z]=FitZone(s,trace.zones,z,coupled,maxDelay);
+
+  for (int z=0;z<trace.zones;z++) {
+    ArxFit &f=fits[z];
+    double umin=1,umax=0;
+
+    for (Sample &x : s) {
+      umin=fmin(umin,x.duty[z]);
+      umax=fmax(umax,x.duty[z]);
+    }
+
+    printf("\nzone %d\n",z);
+    if (f.rms<0 || umax-umin<0.05) {
+      printf("  not identifiable: the heater duty does not change enough\n");
+      fits[z].rms=-1;
+      continue;
+    }
+
+    if (!coupled) {
+      FopdtModel m;
+
+      if (f.a[z]<=0 || f.a[z]>=1 || f.b<=0) {
+        printf("  fit is not a stable first order response (a %g b %g)\n",f.a[z],f.b);
+        continue;
+      }
+
+      m.gain=f.b/(1-f.a[z]);
+      m.tau=-step/log(f.a[z]);
+      m.deadTime=f.delay*step;
+
+      printf("  first order plus dead time: gain %.1f C at full duty, tau %.0f s, dead time %.0f s, ambient %.1f C\n",m.gain,m.tau,m.deadTime,f.c/(1-f.a[z]));
+      printf("  rms error: one step %.3f C, free run %.2f C\n",f.rms,Validate(s,trace.zones,fits,z));
+      printf("  smith predictor: smithGain %.1f smithTau %.0f smithDeadTime %.0f\n",m.gain,m.tau,m.deadTime);
+      printf("  %-16s %10s %10s %10s\n","rule","kp","ki","kd");
+      for (int r=0;r<TUNING_RULES;r++) {
+        PidGains g=m.Tune((TuningRule) r,window);
+        printf("  %-16s %10.2f %10.4f %10.1f\n",FopdtModel::GetRuleName((TuningRule) r),g.kp,g.ki,g.kd);
+      }
+    }
+    else {
+      // continuous model from the discrete one, (A-I)/step is accurate since step is much shorter than tau
+      double loss=-(f.a[z]-1)/step,coupling=0;
+
+      for (int j=0;j<trace.zones;j++)
+        if (j!=z) {
+          coupling+=f.a[j]/step;
+          loss-=f.a[j]/step;
+        }
+
+      printf("  coupled model: rms error one step %.3f C, free run %.2f C\n",f.rms,Validate(s,trace.zones,fits,z));
+      printf("  mpc: mpcGain %.4f mpcLoss %.6f mpcCoupling %.6f mpcLag %.0f\n",f.b/step,loss,coupling/(trace.zones-1),f.delay*step);
+    }
+  }
+
+  return 0;
+}